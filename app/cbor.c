@@ -0,0 +1,831 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <string.h>
+#include "cbor.h"
+
+
+/*
+ * NOTE This module has no Microvisor or RTOS dependencies, so it can be
+ *      built for the host too -- see `sim/bench/cbor_bench.c`.
+ *
+ *      The parser is a byte-at-a-time state machine like the JSON parser,
+ *      except that string contents are copied a run at a time. Maps and
+ *      arrays may have definite or indefinite lengths; strings must have
+ *      definite lengths. Tags are skipped. Map keys are passed on when
+ *      they are text; the values of other keys are passed on keyless.
+ */
+
+
+/*
+ * CONSTANTS
+ */
+enum {
+    CBOR_STATE_HEAD = 0,
+    CBOR_STATE_ARGUMENT,
+    CBOR_STATE_PAYLOAD,
+    CBOR_STATE_DONE,
+    CBOR_STATE_ERROR
+};
+
+#define     CBOR_MAJOR_UINT             0
+#define     CBOR_MAJOR_NEGINT           1
+#define     CBOR_MAJOR_BYTES            2
+#define     CBOR_MAJOR_TEXT             3
+#define     CBOR_MAJOR_ARRAY            4
+#define     CBOR_MAJOR_MAP              5
+#define     CBOR_MAJOR_TAG              6
+#define     CBOR_MAJOR_SIMPLE           7
+
+// Additional information values
+#define     CBOR_INFO_UINT8             24
+#define     CBOR_INFO_UINT16            25
+#define     CBOR_INFO_UINT32            26
+#define     CBOR_INFO_UINT64            27
+#define     CBOR_INFO_INDEFINITE        31
+
+#define     CBOR_SIMPLE_FALSE           20
+#define     CBOR_SIMPLE_TRUE            21
+#define     CBOR_SIMPLE_NULL            22
+#define     CBOR_SIMPLE_UNDEFINED       23
+
+#define     CBOR_BREAK                  0xFF
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static bool         cbor_step(CborParser* parser, uint8_t c);
+static bool         cbor_start_item(CborParser* parser);
+static bool         cbor_start_simple(CborParser* parser);
+static bool         cbor_open(CborParser* parser, bool is_map, uint64_t count);
+static bool         cbor_break(CborParser* parser);
+static void         cbor_emit(CborParser* parser, CborEventType type);
+static void         cbor_item_done(CborParser* parser);
+static void         cbor_append(CborParser* parser, const uint8_t* data, uint32_t length);
+static void         cbor_end_string(CborParser* parser);
+static float        cbor_half_to_float(uint16_t half);
+static void         cbor_decode_event(const CborEvent* event, void* context);
+static bool         cbor_put_head(CborWriter* writer, uint8_t major, uint32_t argument);
+static bool         cbor_put_byte(CborWriter* writer, uint8_t byte);
+static bool         cbor_put_string(CborWriter* writer, uint8_t major, const void* data, uint32_t length);
+
+
+/**
+ * @brief Prepare a parser for a new document.
+ *
+ * @param parser:  The parser.
+ * @param handler: Called with each event.
+ * @param context: Passed to the handler.
+ */
+void cbor_init(CborParser* parser, CborHandler handler, void* context) {
+
+    memset((void *)parser, 0x00, sizeof(CborParser));
+    parser->handler = handler;
+    parser->context = context;
+    parser->state = CBOR_STATE_HEAD;
+}
+
+
+/**
+ * @brief Parse the next chunk of a document.
+ *
+ * @param parser: The parser.
+ * @param data:   The chunk.
+ * @param length: The size of the chunk in bytes.
+ *
+ * @returns `false` if the document is malformed, otherwise `true`.
+ */
+bool cbor_feed(CborParser* parser, const uint8_t* data, uint32_t length) {
+
+    uint32_t i = 0;
+    while (i < length) {
+        if (parser->state == CBOR_STATE_PAYLOAD) {
+            // Take as much of the string as the chunk holds
+            uint32_t count = length - i < parser->payload_remaining ? length - i : parser->payload_remaining;
+            cbor_append(parser, &data[i], count);
+            parser->payload_remaining -= count;
+            parser->bytes += count;
+            i += count;
+            if (parser->payload_remaining == 0) cbor_end_string(parser);
+            continue;
+        }
+
+        if (!cbor_step(parser, data[i])) {
+            parser->state = CBOR_STATE_ERROR;
+            return false;
+        }
+
+        parser->bytes++;
+        i++;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Signal the end of a document.
+ *
+ * @param parser: The parser.
+ *
+ * @returns `true` if a complete, well-formed document was parsed, otherwise `false`.
+ */
+bool cbor_finish(CborParser* parser) {
+
+    return parser->state == CBOR_STATE_DONE;
+}
+
+
+/**
+ * @brief Advance the parser by one byte of an item's head.
+ *
+ * @param parser: The parser.
+ * @param c:      The byte.
+ *
+ * @returns `false` if the byte is illegal here, otherwise `true`.
+ */
+static bool cbor_step(CborParser* parser, uint8_t c) {
+
+    switch (parser->state) {
+        case CBOR_STATE_HEAD:
+            if (c == CBOR_BREAK) return cbor_break(parser);
+
+            parser->major = c >> 5;
+            parser->info = c & 0x1F;
+            parser->argument = parser->info;
+            if (parser->info < CBOR_INFO_UINT8) return cbor_start_item(parser);
+            if (parser->info <= CBOR_INFO_UINT64) {
+                parser->argument = 0;
+                parser->argument_bytes = (uint8_t)(1 << (parser->info - CBOR_INFO_UINT8));
+                parser->state = CBOR_STATE_ARGUMENT;
+                return true;
+            }
+
+            // Only maps and arrays may be indefinite here. The other values are reserved
+            if (parser->info == CBOR_INFO_INDEFINITE && (parser->major == CBOR_MAJOR_ARRAY || parser->major == CBOR_MAJOR_MAP)) {
+                return cbor_open(parser, parser->major == CBOR_MAJOR_MAP, CBOR_INDEFINITE);
+            }
+
+            return false;
+        case CBOR_STATE_ARGUMENT:
+            // Arguments are big-endian
+            parser->argument = (parser->argument << 8) | c;
+            if (--parser->argument_bytes == 0) return cbor_start_item(parser);
+            return true;
+        default:
+            // Nothing may follow the top-level item
+            return false;
+    }
+}
+
+
+/**
+ * @brief Act on an item whose head has been read.
+ *
+ * @param parser: The parser.
+ *
+ * @returns `false` if the item is illegal here, otherwise `true`.
+ */
+static bool cbor_start_item(CborParser* parser) {
+
+    parser->state = CBOR_STATE_HEAD;
+    uint32_t level = parser->depth - 1u;
+    bool at_key = parser->depth > 0 && parser->is_map[level] && !parser->want_value[level];
+
+    switch (parser->major) {
+        case CBOR_MAJOR_UINT:
+        case CBOR_MAJOR_NEGINT:
+            // An integer key is skipped, leaving its value keyless
+            if (!at_key) cbor_emit(parser, parser->major == CBOR_MAJOR_UINT ? CBOR_EVENT_UINT : CBOR_EVENT_NEGINT);
+            cbor_item_done(parser);
+            return true;
+        case CBOR_MAJOR_BYTES:
+        case CBOR_MAJOR_TEXT:
+            if (parser->argument > 0xFFFFFFFF || (at_key && parser->major == CBOR_MAJOR_BYTES)) return false;
+            parser->in_key = at_key;
+            parser->truncated = false;
+            parser->key_length = at_key ? 0 : parser->key_length;
+            parser->value_length = 0;
+            parser->payload_remaining = (uint32_t)parser->argument;
+            if (parser->payload_remaining == 0) {
+                cbor_end_string(parser);
+            } else {
+                parser->state = CBOR_STATE_PAYLOAD;
+            }
+
+            return true;
+        case CBOR_MAJOR_ARRAY:
+        case CBOR_MAJOR_MAP:
+            if (at_key) return false;
+            return cbor_open(parser, parser->major == CBOR_MAJOR_MAP, parser->argument);
+        case CBOR_MAJOR_TAG:
+            // The tagged item follows. Tags are ignored
+            return true;
+        default:
+            if (at_key) return false;
+            return cbor_start_simple(parser);
+    }
+}
+
+
+/**
+ * @brief Act on a simple value or float whose head has been read.
+ *
+ * @param parser: The parser.
+ *
+ * @returns `false` if the value is reserved, otherwise `true`.
+ */
+static bool cbor_start_simple(CborParser* parser) {
+
+    switch (parser->info) {
+        case CBOR_SIMPLE_FALSE:
+            cbor_emit(parser, CBOR_EVENT_FALSE);
+            break;
+        case CBOR_SIMPLE_TRUE:
+            cbor_emit(parser, CBOR_EVENT_TRUE);
+            break;
+        case CBOR_INFO_UINT16:
+        case CBOR_INFO_UINT32:
+        case CBOR_INFO_UINT64:
+            // Floats, which are passed on as `number`
+            cbor_emit(parser, CBOR_EVENT_FLOAT);
+            break;
+        default:
+            // Null, undefined and unassigned simple values all come through as null
+            if (parser->info > CBOR_INFO_UINT8) return false;
+            cbor_emit(parser, CBOR_EVENT_NULL);
+    }
+
+    cbor_item_done(parser);
+    return true;
+}
+
+
+/**
+ * @brief Start a map or an array.
+ *
+ * @param parser: The parser.
+ * @param is_map: `true` for a map, `false` for an array.
+ * @param count:  The number of entries, or `CBOR_INDEFINITE`.
+ *
+ * @returns `false` if the nesting is too deep, otherwise `true`.
+ */
+static bool cbor_open(CborParser* parser, bool is_map, uint64_t count) {
+
+    // A map's entries are counted as keys and values
+    if (count != CBOR_INDEFINITE && count >= (is_map ? CBOR_INDEFINITE / 2 : CBOR_INDEFINITE)) return false;
+    if (parser->depth == CBOR_MAX_DEPTH) return false;
+
+    parser->state = CBOR_STATE_HEAD;
+    cbor_emit(parser, is_map ? CBOR_EVENT_MAP_START : CBOR_EVENT_ARRAY_START);
+    if (count == 0) {
+        cbor_emit(parser, is_map ? CBOR_EVENT_MAP_END : CBOR_EVENT_ARRAY_END);
+        cbor_item_done(parser);
+        return true;
+    }
+
+    parser->is_map[parser->depth] = is_map;
+    parser->want_value[parser->depth] = false;
+    parser->remaining[parser->depth] = count == CBOR_INDEFINITE ? CBOR_INDEFINITE : (uint32_t)count * (is_map ? 2 : 1);
+    parser->depth++;
+    if (parser->depth > parser->max_depth) parser->max_depth = parser->depth;
+    return true;
+}
+
+
+/**
+ * @brief End an indefinite-length map or array.
+ *
+ * @param parser: The parser.
+ *
+ * @returns `false` if there's no such container to end, otherwise `true`.
+ */
+static bool cbor_break(CborParser* parser) {
+
+    uint32_t level = parser->depth - 1u;
+    if (parser->depth == 0 || parser->remaining[level] != CBOR_INDEFINITE) return false;
+
+    // A map can't end between a key and its value
+    if (parser->is_map[level] && parser->want_value[level]) return false;
+
+    parser->depth--;
+    cbor_emit(parser, parser->is_map[level] ? CBOR_EVENT_MAP_END : CBOR_EVENT_ARRAY_END);
+    cbor_item_done(parser);
+    return true;
+}
+
+
+/**
+ * @brief Pass an event to the handler.
+ *
+ * @param parser: The parser.
+ * @param type:   The event type.
+ */
+static void cbor_emit(CborParser* parser, CborEventType type) {
+
+    bool is_end = type == CBOR_EVENT_MAP_END || type == CBOR_EVENT_ARRAY_END;
+    bool has_text = type == CBOR_EVENT_TEXT || type == CBOR_EVENT_BYTES;
+
+    CborEvent event = {
+        .type = type,
+        .depth = parser->depth,
+        .key = parser->have_key && !is_end ? parser->key : NULL,
+        .key_length = parser->have_key && !is_end ? parser->key_length : 0,
+        .value = has_text ? parser->value : NULL,
+        .length = has_text ? parser->value_length : 0,
+        .truncated = has_text && parser->truncated,
+        .integer = type == CBOR_EVENT_UINT || type == CBOR_EVENT_NEGINT ? parser->argument : 0
+    };
+
+    if (type == CBOR_EVENT_FLOAT) {
+        if (parser->info == CBOR_INFO_UINT16) {
+            event.number = cbor_half_to_float((uint16_t)parser->argument);
+        } else if (parser->info == CBOR_INFO_UINT32) {
+            uint32_t bits = (uint32_t)parser->argument;
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            event.number = value;
+        } else {
+            memcpy(&event.number, &parser->argument, sizeof(event.number));
+        }
+    }
+
+    // The key applies to the value it precedes only
+    if (!is_end) parser->have_key = false;
+    if (parser->handler != NULL) parser->handler(&event, parser->context);
+}
+
+
+/**
+ * @brief Count a complete item against its container, and end each
+ *        definite-length container it completes.
+ *
+ * @param parser: The parser.
+ */
+static void cbor_item_done(CborParser* parser) {
+
+    parser->state = CBOR_STATE_HEAD;
+    while (parser->depth > 0) {
+        uint32_t level = parser->depth - 1u;
+        if (parser->is_map[level]) parser->want_value[level] = !parser->want_value[level];
+        if (parser->remaining[level] == CBOR_INDEFINITE || --parser->remaining[level] > 0) return;
+
+        // The container is complete, and is itself an item of its parent
+        parser->depth--;
+        cbor_emit(parser, parser->is_map[level] ? CBOR_EVENT_MAP_END : CBOR_EVENT_ARRAY_END);
+    }
+
+    // The top-level item completes the document
+    parser->state = CBOR_STATE_DONE;
+}
+
+
+/**
+ * @brief Add string content to the key or value being parsed, noting
+ *        any that was dropped because the buffer is full.
+ *
+ * @param parser: The parser.
+ * @param data:   The content.
+ * @param length: The size of the content in bytes.
+ */
+static void cbor_append(CborParser* parser, const uint8_t* data, uint32_t length) {
+
+    char* buffer = parser->in_key ? parser->key : parser->value;
+    uint32_t* used = parser->in_key ? &parser->key_length : &parser->value_length;
+    uint32_t space = (parser->in_key ? CBOR_MAX_KEY_LEN : CBOR_MAX_VALUE_LEN) - *used;
+    uint32_t count = length < space ? length : space;
+
+    memcpy(&buffer[*used], data, count);
+    *used += count;
+    if (count < length && !parser->in_key) parser->truncated = true;
+}
+
+
+/**
+ * @brief Finish a string: keep it as the next value's key, or pass it on.
+ *
+ * @param parser: The parser.
+ */
+static void cbor_end_string(CborParser* parser) {
+
+    if (parser->in_key) {
+        parser->key[parser->key_length] = '\0';
+        parser->have_key = true;
+        parser->in_key = false;
+    } else {
+        parser->value[parser->value_length] = '\0';
+        cbor_emit(parser, parser->major == CBOR_MAJOR_TEXT ? CBOR_EVENT_TEXT : CBOR_EVENT_BYTES);
+    }
+
+    cbor_item_done(parser);
+}
+
+
+/**
+ * @brief Convert a half-precision float to single precision.
+ *
+ * @param half: The half-precision bits.
+ *
+ * @returns The value.
+ */
+static float cbor_half_to_float(uint16_t half) {
+
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0x1F) {
+        // Infinity or NaN
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // Subnormal: normalize it, as single precision has the range to
+        exponent = 113;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+/**
+ * @brief Prepare a decoder to fill a struct from a CBOR map.
+ *
+ * @param decoder: The decoder.
+ * @param schema:  The struct's schema.
+ * @param target:  The struct.
+ */
+void cbor_decoder_init(CborDecoder* decoder, const JsonSchema* schema, void* target) {
+
+    cbor_init(&decoder->parser, cbor_decode_event, decoder);
+    decoder->schema = schema;
+    decoder->target = (uint8_t*)target;
+    decoder->found = 0;
+}
+
+
+/**
+ * @brief Decode the next chunk of a document.
+ *
+ * @param decoder: The decoder.
+ * @param data:    The chunk.
+ * @param length:  The size of the chunk in bytes.
+ *
+ * @returns `false` if the document is malformed, otherwise `true`.
+ */
+bool cbor_decoder_feed(CborDecoder* decoder, const uint8_t* data, uint32_t length) {
+
+    return cbor_feed(&decoder->parser, data, length);
+}
+
+
+/**
+ * @brief Signal the end of a document being decoded.
+ *
+ * @param decoder: The decoder.
+ *
+ * @returns `true` if the document was well formed and
+ *          every schema field was filled, otherwise `false`.
+ */
+bool cbor_decoder_finish(CborDecoder* decoder) {
+
+    uint32_t all = decoder->schema->count >= 32 ? 0xFFFFFFFF : (1UL << decoder->schema->count) - 1;
+    return cbor_finish(&decoder->parser) && decoder->found == all;
+}
+
+
+/**
+ * @brief Parser event handler that stores a top-level map entry's value
+ *        in the schema field with the same key.
+ *
+ * Values of the wrong type, or out of the field's range, are ignored.
+ *
+ * @param event:   The parser event.
+ * @param context: The decoder.
+ */
+static void cbor_decode_event(const CborEvent* event, void* context) {
+
+    CborDecoder* decoder = (CborDecoder*)context;
+    if (event->depth != 1 || event->key == NULL) return;
+
+    uint32_t hash = json_key_hash(event->key, event->key_length);
+    const JsonSchema* schema = decoder->schema;
+    for (uint32_t i = 0 ; i < schema->count ; ++i) {
+        const JsonField* field = &schema->fields[i];
+        if (field->hash != hash || memcmp(field->key, event->key, event->key_length + 1) != 0) continue;
+
+        uint8_t* member = decoder->target + field->offset;
+        switch (field->type) {
+            case JSON_FIELD_UINT32:
+                if (event->type != CBOR_EVENT_UINT || event->integer > 0xFFFFFFFF) return;
+                *(uint32_t*)member = (uint32_t)event->integer;
+                break;
+            case JSON_FIELD_INT32:
+                if ((event->type != CBOR_EVENT_UINT && event->type != CBOR_EVENT_NEGINT) || event->integer > 0x7FFFFFFF) return;
+                *(int32_t*)member = event->type == CBOR_EVENT_UINT ? (int32_t)event->integer : -1 - (int32_t)event->integer;
+                break;
+            case JSON_FIELD_BOOL:
+                if (event->type != CBOR_EVENT_TRUE && event->type != CBOR_EVENT_FALSE) return;
+                *(bool*)member = event->type == CBOR_EVENT_TRUE;
+                break;
+            case JSON_FIELD_STRING: {
+                if (event->type != CBOR_EVENT_TEXT) return;
+                uint32_t length = event->length < field->size ? event->length : field->size - 1u;
+                memcpy(member, event->value, length);
+                member[length] = '\0';
+                break;
+            }
+            default:
+                return;
+        }
+
+        decoder->found |= 1UL << i;
+        return;
+    }
+}
+
+
+/**
+ * @brief Prepare to encode into a buffer.
+ *
+ * @param writer: The writer.
+ * @param buffer: The buffer.
+ * @param size:   The size of the buffer in bytes.
+ */
+void cbor_writer_init(CborWriter* writer, uint8_t* buffer, uint32_t size) {
+
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->length = 0;
+    writer->overflow = false;
+}
+
+
+/**
+ * @brief Calculate the size of an item's head, which is also
+ *        the size of an encoded unsigned integer.
+ *
+ * @param argument: The head's argument.
+ *
+ * @returns The size in bytes.
+ */
+uint32_t cbor_head_size(uint32_t argument) {
+
+    return argument < CBOR_INFO_UINT8 ? 1 : argument <= 0xFF ? 2 : argument <= 0xFFFF ? 3 : 5;
+}
+
+
+/**
+ * @brief Encode an unsigned integer.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_put_uint(CborWriter* writer, uint32_t value) {
+
+    return cbor_put_head(writer, CBOR_MAJOR_UINT, value);
+}
+
+
+/**
+ * @brief Encode a signed integer.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_put_int(CborWriter* writer, int32_t value) {
+
+    // A negative value n is encoded as -1 - n, which is its ones' complement
+    return value < 0 ? cbor_put_head(writer, CBOR_MAJOR_NEGINT, ~(uint32_t)value) : cbor_put_head(writer, CBOR_MAJOR_UINT, (uint32_t)value);
+}
+
+
+/**
+ * @brief Encode `true` or `false`.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_put_bool(CborWriter* writer, bool value) {
+
+    return cbor_put_head(writer, CBOR_MAJOR_SIMPLE, value ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE);
+}
+
+
+/**
+ * @brief Encode `null`.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_put_null(CborWriter* writer) {
+
+    return cbor_put_head(writer, CBOR_MAJOR_SIMPLE, CBOR_SIMPLE_NULL);
+}
+
+
+/**
+ * @brief Encode a UTF-8 text string.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_put_text(CborWriter* writer, const char* text, uint32_t length) {
+
+    return cbor_put_string(writer, CBOR_MAJOR_TEXT, text, length);
+}
+
+
+/**
+ * @brief Encode a byte string.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_put_bytes(CborWriter* writer, const uint8_t* data, uint32_t length) {
+
+    return cbor_put_string(writer, CBOR_MAJOR_BYTES, data, length);
+}
+
+
+/**
+ * @brief Start an array of `count` items, which must follow.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_put_array(CborWriter* writer, uint32_t count) {
+
+    return cbor_put_head(writer, CBOR_MAJOR_ARRAY, count);
+}
+
+
+/**
+ * @brief Start a map of `count` keys and values, which must follow.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_put_map(CborWriter* writer, uint32_t count) {
+
+    return cbor_put_head(writer, CBOR_MAJOR_MAP, count);
+}
+
+
+/**
+ * @brief Start an array whose items are not yet counted. End it with `cbor_end()`.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_begin_array(CborWriter* writer) {
+
+    return cbor_put_byte(writer, (CBOR_MAJOR_ARRAY << 5) | CBOR_INFO_INDEFINITE);
+}
+
+
+/**
+ * @brief Start a map whose entries are not yet counted. End it with `cbor_end()`.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_begin_map(CborWriter* writer) {
+
+    return cbor_put_byte(writer, (CBOR_MAJOR_MAP << 5) | CBOR_INFO_INDEFINITE);
+}
+
+
+/**
+ * @brief End the innermost array or map started by `cbor_begin_array()`
+ *        or `cbor_begin_map()`.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_end(CborWriter* writer) {
+
+    return cbor_put_byte(writer, CBOR_BREAK);
+}
+
+
+/**
+ * @brief Encode a struct as a map, keyed as its schema.
+ *
+ * @param writer: The writer.
+ * @param schema: The struct's schema.
+ * @param source: The struct.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+bool cbor_put_schema(CborWriter* writer, const JsonSchema* schema, const void* source) {
+
+    cbor_put_map(writer, schema->count);
+    for (uint32_t i = 0 ; i < schema->count ; ++i) {
+        const JsonField* field = &schema->fields[i];
+        const uint8_t* member = (const uint8_t*)source + field->offset;
+        cbor_put_text(writer, field->key, strlen(field->key));
+        switch (field->type) {
+            case JSON_FIELD_UINT32:
+                cbor_put_uint(writer, *(const uint32_t*)member);
+                break;
+            case JSON_FIELD_INT32:
+                cbor_put_int(writer, *(const int32_t*)member);
+                break;
+            case JSON_FIELD_BOOL:
+                cbor_put_bool(writer, *(const bool*)member);
+                break;
+            default:
+                cbor_put_text(writer, (const char*)member, strnlen((const char*)member, field->size));
+        }
+    }
+
+    return !writer->overflow;
+}
+
+
+/**
+ * @brief Encode an item's head with the shortest form of its argument.
+ *
+ * @param writer:   The writer.
+ * @param major:    The item's major type.
+ * @param argument: The argument.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+static bool cbor_put_head(CborWriter* writer, uint8_t major, uint32_t argument) {
+
+    uint32_t size = cbor_head_size(argument);
+    if (writer->overflow || size > writer->size - writer->length) {
+        writer->overflow = true;
+        return false;
+    }
+
+    uint8_t* out = &writer->buffer[writer->length];
+    uint8_t type = (uint8_t)(major << 5);
+    switch (size) {
+        case 1:
+            out[0] = type | (uint8_t)argument;
+            break;
+        case 2:
+            out[0] = type | CBOR_INFO_UINT8;
+            out[1] = (uint8_t)argument;
+            break;
+        case 3:
+            out[0] = type | CBOR_INFO_UINT16;
+            out[1] = (uint8_t)(argument >> 8);
+            out[2] = (uint8_t)argument;
+            break;
+        default:
+            out[0] = type | CBOR_INFO_UINT32;
+            out[1] = (uint8_t)(argument >> 24);
+            out[2] = (uint8_t)(argument >> 16);
+            out[3] = (uint8_t)(argument >> 8);
+            out[4] = (uint8_t)argument;
+    }
+
+    writer->length += size;
+    return true;
+}
+
+
+/**
+ * @brief Encode a single byte, eg. a break.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+static bool cbor_put_byte(CborWriter* writer, uint8_t byte) {
+
+    if (writer->overflow || writer->length == writer->size) {
+        writer->overflow = true;
+        return false;
+    }
+
+    writer->buffer[writer->length++] = byte;
+    return true;
+}
+
+
+/**
+ * @brief Encode a text or byte string, all of it or none of it.
+ *
+ * @returns `true` if it fit, otherwise `false`.
+ */
+static bool cbor_put_string(CborWriter* writer, uint8_t major, const void* data, uint32_t length) {
+
+    if (writer->overflow || cbor_head_size(length) + length > writer->size - writer->length) {
+        writer->overflow = true;
+        return false;
+    }
+
+    cbor_put_head(writer, major, length);
+    memcpy(&writer->buffer[writer->length], data, length);
+    writer->length += length;
+    return true;
+}
@@ -0,0 +1,153 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _CBOR_H_
+#define _CBOR_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "json.h"
+
+
+/*
+ * CONSTANTS
+ */
+// Deepest nesting of maps and arrays the parser will accept
+#define     CBOR_MAX_DEPTH              8
+
+// Text keys and string values longer than these are truncated
+#define     CBOR_MAX_KEY_LEN            32
+#define     CBOR_MAX_VALUE_LEN          96
+
+// A container's `remaining` count when its length is indefinite
+#define     CBOR_INDEFINITE             0xFFFFFFFF
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+typedef enum {
+    CBOR_EVENT_MAP_START = 0,
+    CBOR_EVENT_MAP_END,
+    CBOR_EVENT_ARRAY_START,
+    CBOR_EVENT_ARRAY_END,
+    CBOR_EVENT_UINT,
+    CBOR_EVENT_NEGINT,
+    CBOR_EVENT_TEXT,
+    CBOR_EVENT_BYTES,
+    CBOR_EVENT_TRUE,
+    CBOR_EVENT_FALSE,
+    CBOR_EVENT_NULL,
+    CBOR_EVENT_FLOAT
+} CborEventType;
+
+// An event passed to the parser's handler, as `JsonEvent`. Integers come
+// as their CBOR argument: a `CBOR_EVENT_NEGINT`'s value is -1 - `integer`.
+// Text and byte strings are in `value`, `length` bytes long, with a NUL
+// after them. Pointers are valid only during the call
+typedef struct {
+    CborEventType   type;
+    uint32_t        depth;
+    const char*     key;
+    uint32_t        key_length;
+    const char*     value;
+    uint32_t        length;
+    bool            truncated;
+    uint64_t        integer;
+    double          number;
+} CborEvent;
+
+typedef void (*CborHandler)(const CborEvent* event, void* context);
+
+// Parser state. Resumable at any byte, so a document can be fed in
+// chunks split anywhere. Uses no heap, and its stack use doesn't grow
+// with the document's nesting
+typedef struct {
+    CborHandler     handler;
+    void*           context;
+    uint8_t         state;
+    uint8_t         major;
+    uint8_t         info;
+    uint8_t         argument_bytes;
+    uint8_t         depth;
+    uint8_t         max_depth;
+    bool            in_key;
+    bool            have_key;
+    bool            truncated;
+    bool            is_map[CBOR_MAX_DEPTH];
+    bool            want_value[CBOR_MAX_DEPTH];
+    uint32_t        remaining[CBOR_MAX_DEPTH];
+    uint64_t        argument;
+    uint32_t        payload_remaining;
+    uint32_t        key_length;
+    uint32_t        value_length;
+    uint32_t        bytes;
+    char            key[CBOR_MAX_KEY_LEN + 1];
+    char            value[CBOR_MAX_VALUE_LEN + 1];
+} CborParser;
+
+// Decodes a map into a schema's struct in one pass as it is parsed.
+// Takes the same schemas as `JsonDecoder`
+typedef struct {
+    CborParser          parser;
+    const JsonSchema*   schema;
+    uint8_t*            target;
+    uint32_t            found;
+} CborDecoder;
+
+// Encodes items straight into a buffer. Once an item doesn't fit,
+// `overflow` is set and nothing more is written
+typedef struct {
+    uint8_t*    buffer;
+    uint32_t    size;
+    uint32_t    length;
+    bool        overflow;
+} CborWriter;
+
+
+/*
+ * PROTOTYPES
+ */
+void        cbor_init(CborParser* parser, CborHandler handler, void* context);
+bool        cbor_feed(CborParser* parser, const uint8_t* data, uint32_t length);
+bool        cbor_finish(CborParser* parser);
+void        cbor_decoder_init(CborDecoder* decoder, const JsonSchema* schema, void* target);
+bool        cbor_decoder_feed(CborDecoder* decoder, const uint8_t* data, uint32_t length);
+bool        cbor_decoder_finish(CborDecoder* decoder);
+
+void        cbor_writer_init(CborWriter* writer, uint8_t* buffer, uint32_t size);
+uint32_t    cbor_head_size(uint32_t argument);
+bool        cbor_put_uint(CborWriter* writer, uint32_t value);
+bool        cbor_put_int(CborWriter* writer, int32_t value);
+bool        cbor_put_bool(CborWriter* writer, bool value);
+bool        cbor_put_null(CborWriter* writer);
+bool        cbor_put_text(CborWriter* writer, const char* text, uint32_t length);
+bool        cbor_put_bytes(CborWriter* writer, const uint8_t* data, uint32_t length);
+bool        cbor_put_array(CborWriter* writer, uint32_t count);
+bool        cbor_put_map(CborWriter* writer, uint32_t count);
+bool        cbor_begin_array(CborWriter* writer);
+bool        cbor_begin_map(CborWriter* writer);
+bool        cbor_end(CborWriter* writer);
+bool        cbor_put_schema(CborWriter* writer, const JsonSchema* schema, const void* source);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _CBOR_H_
@@ -0,0 +1,66 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _DIGEST_H_
+#define _DIGEST_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * CONSTANTS
+ */
+#define     DIGEST_SHA256_SIZE_B        32
+#define     DIGEST_SHA256_BLOCK_B       64
+
+// Starts an FNV-1a hash. See `digest_fnv1a()`
+#define     DIGEST_FNV1A_BASIS          2166136261u
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+// An incremental SHA-256: fed any number of runs of any size, so a body
+// can be hashed chunk by chunk as it is read. Plain data, so it can be
+// copied, or saved to flash and taken up again later
+typedef struct {
+    uint32_t    state[8];
+    uint64_t    length;
+    uint8_t     block[DIGEST_SHA256_BLOCK_B];
+} DigestSha256;
+
+
+/*
+ * PROTOTYPES
+ */
+uint32_t    digest_crc32(uint32_t crc, const void* data, uint32_t length);
+uint32_t    digest_fnv1a(uint32_t hash, const void* data, uint32_t length, bool fold_case);
+void        digest_sha256_init(DigestSha256* sha);
+void        digest_sha256_update(DigestSha256* sha, const void* data, uint32_t length);
+void        digest_sha256_final(const DigestSha256* sha, uint8_t digest[DIGEST_SHA256_SIZE_B]);
+bool        digest_sha256_feed(const uint8_t* data, uint32_t length, void* context);
+bool        digest_parse_sha256(const char* field, uint8_t digest[DIGEST_SHA256_SIZE_B]);
+bool        digest_equal(const uint8_t* a, const uint8_t* b, uint32_t length);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _DIGEST_H_
@@ -0,0 +1,921 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * NOTE A resource too large for a channel's receive buffer is fetched as a
+ *      run of `Range` requests by the HTTP engine, up to the window's worth
+ *      at a time on separate channels, so a slow link's round trips
+ *      overlap. Slices are passed to the sink in order: one that arrives
+ *      before those ahead of it is held in its channel until they have
+ *      gone. Progress is saved in the flash cache every
+ *      `DOWNLOAD_CHECKPOINT_B` bytes with the resource's ETag, which later
+ *      slices send as `If-Range`: if the resource changes, the server sends
+ *      it whole and the download starts again. A failed slice is retried
+ *      from its start. The resource is hashed as it goes to the sink, and
+ *      the SHA-256 state saved with the progress, so a resumed download is
+ *      still checked in full at the end.
+ */
+
+
+/*
+ * CONSTANTS
+ */
+enum {
+    DOWNLOAD_STATE_IDLE = 0,
+    DOWNLOAD_STATE_CLAIMED,
+    DOWNLOAD_STATE_STARTING,
+    DOWNLOAD_STATE_ACTIVE
+};
+
+#define     DOWNLOAD_FLASH_QUAD_WORD_B  16
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     download_begin(void);
+static void     download_fill_window(void);
+static void     download_pause(void);
+static void     download_resume(TimerEntry* timer, void* context);
+static bool     download_can_request(void);
+static bool     download_request_slice(DownloadSlice* slice);
+static void     download_slice_done(const HttpResponse* response, void* context);
+static void     download_slice_arrived(const HttpResponse* response, DownloadSlice* slice);
+static bool     download_deliver(const HttpResponse* response, DownloadSlice* slice);
+static void     download_deliver_held(void);
+static bool     download_feed(const uint8_t* data, uint32_t length, void* context);
+static void     download_take_digest(const HttpResponse* response);
+static void     download_check_done(void);
+static void     download_abandon(void);
+static void     download_restart(const char* etag);
+static void     download_retry(DownloadSlice* slice, const char* reason);
+static void     download_finish(DownloadResult result);
+static void     download_save(void);
+static bool     download_parse_range(const char* value, uint32_t* first, uint32_t* total);
+static bool     download_flash_program(uint32_t offset, const uint8_t* data);
+static uintptr_t download_flash_address(uint32_t offset);
+
+
+/*
+ * GLOBALS
+ */
+// A client claims the download by moving the state from idle, fills in
+// the request, then marks it starting for the engine to pick up. From
+// then on, only the engine task touches the rest
+static volatile uint32_t download_state = DOWNLOAD_STATE_IDLE;
+static volatile uint32_t download_window = DOWNLOAD_WINDOW;
+
+// `progress.offset` is how far the sink has got; `next_offset` is where
+// the next new slice starts
+static struct {
+    char                url[HTTP_MAX_URL_LEN];
+    DownloadSink        sink;
+    DownloadCallback    callback;
+    void*               context;
+    uint32_t            key;
+    DownloadProgress    progress;
+    uint32_t            saved_offset;
+    uint32_t            next_offset;
+    uint32_t            position;
+    uint32_t            retries;
+    bool                paused;
+    TimerEntry          resume;
+    bool                sink_failed;
+    bool                has_manifest;
+    uint8_t             manifest[DIGEST_SHA256_SIZE_B];
+    DownloadSlice       slices[DOWNLOAD_MAX_WINDOW];
+} download;
+
+// Slices must come as sent: ranges count bytes of the encoded body
+static const struct MvHttpHeader download_identity = HTTP_HEADER("Accept-Encoding: identity");
+
+static DownloadStats download_stats = { 0 };
+
+// Where `download_flash_sink()` is up to, and the quad-word it is filling
+static struct {
+    uint32_t    next;
+    uint32_t    pending_offset;
+    uint32_t    pending_length;
+    uint8_t     pending[DOWNLOAD_FLASH_QUAD_WORD_B] __attribute__((aligned(4)));
+} download_flash;
+
+
+/**
+ * @brief Start downloading a resource. May be called from any task.
+ *
+ * If progress on the same URL was saved before a restart, the download
+ * picks up from there. If it was completed, the callback is called at once.
+ * The resource is hashed as it goes to the sink, and checked at the end
+ * against the given digest or, failing that, the server's Repr-Digest.
+ *
+ * @param url:      The resource's URL.
+ * @param digest:   The resource's SHA-256, eg. from a manifest, or `NULL`.
+ * @param sink:     Receives the resource, in order.
+ * @param callback: Called on the HTTP engine task when the download ends.
+ * @param context:  Passed to the sink and the callback.
+ *
+ * @returns `true` if the download was started, or `false` if the URL is
+ *          too long or another download is running.
+ */
+bool download_start(const char* url, const uint8_t* digest, DownloadSink sink, DownloadCallback callback, void* context) {
+
+    uint32_t url_length = strlen(url);
+    if (url_length >= HTTP_MAX_URL_LEN) return false;
+
+    uint32_t idle = DOWNLOAD_STATE_IDLE;
+    if (!__atomic_compare_exchange_n(&download_state, &idle, DOWNLOAD_STATE_CLAIMED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return false;
+    }
+
+    memcpy(download.url, url, url_length + 1);
+    download.has_manifest = digest != NULL;
+    if (digest != NULL) memcpy(download.manifest, digest, DIGEST_SHA256_SIZE_B);
+    download.sink = sink;
+    download.callback = callback;
+    download.context = context;
+    __atomic_store_n(&download_state, DOWNLOAD_STATE_STARTING, __ATOMIC_RELEASE);
+    http_wake_engine();
+    return true;
+}
+
+
+/**
+ * @brief Check whether a download is running.
+ *
+ * @returns `true` if one is, otherwise `false`.
+ */
+bool download_active(void) {
+
+    return __atomic_load_n(&download_state, __ATOMIC_ACQUIRE) != DOWNLOAD_STATE_IDLE;
+}
+
+
+/**
+ * @brief Set how many slices are kept in flight. May be called from any
+ *        task, and takes effect from the next slice requested.
+ *
+ * @param window: The number of slices, from 1 to `DOWNLOAD_MAX_WINDOW`.
+ */
+void download_set_window(uint32_t window) {
+
+    if (window < 1) window = 1;
+    if (window > DOWNLOAD_MAX_WINDOW) window = DOWNLOAD_MAX_WINDOW;
+    __atomic_store_n(&download_window, window, __ATOMIC_RELAXED);
+    http_wake_engine();
+}
+
+
+/**
+ * @brief Begin a newly started download, or request more slices unless
+ *        waiting to retry. Called on the HTTP engine task.
+ */
+void download_service(void) {
+
+    uint32_t state = __atomic_load_n(&download_state, __ATOMIC_ACQUIRE);
+    if (state == DOWNLOAD_STATE_STARTING) {
+        download_begin();
+        state = __atomic_load_n(&download_state, __ATOMIC_ACQUIRE);
+    }
+
+    if (state == DOWNLOAD_STATE_ACTIVE && !download.paused) {
+        download_fill_window();
+    }
+}
+
+
+/**
+ * @brief Get the counters for the current or last download.
+ *
+ * @returns The counters.
+ */
+const DownloadStats* download_get_stats(void) {
+
+    return &download_stats;
+}
+
+
+/**
+ * @brief A download sink that writes the resource to its own flash
+ *        region, `DOWNLOAD_FLASH_SIZE_B` bytes long. Each page is erased
+ *        as writing reaches it. Data resent after a resume that is
+ *        already in flash is left as it is.
+ *
+ * @param offset:  The data's offset in the resource.
+ * @param data:    The data, or `NULL` when the download is complete.
+ * @param length:  The size of the data in bytes.
+ * @param context: Not used.
+ *
+ * @returns `true` if the data was written, otherwise `false`.
+ */
+bool download_flash_sink(uint32_t offset, const uint8_t* data, uint32_t length, void* context) {
+
+    // Write out the last, part-filled quad-word
+    if (data == NULL) {
+        if (download_flash.pending_length == 0) return true;
+        memset(&download_flash.pending[download_flash.pending_length], 0xFF, DOWNLOAD_FLASH_QUAD_WORD_B - download_flash.pending_length);
+        download_flash.pending_length = 0;
+        return download_flash_program(download_flash.pending_offset, download_flash.pending);
+    }
+
+    // A resumed or restarted download begins again on a slice boundary
+    if (offset != download_flash.next) {
+        if (offset % DOWNLOAD_FLASH_QUAD_WORD_B != 0) return false;
+        download_flash.pending_offset = offset;
+        download_flash.pending_length = 0;
+    }
+
+    if (offset > DOWNLOAD_FLASH_SIZE_B || length > DOWNLOAD_FLASH_SIZE_B - offset) return false;
+    download_flash.next = offset + length;
+
+    while (length > 0) {
+        uint32_t space = DOWNLOAD_FLASH_QUAD_WORD_B - download_flash.pending_length;
+        uint32_t run = length < space ? length : space;
+        memcpy(&download_flash.pending[download_flash.pending_length], data, run);
+        download_flash.pending_length += run;
+        data += run;
+        length -= run;
+
+        if (download_flash.pending_length == DOWNLOAD_FLASH_QUAD_WORD_B) {
+            if (!download_flash_program(download_flash.pending_offset, download_flash.pending)) return false;
+            download_flash.pending_offset += DOWNLOAD_FLASH_QUAD_WORD_B;
+            download_flash.pending_length = 0;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Get the start of the region `download_flash_sink()` writes to.
+ *
+ * @returns The address of the region.
+ */
+const uint8_t* download_flash_data(void) {
+
+    return (const uint8_t*)download_flash_address(0);
+}
+
+
+/**
+ * @brief Take up a started download, from any progress saved for it.
+ */
+static void download_begin(void) {
+
+    // The progress is kept apart from any response kept for the same URL.
+    // Neither hash may be 0
+    uint32_t url_length = (uint32_t)strlen(download.url);
+    uint32_t url_hash = digest_fnv1a(DIGEST_FNV1A_BASIS, download.url, url_length, false);
+    uint32_t key = digest_fnv1a(DIGEST_FNV1A_BASIS, "download:", sizeof("download:") - 1, false);
+    key = digest_fnv1a(key, download.url, url_length, false);
+    download.key = key != 0 ? key : 1;
+    download.progress = (DownloadProgress){ url_hash != 0 ? url_hash : 1, 0, DOWNLOAD_SIZE_UNKNOWN, "" };
+    digest_sha256_init(&download.progress.sha);
+    download.retries = 0;
+    timer_wheel_init_timer(&download.resume, download_resume, NULL);
+    download.paused = false;
+    download_stats = (DownloadStats){ 0 };
+
+    uint32_t length = 0;
+    const uint8_t* saved = flash_cache_find(download.key, &length);
+    if (saved != NULL && length == sizeof(DownloadProgress)) {
+        DownloadProgress progress;
+        memcpy(&progress, saved, sizeof(progress));
+        if (progress.url_hash == download.progress.url_hash) download.progress = progress;
+    }
+
+    download.saved_offset = download.progress.offset;
+    download.next_offset = download.progress.offset;
+    __atomic_store_n(&download_state, DOWNLOAD_STATE_ACTIVE, __ATOMIC_RELEASE);
+
+    if (download.progress.offset > 0) {
+        download_stats.resumed_from = download.progress.offset;
+        if (download.progress.offset >= download.progress.total) {
+            server_log("Download of %s already complete: %lu bytes", download.url, download.progress.total);
+            download_finish(DOWNLOAD_OK);
+            return;
+        }
+
+        server_log("Resuming download of %s at %lu bytes", download.url, download.progress.offset);
+    }
+}
+
+
+/**
+ * @brief Request slices until the window is full: first any that failed,
+ *        earliest first, then new ones. Until the resource's size is
+ *        known, only one slice is requested at a time.
+ */
+static void download_fill_window(void) {
+
+    while (download_can_request()) {
+        DownloadSlice* slice = NULL;
+        for (uint32_t i = 0 ; i < DOWNLOAD_MAX_WINDOW ; ++i) {
+            DownloadSlice* queued = &download.slices[i];
+            if (queued->state == DOWNLOAD_SLICE_QUEUED && (slice == NULL || queued->offset < slice->offset)) slice = queued;
+        }
+
+        if (slice == NULL) {
+            for (uint32_t i = 0 ; i < DOWNLOAD_MAX_WINDOW && slice == NULL ; ++i) {
+                if (download.slices[i].state == DOWNLOAD_SLICE_FREE) slice = &download.slices[i];
+            }
+
+            uint32_t total = download.progress.total;
+            slice->offset = download.next_offset;
+            slice->length = total != DOWNLOAD_SIZE_UNKNOWN && total - slice->offset < DOWNLOAD_SLICE_SIZE_B ? total - slice->offset : DOWNLOAD_SLICE_SIZE_B;
+            slice->state = DOWNLOAD_SLICE_QUEUED;
+            download.next_offset += slice->length;
+        }
+
+        if (!download_request_slice(slice)) {
+            // The queue is full, so try again shortly
+            download_pause();
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief Check whether a slice can be requested: one has failed and is
+ *        waiting to be retried, or there is room in the window for a new one.
+ *
+ * @returns `true` if a slice can be requested, otherwise `false`.
+ */
+static bool download_can_request(void) {
+
+    uint32_t in_window = 0;
+    bool free_slice = false;
+    for (uint32_t i = 0 ; i < DOWNLOAD_MAX_WINDOW ; ++i) {
+        DownloadSliceState state = download.slices[i].state;
+        if (state == DOWNLOAD_SLICE_QUEUED) return true;
+        if (state == DOWNLOAD_SLICE_FREE) free_slice = true;
+        if (state == DOWNLOAD_SLICE_IN_FLIGHT || state == DOWNLOAD_SLICE_HELD) in_window++;
+    }
+
+    uint32_t total = download.progress.total;
+    if (total == DOWNLOAD_SIZE_UNKNOWN) return in_window == 0 && free_slice;
+    return in_window < __atomic_load_n(&download_window, __ATOMIC_RELAXED) && free_slice && download.next_offset < total;
+}
+
+
+/**
+ * @brief Queue the request for a slice. Slices after the first are
+ *        checked against its ETag with `If-Range`.
+ *
+ * @param slice: The slice.
+ *
+ * @returns `true` if the request was queued, or `false` if the queue is full.
+ */
+static bool download_request_slice(DownloadSlice* slice) {
+
+    char* range = slice->range;
+    memcpy(range, "Range: bytes=", 13);
+    uint32_t length = 13;
+    length += http_u32_to_dec(slice->offset, &range[length]);
+    range[length++] = '-';
+    length += http_u32_to_dec(slice->offset + slice->length - 1, &range[length]);
+
+    // Each request's headers must stay valid until it completes, but
+    // only the Range header differs between slices
+    struct MvHttpHeader* headers = slice->headers;
+    uint32_t count = 0;
+    headers[count++] = (struct MvHttpHeader){ (const uint8_t*)range, length };
+    headers[count++] = download_identity;
+
+    // The ETag may change before every slice has completed, so each
+    // slice keeps its own copy
+    const char* etag = download.progress.etag;
+    if (slice->offset > 0 && etag[0] != '\0') {
+        char* validator = slice->validator;
+        memcpy(validator, "If-Range: ", DOWNLOAD_IF_RANGE_PREFIX_B);
+        length = (uint32_t)strlen(etag);
+        memcpy(&validator[DOWNLOAD_IF_RANGE_PREFIX_B], etag, length);
+        headers[count++] = (struct MvHttpHeader){ (const uint8_t*)validator, DOWNLOAD_IF_RANGE_PREFIX_B + length };
+    }
+
+    slice->if_range = count == DOWNLOAD_MAX_HEADERS;
+    slice->request_id = http_submit("GET", download.url, headers, count, NULL, 0, download_slice_done, slice);
+    if (slice->request_id == 0) return false;
+
+    slice->state = DOWNLOAD_SLICE_IN_FLIGHT;
+    uint32_t in_flight = 0;
+    for (uint32_t i = 0 ; i < DOWNLOAD_MAX_WINDOW ; ++i) {
+        if (download.slices[i].state == DOWNLOAD_SLICE_IN_FLIGHT) in_flight++;
+    }
+
+    if (in_flight > download_stats.max_in_flight) download_stats.max_in_flight = in_flight;
+    return true;
+}
+
+
+/**
+ * @brief Take in a slice's response. Called on the HTTP engine task.
+ *
+ * @param response: The request's outcome.
+ * @param context:  The slice.
+ */
+static void download_slice_done(const HttpResponse* response, void* context) {
+
+    DownloadSlice* slice = (DownloadSlice*)context;
+    if (slice->state == DOWNLOAD_SLICE_STALE) {
+        slice->state = DOWNLOAD_SLICE_FREE;
+        return;
+    }
+
+    // The slice is done with unless it is queued again or held below
+    slice->state = DOWNLOAD_SLICE_FREE;
+    DownloadProgress* progress = &download.progress;
+    if (response->status != MV_STATUS_OKAY) {
+        download_retry(slice, "request failed");
+        return;
+    }
+
+    if (response->result == MV_HTTPRESULT_RESPONSETOOLARGE) {
+        // The server sent more than the slice. Without If-Range, it
+        // ignores ranges; with it, the resource may have changed
+        if (!slice->if_range) {
+            download_finish(DOWNLOAD_RANGE_UNSUPPORTED);
+        } else {
+            download_stats.restarts++;
+            download_restart("");
+        }
+
+        return;
+    }
+
+    if (response->result != MV_HTTPRESULT_OK) {
+        download_retry(slice, "no response");
+        return;
+    }
+
+    switch (response->status_code) {
+        case 206:
+            download_slice_arrived(response, slice);
+            return;
+
+        case 200:
+            // The whole resource, because the server ignores ranges, or
+            // the resource has changed since the earlier slices
+            if (slice->if_range) download_stats.restarts++;
+            download_restart(response->typed.etag != NULL ? response->typed.etag : "");
+            download_take_digest(response);
+            slice->offset = 0;
+            slice->length = response->body_length;
+            download.next_offset = slice->length;
+            if (!download_deliver(response, slice)) return;
+            progress->total = response->body_length;
+            download_check_done();
+            return;
+
+        case 416:
+            // The resource is shorter than the progress so far
+            if (progress->total != DOWNLOAD_SIZE_UNKNOWN && progress->offset >= progress->total) {
+                download_check_done();
+            } else {
+                download_stats.restarts++;
+                download_restart("");
+            }
+
+            return;
+
+        default:
+            if (response->status_code >= 500 || response->status_code == 408 || response->status_code == 429) {
+                download_retry(slice, "server busy");
+            } else {
+                server_error("Download of %s refused: status %lu", download.url, response->status_code);
+                download_finish(DOWNLOAD_REFUSED);
+            }
+    }
+}
+
+
+/**
+ * @brief Take in a slice that has arrived: pass it to the sink if it is
+ *        next, with any held slices that follow it, or else hold it.
+ *
+ * @param response: The slice's response, a 206.
+ * @param slice:    The slice.
+ */
+static void download_slice_arrived(const HttpResponse* response, DownloadSlice* slice) {
+
+    DownloadProgress* progress = &download.progress;
+    uint32_t first = 0;
+    uint32_t total = DOWNLOAD_SIZE_UNKNOWN;
+    const char* content_range = http_find_header(response, "content-range");
+    if (content_range == NULL || !download_parse_range(content_range, &first, &total) || first != slice->offset) {
+        download_retry(slice, "bad Content-Range");
+        return;
+    }
+
+    // The first slice tells us the size, and so how many slices to request
+    if (progress->total == DOWNLOAD_SIZE_UNKNOWN && total != DOWNLOAD_SIZE_UNKNOWN) {
+        progress->total = total;
+        if (slice->offset + slice->length > total) slice->length = total > slice->offset ? total - slice->offset : 0;
+        download.next_offset = slice->offset + slice->length;
+    }
+
+    if (response->body_length != slice->length) {
+        download_retry(slice, "short slice");
+        return;
+    }
+
+    if (progress->etag[0] == '\0' && response->typed.etag != NULL && strlen(response->typed.etag) <= HTTP_MAX_ETAG_LEN) {
+        strcpy(progress->etag, response->typed.etag);
+    }
+
+    download_take_digest(response);
+
+    download.retries = 0;
+    if (slice->offset != progress->offset) {
+        // Keep it in its channel until the slices before it have gone.
+        // Range responses aren't cached, so they can always be held
+        if (!http_hold(response)) {
+            download_retry(slice, "could not hold");
+            return;
+        }
+
+        slice->request_id = response->request_id;
+        slice->state = DOWNLOAD_SLICE_HELD;
+        download_stats.reordered++;
+        return;
+    }
+
+    if (!download_deliver(response, slice)) return;
+    download_deliver_held();
+    download_check_done();
+}
+
+
+/**
+ * @brief Stream a slice to the sink, and advance the progress past it if
+ *        it all arrived.
+ *
+ * @param response: The slice's response.
+ * @param slice:    The slice.
+ *
+ * @returns `true` if the slice was taken, or `false` if it failed and it
+ *          has been retried or the download ended.
+ */
+static bool download_deliver(const HttpResponse* response, DownloadSlice* slice) {
+
+    // A slice that fails part way is sent again from its start, so the
+    // hash goes back to where it was
+    DigestSha256 sha = download.progress.sha;
+    download.position = slice->offset;
+    download.sink_failed = false;
+    if (http_stream_body(response, download_feed, NULL) != MV_STATUS_OKAY) {
+        download.progress.sha = sha;
+        download_retry(slice, "body read failed");
+        return false;
+    }
+
+    if (download.sink_failed) {
+        server_error("Download of %s stopped by its sink at %lu bytes", download.url, download.position);
+        download_finish(DOWNLOAD_SINK_FAILED);
+        return false;
+    }
+
+    slice->state = DOWNLOAD_SLICE_FREE;
+    download.progress.offset = slice->offset + response->body_length;
+    download_stats.slices++;
+    download_stats.bytes += response->body_length;
+
+    if (download.progress.total != DOWNLOAD_SIZE_UNKNOWN) {
+        server_log("Download of %s: %lu of %lu bytes", download.url, download.progress.offset, download.progress.total);
+    }
+
+    if (download.progress.offset - download.saved_offset >= DOWNLOAD_CHECKPOINT_B) download_save();
+    return true;
+}
+
+
+/**
+ * @brief Pass held slices to the sink, and free their channels, for as
+ *        long as the next one is held.
+ */
+static void download_deliver_held(void) {
+
+    bool delivered = true;
+    while (delivered) {
+        delivered = false;
+        for (uint32_t i = 0 ; i < DOWNLOAD_MAX_WINDOW ; ++i) {
+            DownloadSlice* slice = &download.slices[i];
+            if (slice->state != DOWNLOAD_SLICE_HELD || slice->offset != download.progress.offset) continue;
+
+            const HttpResponse* response = http_get_response(slice->request_id);
+            delivered = response != NULL && download_deliver(response, slice);
+            http_release(slice->request_id);
+            if (response == NULL) download_retry(slice, "response lost");
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief Pass a chunk of a slice to the download's sink.
+ *
+ * @param data:    The chunk.
+ * @param length:  The size of the chunk in bytes.
+ * @param context: Not used.
+ *
+ * @returns `true` to read the next chunk, or `false` if the sink failed.
+ */
+static bool download_feed(const uint8_t* data, uint32_t length, void* context) {
+
+    if (!download.sink(download.position, data, length, download.context)) {
+        download.sink_failed = true;
+        return false;
+    }
+
+    digest_sha256_update(&download.progress.sha, data, length);
+    download.position += length;
+    return true;
+}
+
+
+/**
+ * @brief Keep the Repr-Digest a response gives for the whole resource, if
+ *        none is held yet. A 206's Repr-Digest is of the whole resource.
+ *
+ * @param response: The response.
+ */
+static void download_take_digest(const HttpResponse* response) {
+
+    DownloadProgress* progress = &download.progress;
+    const char* repr_digest = http_find_header(response, "repr-digest");
+    if (!progress->has_digest && repr_digest != NULL) {
+        progress->has_digest = digest_parse_sha256(repr_digest, progress->digest);
+    }
+}
+
+
+/**
+ * @brief End the download if the sink has had all of the resource, once
+ *        it has been checked against its digest.
+ */
+static void download_check_done(void) {
+
+    DownloadProgress* progress = &download.progress;
+    if (__atomic_load_n(&download_state, __ATOMIC_ACQUIRE) != DOWNLOAD_STATE_ACTIVE
+        || progress->total == DOWNLOAD_SIZE_UNKNOWN || progress->offset < progress->total) {
+        return;
+    }
+
+    const uint8_t* expected = download.has_manifest ? download.manifest : (progress->has_digest ? progress->digest : NULL);
+    if (expected != NULL) {
+        uint8_t digest[DIGEST_SHA256_SIZE_B];
+        digest_sha256_final(&progress->sha, digest);
+        if (!digest_equal(digest, expected, DIGEST_SHA256_SIZE_B)) {
+            // Drop the progress, so the next attempt starts afresh
+            server_error("Download of %s does not match its SHA-256", download.url);
+            flash_cache_remove(download.key);
+            download.saved_offset = progress->offset;
+            download_finish(DOWNLOAD_DIGEST_MISMATCH);
+            return;
+        }
+
+        download_stats.verified = true;
+    }
+
+    if (!download.sink(progress->total, NULL, 0, download.context)) {
+        download_finish(DOWNLOAD_SINK_FAILED);
+        return;
+    }
+
+    download_save();
+    download_finish(DOWNLOAD_OK);
+}
+
+
+/**
+ * @brief Drop the slices requested so far: free the channels of those
+ *        held, and mark those in flight to be dropped when they arrive.
+ *        Any pause before a retry ends.
+ */
+static void download_abandon(void) {
+
+    http_timer_stop(&download.resume);
+    download.paused = false;
+
+    for (uint32_t i = 0 ; i < DOWNLOAD_MAX_WINDOW ; ++i) {
+        DownloadSlice* slice = &download.slices[i];
+        switch (slice->state) {
+            case DOWNLOAD_SLICE_HELD:
+                http_release(slice->request_id);
+                slice->state = DOWNLOAD_SLICE_FREE;
+                break;
+            case DOWNLOAD_SLICE_IN_FLIGHT:
+                slice->state = DOWNLOAD_SLICE_STALE;
+                break;
+            case DOWNLOAD_SLICE_QUEUED:
+                slice->state = DOWNLOAD_SLICE_FREE;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+
+/**
+ * @brief Start the download again from the beginning.
+ *
+ * @param etag: The resource's new ETag, or an empty string.
+ */
+static void download_restart(const char* etag) {
+
+    DownloadProgress* progress = &download.progress;
+    server_log("Restarting download of %s", download.url);
+    download_abandon();
+    progress->offset = 0;
+    progress->total = DOWNLOAD_SIZE_UNKNOWN;
+    progress->etag[0] = '\0';
+    if (strlen(etag) <= HTTP_MAX_ETAG_LEN) strcpy(progress->etag, etag);
+    progress->has_digest = false;
+    digest_sha256_init(&progress->sha);
+
+    download.saved_offset = 0;
+    download.next_offset = 0;
+}
+
+
+/**
+ * @brief Request a failed slice again after a pause, unless slices have
+ *        failed too often in a row, in which case the download fails.
+ *
+ * @param slice:  The slice.
+ * @param reason: Why the slice failed, for the log.
+ */
+static void download_retry(DownloadSlice* slice, const char* reason) {
+
+    if (++download.retries > DOWNLOAD_MAX_RETRIES) {
+        server_error("Download of %s failed at %lu bytes: %s", download.url, download.progress.offset, reason);
+        download_finish(DOWNLOAD_FAILED);
+        return;
+    }
+
+    download_stats.retries++;
+    server_log("Download slice at %lu bytes failed (%s). Retry %lu of %lu",
+               slice->offset, reason, download.retries, (uint32_t)DOWNLOAD_MAX_RETRIES);
+    slice->state = DOWNLOAD_SLICE_QUEUED;
+    download_pause();
+}
+
+
+/**
+ * @brief Hold off requesting slices for DOWNLOAD_RETRY_DELAY_MS.
+ */
+static void download_pause(void) {
+
+    download.paused = true;
+    http_timer_start(&download.resume, DOWNLOAD_RETRY_DELAY_MS, 0);
+}
+
+
+/**
+ * @brief Let slices be requested again. Called by the HTTP engine's timers.
+ *
+ * @param timer:   The download's resume timer.
+ * @param context: Not used.
+ */
+static void download_resume(TimerEntry* timer, void* context) {
+
+    download.paused = false;
+}
+
+
+/**
+ * @brief End the download, saving its progress so a failed one can be
+ *        resumed, and tell the client.
+ *
+ * @param result: How it ended.
+ */
+static void download_finish(DownloadResult result) {
+
+    download_abandon();
+    if (download.progress.offset != download.saved_offset) download_save();
+
+    if (result == DOWNLOAD_OK) {
+        server_log("Download of %s complete: %lu bytes%s. Slices: %lu (%lu reordered), retries: %lu, restarts: %lu, checkpoints: %lu",
+                   download.url, download.progress.offset, download_stats.verified ? ", SHA-256 verified" : "",
+                   download_stats.slices, download_stats.reordered, download_stats.retries, download_stats.restarts,
+                   download_stats.checkpoints);
+    }
+
+    // The client may start another download from its callback
+    __atomic_store_n(&download_state, DOWNLOAD_STATE_IDLE, __ATOMIC_RELEASE);
+    if (download.callback != NULL) download.callback(result, download.progress.offset, download.context);
+}
+
+
+/**
+ * @brief Save the download's progress in the flash cache.
+ */
+static void download_save(void) {
+
+    if (flash_cache_begin(download.key, sizeof(DownloadProgress))
+        && flash_cache_write(&download.progress, sizeof(DownloadProgress))
+        && flash_cache_commit()) {
+        download.saved_offset = download.progress.offset;
+        download_stats.checkpoints++;
+        return;
+    }
+
+    flash_cache_abort();
+    server_error("Could not save download progress");
+}
+
+
+/**
+ * @brief Parse a Content-Range header value: `bytes first-last/total`,
+ *        where the total may be `*`.
+ *
+ * @param value: The header's value.
+ * @param first: Receives the offset of the first byte.
+ * @param total: Receives the resource's size, or `DOWNLOAD_SIZE_UNKNOWN`.
+ *
+ * @returns `true` if the value is valid, otherwise `false`.
+ */
+static bool download_parse_range(const char* value, uint32_t* first, uint32_t* total) {
+
+    if (strncasecmp(value, "bytes ", 6) != 0) return false;
+
+    char* end = NULL;
+    *first = (uint32_t)strtoul(value + 6, &end, 10);
+    if (end == value + 6 || *end != '-') return false;
+
+    const char* slash = strchr(end, '/');
+    if (slash == NULL) return false;
+
+    if (slash[1] == '*') {
+        *total = DOWNLOAD_SIZE_UNKNOWN;
+        return true;
+    }
+
+    *total = (uint32_t)strtoul(slash + 1, &end, 10);
+    return end != slash + 1;
+}
+
+
+/**
+ * @brief Write a quad-word to the download region, erasing its page first
+ *        if it is the first in it. A quad-word that already holds the data
+ *        is left alone.
+ *
+ * @param offset: The offset in the region, a multiple of 16.
+ * @param data:   The data.
+ *
+ * @returns `true` if the data is in flash, otherwise `false`.
+ */
+static bool download_flash_program(uint32_t offset, const uint8_t* data) {
+
+    HAL_StatusTypeDef status = HAL_FLASH_Unlock();
+    if (status == HAL_OK && offset % FLASH_CACHE_PAGE_SIZE_B == 0) {
+        uint32_t flash_page = DOWNLOAD_FLASH_FIRST_PAGE + offset / FLASH_CACHE_PAGE_SIZE_B;
+        FLASH_EraseInitTypeDef erase = {
+            .TypeErase = FLASH_TYPEERASE_PAGES,
+            .Banks = flash_page < FLASH_PAGE_NB ? FLASH_BANK_1 : FLASH_BANK_2,
+            .Page = flash_page % FLASH_PAGE_NB,
+            .NbPages = 1
+        };
+
+        uint32_t page_error = 0;
+        status = HAL_FLASHEx_Erase(&erase, &page_error);
+    }
+
+    const uint8_t* address = (const uint8_t*)download_flash_address(offset);
+    if (status == HAL_OK && memcmp(address, data, DOWNLOAD_FLASH_QUAD_WORD_B) != 0) {
+        // Flash can only be programmed once between erases
+        for (uint32_t i = 0 ; i < DOWNLOAD_FLASH_QUAD_WORD_B ; ++i) {
+            if (address[i] != 0xFF) status = HAL_ERROR;
+        }
+
+        if (status == HAL_OK) status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, (uintptr_t)address, (uintptr_t)data);
+    }
+
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
+
+
+/**
+ * @brief Get the address of a location in the download region.
+ *
+ * @param offset: The offset from the start of the region.
+ *
+ * @returns The address.
+ */
+static uintptr_t download_flash_address(uint32_t offset) {
+
+    return FLASH_BASE + DOWNLOAD_FLASH_FIRST_PAGE * FLASH_CACHE_PAGE_SIZE_B + offset;
+}
@@ -0,0 +1,146 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _DOWNLOAD_H_
+#define _DOWNLOAD_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Body bytes requested per slice. The rest of the channel's receive
+// buffer holds the response's headers
+#define     DOWNLOAD_SLICE_SIZE_B       2048
+
+// Slices kept in flight at once, each on its own channel. One that
+// arrives early stays in its channel until the slices before it have
+// gone to the sink, so up to this many channels are taken. Can be
+// changed while a download runs with `download_set_window()`
+#ifndef DOWNLOAD_WINDOW
+#define     DOWNLOAD_WINDOW             2
+#endif
+#define     DOWNLOAD_MAX_WINDOW         HTTP_CHANNEL_POOL_SIZE
+
+// Progress is saved in the flash cache at least this often, and the
+// download resumes from the last save after a restart
+#define     DOWNLOAD_CHECKPOINT_B       8192
+
+// A slice that fails is retried after a pause, this many times in a row
+#define     DOWNLOAD_MAX_RETRIES        5
+#define     DOWNLOAD_RETRY_DELAY_MS     2000
+
+// The region `download_flash_sink()` writes to: the 32 pages below the
+// flash cache's. Pages are numbered across both banks
+#define     DOWNLOAD_FLASH_FIRST_PAGE   220
+#define     DOWNLOAD_FLASH_PAGES        32
+#define     DOWNLOAD_FLASH_SIZE_B       (DOWNLOAD_FLASH_PAGES * FLASH_CACHE_PAGE_SIZE_B)
+
+// Range, Accept-Encoding and If-Range. A slice's If-Range header holds
+// the resource's ETag at its longest
+#define     DOWNLOAD_MAX_HEADERS        3
+#define     DOWNLOAD_IF_RANGE_PREFIX_B  (sizeof("If-Range: ") - 1)
+#define     DOWNLOAD_IF_RANGE_SIZE_B    (DOWNLOAD_IF_RANGE_PREFIX_B + HTTP_MAX_ETAG_LEN)
+
+// `total` while a download's size is not yet known
+#define     DOWNLOAD_SIZE_UNKNOWN       0xFFFFFFFF
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+typedef enum {
+    DOWNLOAD_OK = 0,
+    DOWNLOAD_FAILED,
+    DOWNLOAD_REFUSED,
+    DOWNLOAD_RANGE_UNSUPPORTED,
+    DOWNLOAD_SINK_FAILED,
+    DOWNLOAD_DIGEST_MISMATCH
+} DownloadResult;
+
+// Receives the resource at its offset, in order. A resumed download starts
+// again from its last saved offset, so data already received may be sent
+// again. When the download completes, the sink is called once more with
+// no data. Return `false` to fail the download
+typedef bool (*DownloadSink)(uint32_t offset, const uint8_t* data, uint32_t length, void* context);
+
+// Called on the HTTP engine task when the download ends
+typedef void (*DownloadCallback)(DownloadResult result, uint32_t length, void* context);
+
+// A slice of the resource, from being requested to reaching the sink.
+// A stale slice belongs to a download that has since restarted or ended,
+// and is dropped when its response comes in
+typedef enum {
+    DOWNLOAD_SLICE_FREE = 0,
+    DOWNLOAD_SLICE_QUEUED,
+    DOWNLOAD_SLICE_IN_FLIGHT,
+    DOWNLOAD_SLICE_HELD,
+    DOWNLOAD_SLICE_STALE
+} DownloadSliceState;
+
+typedef struct {
+    uint32_t            offset;
+    uint32_t            length;
+    uint32_t            request_id;
+    DownloadSliceState  state;
+    bool                if_range;
+    struct MvHttpHeader headers[DOWNLOAD_MAX_HEADERS];
+    char                range[48];
+    char                validator[DOWNLOAD_IF_RANGE_SIZE_B];
+} DownloadSlice;
+
+// What is kept in the flash cache: enough to resume, to tell whether the
+// resource has changed since, and to go on hashing it from where it was.
+// `digest` is the server's Repr-Digest, if it sent one
+typedef struct {
+    uint32_t        url_hash;
+    uint32_t        offset;
+    uint32_t        total;
+    char            etag[HTTP_MAX_ETAG_LEN + 1];
+    bool            has_digest;
+    uint8_t         digest[DIGEST_SHA256_SIZE_B];
+    DigestSha256    sha;
+} DownloadProgress;
+
+// Counters for the current or last download. A reordered slice arrived
+// before an earlier one and was held in its channel
+typedef struct {
+    uint32_t    slices;
+    uint32_t    reordered;
+    uint32_t    max_in_flight;
+    uint32_t    retries;
+    uint32_t    restarts;
+    uint32_t    checkpoints;
+    uint32_t    resumed_from;
+    uint64_t    bytes;
+    bool        verified;
+} DownloadStats;
+
+
+/*
+ * PROTOTYPES
+ */
+bool                    download_start(const char* url, const uint8_t* digest, DownloadSink sink, DownloadCallback callback, void* context);
+bool                    download_active(void);
+void                    download_service(void);
+void                    download_set_window(uint32_t window);
+const DownloadStats*    download_get_stats(void);
+bool                    download_flash_sink(uint32_t offset, const uint8_t* data, uint32_t length, void* context);
+const uint8_t*          download_flash_data(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _DOWNLOAD_H_
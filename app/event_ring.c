@@ -0,0 +1,142 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "event_ring.h"
+
+
+/*
+ * NOTE Notification ISRs copy every record Microvisor has written into a
+ *      ring, clearing each slot in the notification center as they go, and
+ *      a task takes the records from the ring a batch at a time. Events
+ *      that arrive back to back stay separate, in order, each with its own
+ *      tag and timestamp, rather than being merged into flags.
+ *
+ *      There are no locks and interrupts stay enabled: the ISR only moves
+ *      `head` and the task only moves `tail`. Each publishes its index with
+ *      a release store after touching the records, and reads the other's
+ *      with an acquire load. When the ring is full the newest record is
+ *      dropped and counted, as the task still has to see the older ones.
+ */
+
+
+/**
+ * @brief Set up an empty ring.
+ *
+ * @param ring:    The ring.
+ * @param records: Storage for its records.
+ * @param size:    The number of records `records` holds. Must be a power of two.
+ */
+void event_ring_init(EventRing* ring, EventRecord* records, uint32_t size) {
+
+    ring->records = records;
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->stats = (EventRingStats){ 0 };
+}
+
+
+/**
+ * @brief Add a record to the ring. Producer only.
+ *
+ * @param ring:   The ring.
+ * @param record: The record to copy in.
+ *
+ * @returns `true` if the record was added, `false` if the ring was full.
+ */
+bool event_ring_push(EventRing* ring, const EventRecord* record) {
+
+    uint32_t head = ring->head;
+    uint32_t waiting = head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (waiting > ring->mask) {
+        ring->stats.overruns++;
+        return false;
+    }
+
+    ring->records[head & ring->mask] = *record;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    ring->stats.records++;
+    if (waiting + 1 > ring->stats.high_water) ring->stats.high_water = waiting + 1;
+    return true;
+}
+
+
+/**
+ * @brief Take up to `max` records from the ring, oldest first. Consumer only.
+ *
+ * @param ring:    The ring.
+ * @param records: Where to copy the records.
+ * @param max:     The most records to take.
+ *
+ * @returns The number of records taken.
+ */
+uint32_t event_ring_pop(EventRing* ring, EventRecord* records, uint32_t max) {
+
+    uint32_t tail = ring->tail;
+    uint32_t count = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+    if (count > max) count = max;
+
+    for (uint32_t i = 0 ; i < count ; ++i) {
+        records[i] = ring->records[(tail + i) & ring->mask];
+    }
+
+    __atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+
+/**
+ * @brief The number of records waiting in the ring.
+ *
+ * @param ring: The ring.
+ *
+ * @returns The count.
+ */
+uint32_t event_ring_count(const EventRing* ring) {
+
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * @brief Move every record written to a notification center into the ring,
+ *        clearing each slot so it can be told apart from a new record.
+ *        For the center's ISR, which is the ring's producer.
+ *
+ * See https://www.twilio.com/docs/iot/microvisor/microvisor-notifications#buffer-overruns
+ *
+ * @param ring:   The ring.
+ * @param center: The notification center's records.
+ * @param size:   The number of records in the center.
+ * @param index:  The slot Microvisor will write next. Advanced past the
+ *                records taken.
+ *
+ * @returns The number of records taken from the center.
+ */
+uint32_t event_ring_drain(EventRing* ring, volatile struct MvNotification* center, uint32_t size, uint32_t* index) {
+
+    uint32_t count = 0;
+    while (count < size) {
+        volatile struct MvNotification* notification = &center[*index];
+        uint32_t event_type = (uint32_t)__atomic_load_n(&notification->event_type, __ATOMIC_ACQUIRE);
+        if (event_type == 0) break;
+
+        EventRecord record = { notification->microseconds, event_type, notification->tag };
+        event_ring_push(ring, &record);
+
+        notification->event_type = 0;
+        *index = (*index + 1) % size;
+        count++;
+    }
+
+    ring->stats.drains++;
+    if (count > ring->stats.max_batch) ring->stats.max_batch = count;
+    if (count == size) ring->stats.center_full++;
+    return count;
+}
@@ -0,0 +1,77 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _EVENT_RING_H_
+#define _EVENT_RING_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "mv_syscalls.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+// A notification record, copied out of a notification center
+typedef struct {
+    uint64_t    microseconds;
+    uint32_t    event_type;
+    uint32_t    tag;
+} EventRecord;
+
+// Written by the producer only. `overruns` counts records dropped because
+// the ring was full. `center_full` counts drains that found every slot of
+// the notification center written, so Microvisor may have overwritten
+// records before they were read: a sign the center is too small
+typedef struct {
+    uint32_t    records;
+    uint32_t    overruns;
+    uint32_t    high_water;
+    uint32_t    drains;
+    uint32_t    max_batch;
+    uint32_t    center_full;
+} EventRingStats;
+
+// A lock-free queue for one producer, such as an ISR, and one consumer
+// task. `head` is written only by the producer and `tail` only by the
+// consumer. Both run freely and are masked to index `records`, whose
+// length must be a power of two
+typedef struct {
+    EventRecord*        records;
+    uint32_t            mask;
+    volatile uint32_t   head;
+    volatile uint32_t   tail;
+    EventRingStats      stats;
+} EventRing;
+
+
+/*
+ * PROTOTYPES
+ */
+void        event_ring_init(EventRing* ring, EventRecord* records, uint32_t size);
+bool        event_ring_push(EventRing* ring, const EventRecord* record);
+uint32_t    event_ring_pop(EventRing* ring, EventRecord* records, uint32_t max);
+uint32_t    event_ring_count(const EventRing* ring);
+uint32_t    event_ring_drain(EventRing* ring, volatile struct MvNotification* center, uint32_t size, uint32_t* index);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _EVENT_RING_H_
@@ -0,0 +1,738 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <string.h>
+#include "stm32u5xx_hal.h"
+#include "flash_cache.h"
+#include "digest.h"
+
+
+/*
+ * NOTE A log-structured store of keyed records in a ring of flash pages.
+ *      Records are only ever appended, at the head page; a newer record
+ *      for a key supersedes the older one, and a tombstone deletes it.
+ *      When the head page fills, the next page in the ring becomes the
+ *      head, so every page is erased in turn and wear is spread evenly.
+ *      One page is always kept erased: when taking the head leaves none,
+ *      the live records of the oldest page are copied to the new head
+ *      and the oldest page is erased.
+ *
+ *      Each page starts with a header holding its erase count, written as
+ *      soon as it's erased, and its place in the ring, written when it
+ *      becomes the head. Each record has a header, written first, and a
+ *      trailer carrying a CRC of its key, length and data, written last.
+ *      A record whose write was cut short has no valid trailer, and is
+ *      ignored when `flash_cache_init()` rebuilds the RAM index at boot.
+ *
+ *      Flash is programmed a quad-word (16 bytes) at a time, so headers,
+ *      data and trailers are quad-word aligned. Data is read in place,
+ *      through the memory-mapped flash.
+ *
+ *      This module uses only the HAL's flash calls, so it can be built
+ *      for the host too, against the file-backed flash in `sim/src/flash.c`.
+ *      It is not thread safe: use it from one task.
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     FLASH_CACHE_PAGE_MAGIC          0x4346564D
+#define     FLASH_CACHE_RECORD_MAGIC        0x44524352
+#define     FLASH_CACHE_TOMBSTONE_MAGIC     0x424D4F54
+#define     FLASH_CACHE_COMMIT_MAGIC        0x54494D43
+#define     FLASH_CACHE_ERASED              0xFFFFFFFF
+
+#define     FLASH_QUAD_WORD_B               16
+
+// Space for records in a page, after its header
+#define     FLASH_CACHE_PAGE_DATA_B         (FLASH_CACHE_PAGE_SIZE_B - sizeof(FlashCachePageHeader))
+
+// Live data is kept to two pages short of the region, so copying the
+// oldest page's live records forward always frees some space
+#define     FLASH_CACHE_LIVE_LIMIT_B        ((FLASH_CACHE_PAGES - 2) * FLASH_CACHE_PAGE_DATA_B)
+
+
+/*
+ * TYPES
+ */
+// Two quad-words: the first is written when the page is erased,
+// the second when the page joins the log
+typedef struct {
+    uint32_t    magic;
+    uint32_t    erase_count;
+    uint32_t    check;
+    uint32_t    reserved;
+    uint32_t    sequence;
+    uint32_t    sequence_check;
+    uint32_t    reserved_2[2];
+} FlashCachePageHeader;
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    key;
+    uint32_t    length;
+    uint32_t    check;
+} FlashCacheRecordHeader;
+
+typedef struct {
+    uint32_t    crc;
+    uint32_t    magic;
+    uint32_t    reserved[2];
+} FlashCacheRecordTrailer;
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static uintptr_t    flash_cache_address(uint32_t offset);
+static uint32_t     flash_cache_record_size(uint32_t length);
+static bool         flash_cache_is_erased(uint32_t offset, uint32_t length);
+static bool         flash_cache_program(uint32_t offset, const void* data, uint32_t length);
+static bool         flash_cache_erase(uint32_t page);
+static bool         flash_cache_format(uint32_t page);
+static bool         flash_cache_open_record(uint32_t magic, uint32_t key, uint32_t length);
+static bool         flash_cache_advance(void);
+static bool         flash_cache_reclaim(void);
+static bool         flash_cache_scan_page(uint32_t page);
+static int32_t      flash_cache_index_find(uint32_t key);
+static void         flash_cache_index_put(uint32_t key, uint32_t offset, uint32_t length);
+static void         flash_cache_index_remove(uint32_t key);
+static void         flash_cache_update_wear(void);
+
+
+/*
+ * GLOBALS
+ */
+static struct {
+    uint32_t    sequence;
+    uint32_t    erase_count;
+    bool        in_use;
+} flash_cache_pages[FLASH_CACHE_PAGES];
+
+// The newest and oldest pages in the log, and where the next record goes
+static uint32_t         flash_cache_head = 0;
+static uint32_t         flash_cache_tail = 0;
+static uint32_t         flash_cache_write_offset = 0;
+
+static FlashCacheEntry  flash_cache_index[FLASH_CACHE_MAX_ENTRIES];
+
+// The record being written
+static struct {
+    bool        open;
+    uint32_t    magic;
+    uint32_t    key;
+    uint32_t    length;
+    uint32_t    header_offset;
+    uint32_t    offset;
+    uint32_t    written;
+    uint32_t    crc;
+    uint32_t    pending_length;
+    uint8_t     pending[FLASH_QUAD_WORD_B] __attribute__((aligned(4)));
+} flash_cache_record;
+
+static FlashCacheStats  flash_cache_stats = { 0 };
+
+
+/**
+ * @brief Read the region and build the RAM index of its records.
+ *
+ * Pages that are neither erased nor validly formatted, such as one whose
+ * erase was interrupted, are erased. Call once, before any other call.
+ *
+ * @returns `true` if the cache is ready, otherwise `false`.
+ */
+bool flash_cache_init(void) {
+
+    memset((void *)flash_cache_index, 0x00, sizeof(flash_cache_index));
+    memset((void *)&flash_cache_stats, 0x00, sizeof(flash_cache_stats));
+    memset((void *)&flash_cache_record, 0x00, sizeof(flash_cache_record));
+
+    int32_t head = -1;
+    int32_t tail = -1;
+    for (uint32_t page = 0 ; page < FLASH_CACHE_PAGES ; ++page) {
+        const FlashCachePageHeader* header = (const FlashCachePageHeader*)flash_cache_address(page * FLASH_CACHE_PAGE_SIZE_B);
+        flash_cache_pages[page].in_use = false;
+        flash_cache_pages[page].erase_count = 0;
+
+        if (header->magic == FLASH_CACHE_PAGE_MAGIC && header->check == ~(header->magic ^ header->erase_count)) {
+            flash_cache_pages[page].erase_count = header->erase_count;
+            if (header->sequence_check == ~header->sequence) {
+                flash_cache_pages[page].in_use = true;
+                flash_cache_pages[page].sequence = header->sequence;
+                if (head < 0 || header->sequence > flash_cache_pages[head].sequence) head = (int32_t)page;
+                if (tail < 0 || header->sequence < flash_cache_pages[tail].sequence) tail = (int32_t)page;
+            } else if (header->sequence != FLASH_CACHE_ERASED || header->sequence_check != FLASH_CACHE_ERASED) {
+                // The page's sequence number was never completely written
+                if (!flash_cache_erase(page)) return false;
+            }
+        } else if (flash_cache_is_erased(page * FLASH_CACHE_PAGE_SIZE_B, FLASH_CACHE_PAGE_SIZE_B)) {
+            // A page that has never been used
+            if (!flash_cache_format(page)) return false;
+        } else if (!flash_cache_erase(page)) {
+            return false;
+        }
+    }
+
+    flash_cache_update_wear();
+    if (head < 0) {
+        // An empty region: start the log in the first page
+        flash_cache_head = FLASH_CACHE_PAGES - 1;
+        flash_cache_pages[flash_cache_head].sequence = 0;
+        flash_cache_tail = 0;
+        return flash_cache_advance();
+    }
+
+    // Replay the pages oldest first, so later records supersede earlier ones.
+    // Pages join the log in ring order, so the log runs from tail to head
+    flash_cache_head = (uint32_t)head;
+    flash_cache_tail = (uint32_t)tail;
+    for (uint32_t page = flash_cache_tail ; ; page = (page + 1) % FLASH_CACHE_PAGES) {
+        if (flash_cache_pages[page].in_use && !flash_cache_scan_page(page)) return false;
+        if (page == flash_cache_head) break;
+    }
+
+    // Restore the spare page if we restarted mid-way through reclaiming one
+    uint32_t next = (flash_cache_head + 1) % FLASH_CACHE_PAGES;
+    return flash_cache_pages[next].in_use ? flash_cache_reclaim() : true;
+}
+
+
+/**
+ * @brief Start writing a record. Its data follows in calls to
+ *        `flash_cache_write()`, then `flash_cache_commit()` completes it.
+ *
+ * @param key:    The record's key. Any earlier record for it is
+ *                superseded once this one is committed.
+ * @param length: The size of the record's data in bytes.
+ *
+ * @returns `true` if the record has been started, otherwise `false`.
+ */
+bool flash_cache_begin(uint32_t key, uint32_t length) {
+
+    return flash_cache_open_record(FLASH_CACHE_RECORD_MAGIC, key, length);
+}
+
+
+/**
+ * @brief Add data to the record being written.
+ *
+ * @param data:   The data.
+ * @param length: The size of the data in bytes.
+ *
+ * @returns `true` if the data was written, otherwise `false`,
+ *          in which case the record is abandoned.
+ */
+bool flash_cache_write(const void* data, uint32_t length) {
+
+    if (!flash_cache_record.open) return false;
+    if (length > flash_cache_record.length - flash_cache_record.written) {
+        flash_cache_abort();
+        return false;
+    }
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    flash_cache_record.crc = digest_crc32(flash_cache_record.crc, bytes, length);
+    flash_cache_record.written += length;
+
+    while (length > 0) {
+        uint32_t space = FLASH_QUAD_WORD_B - flash_cache_record.pending_length;
+        uint32_t size = length < space ? length : space;
+        memcpy(&flash_cache_record.pending[flash_cache_record.pending_length], bytes, size);
+        flash_cache_record.pending_length += size;
+        bytes += size;
+        length -= size;
+
+        if (flash_cache_record.pending_length == FLASH_QUAD_WORD_B) {
+            if (!flash_cache_program(flash_cache_record.offset, flash_cache_record.pending, FLASH_QUAD_WORD_B)) {
+                flash_cache_abort();
+                return false;
+            }
+
+            flash_cache_record.offset += FLASH_QUAD_WORD_B;
+            flash_cache_record.pending_length = 0;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Complete the record being written and add it to the index.
+ *
+ * @returns `true` if the record is stored, otherwise `false`.
+ */
+bool flash_cache_commit(void) {
+
+    if (!flash_cache_record.open || flash_cache_record.written != flash_cache_record.length) {
+        flash_cache_abort();
+        return false;
+    }
+
+    // Pad the last of the data out to a quad-word
+    if (flash_cache_record.pending_length > 0) {
+        memset(&flash_cache_record.pending[flash_cache_record.pending_length], 0xFF, FLASH_QUAD_WORD_B - flash_cache_record.pending_length);
+        if (!flash_cache_program(flash_cache_record.offset, flash_cache_record.pending, FLASH_QUAD_WORD_B)) {
+            flash_cache_abort();
+            return false;
+        }
+
+        flash_cache_record.offset += FLASH_QUAD_WORD_B;
+    }
+
+    const FlashCacheRecordTrailer trailer = {
+        .crc = flash_cache_record.crc,
+        .magic = FLASH_CACHE_COMMIT_MAGIC,
+        .reserved = { FLASH_CACHE_ERASED, FLASH_CACHE_ERASED }
+    };
+
+    flash_cache_record.open = false;
+    if (!flash_cache_program(flash_cache_record.offset, &trailer, sizeof(trailer))) return false;
+
+    if (flash_cache_record.magic == FLASH_CACHE_TOMBSTONE_MAGIC) {
+        flash_cache_index_remove(flash_cache_record.key);
+    } else {
+        flash_cache_index_put(flash_cache_record.key, flash_cache_record.header_offset, flash_cache_record.length);
+    }
+
+    flash_cache_stats.writes++;
+    return true;
+}
+
+
+/**
+ * @brief Abandon the record being written. Its space is not reused
+ *        until its page is reclaimed, and any earlier record for its
+ *        key remains current.
+ */
+void flash_cache_abort(void) {
+
+    flash_cache_record.open = false;
+}
+
+
+/**
+ * @brief Delete a key's record.
+ *
+ * @param key: The key.
+ *
+ * @returns `true` if the key has no record, otherwise `false`.
+ */
+bool flash_cache_remove(uint32_t key) {
+
+    if (flash_cache_index_find(key) < 0) return true;
+    return flash_cache_open_record(FLASH_CACHE_TOMBSTONE_MAGIC, key, 0) && flash_cache_commit();
+}
+
+
+/**
+ * @brief Find a key's record.
+ *
+ * The data is read in place, so it is valid only until the next
+ * record is written.
+ *
+ * @param key:    The key.
+ * @param length: Receives the size of the record's data in bytes.
+ *
+ * @returns The record's data, or `NULL` if the key has no record.
+ */
+const uint8_t* flash_cache_find(uint32_t key, uint32_t* length) {
+
+    int32_t index = flash_cache_index_find(key);
+    if (index < 0) return NULL;
+
+    *length = flash_cache_index[index].length;
+    return (const uint8_t*)flash_cache_address(flash_cache_index[index].offset + sizeof(FlashCacheRecordHeader));
+}
+
+
+/**
+ * @brief Get the key of one of the stored records.
+ *
+ * @param index: The record's place in the index.
+ * @param key:   Receives the key.
+ *
+ * @returns `true` if there is such a record, otherwise `false`.
+ */
+bool flash_cache_get_key(uint32_t index, uint32_t* key) {
+
+    if (index >= flash_cache_stats.records) return false;
+    *key = flash_cache_index[index].key;
+    return true;
+}
+
+
+/**
+ * @brief Provide the cache counters.
+ *
+ * @returns The counters.
+ */
+const FlashCacheStats* flash_cache_get_stats(void) {
+
+    return &flash_cache_stats;
+}
+
+
+/**
+ * @brief Get the address of a location in the region.
+ *
+ * @param offset: The offset from the start of the region.
+ *
+ * @returns The address.
+ */
+static uintptr_t flash_cache_address(uint32_t offset) {
+
+    return FLASH_BASE + FLASH_CACHE_FIRST_PAGE * FLASH_CACHE_PAGE_SIZE_B + offset;
+}
+
+
+/**
+ * @brief The flash a record takes, including its header and trailer.
+ *
+ * @param length: The size of the record's data in bytes.
+ *
+ * @returns The size in bytes.
+ */
+static uint32_t flash_cache_record_size(uint32_t length) {
+
+    uint32_t data_size = (length + FLASH_QUAD_WORD_B - 1) & ~(FLASH_QUAD_WORD_B - 1);
+    return sizeof(FlashCacheRecordHeader) + data_size + sizeof(FlashCacheRecordTrailer);
+}
+
+
+/**
+ * @brief Check whether part of the region is erased.
+ *
+ * @param offset: The offset from the start of the region.
+ * @param length: The size of the part in bytes, a multiple of 4.
+ *
+ * @returns `true` if it is erased, otherwise `false`.
+ */
+static bool flash_cache_is_erased(uint32_t offset, uint32_t length) {
+
+    const uint32_t* words = (const uint32_t*)flash_cache_address(offset);
+    for (uint32_t i = 0 ; i < length / 4 ; ++i) {
+        if (words[i] != FLASH_CACHE_ERASED) return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Program erased flash.
+ *
+ * @param offset: The offset from the start of the region, quad-word aligned.
+ * @param data:   The data. Must be word aligned.
+ * @param length: The size of the data in bytes, a multiple of a quad-word.
+ *
+ * @returns `true` if the flash was programmed, otherwise `false`.
+ */
+static bool flash_cache_program(uint32_t offset, const void* data, uint32_t length) {
+
+    HAL_StatusTypeDef status = HAL_FLASH_Unlock();
+    for (uint32_t i = 0 ; i < length && status == HAL_OK ; i += FLASH_QUAD_WORD_B) {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, flash_cache_address(offset + i), (uintptr_t)data + i);
+    }
+
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
+
+
+/**
+ * @brief Erase a page and record its erase count in its header.
+ *
+ * @param page: The page's index in the region.
+ *
+ * @returns `true` if the page was erased, otherwise `false`.
+ */
+static bool flash_cache_erase(uint32_t page) {
+
+    uint32_t flash_page = FLASH_CACHE_FIRST_PAGE + page;
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_PAGES,
+        .Banks = flash_page < FLASH_PAGE_NB ? FLASH_BANK_1 : FLASH_BANK_2,
+        .Page = flash_page % FLASH_PAGE_NB,
+        .NbPages = 1
+    };
+
+    uint32_t page_error = 0;
+    HAL_StatusTypeDef status = HAL_FLASH_Unlock();
+    if (status == HAL_OK) status = HAL_FLASHEx_Erase(&erase, &page_error);
+    HAL_FLASH_Lock();
+    if (status != HAL_OK) return false;
+
+    flash_cache_stats.erases++;
+    flash_cache_pages[page].in_use = false;
+    flash_cache_pages[page].erase_count++;
+    return flash_cache_format(page);
+}
+
+
+/**
+ * @brief Write the first part of an erased page's header: its erase count.
+ *
+ * @param page: The page's index in the region.
+ *
+ * @returns `true` if the header was written, otherwise `false`.
+ */
+static bool flash_cache_format(uint32_t page) {
+
+    const FlashCachePageHeader header = {
+        .magic = FLASH_CACHE_PAGE_MAGIC,
+        .erase_count = flash_cache_pages[page].erase_count,
+        .check = ~(FLASH_CACHE_PAGE_MAGIC ^ flash_cache_pages[page].erase_count),
+        .reserved = FLASH_CACHE_ERASED
+    };
+
+    return flash_cache_program(page * FLASH_CACHE_PAGE_SIZE_B, &header, FLASH_QUAD_WORD_B);
+}
+
+
+/**
+ * @brief Reserve space for a record at the head of the log and write its header.
+ *
+ * @param magic:  The kind of record.
+ * @param key:    The record's key.
+ * @param length: The size of the record's data in bytes.
+ *
+ * @returns `true` if the record has been started, otherwise `false`.
+ */
+static bool flash_cache_open_record(uint32_t magic, uint32_t key, uint32_t length) {
+
+    if (flash_cache_record.open) return false;
+
+    // Refuse a record that would leave too little garbage to reclaim
+    uint32_t size = flash_cache_record_size(length);
+    int32_t index = flash_cache_index_find(key);
+    uint32_t replaced = index < 0 ? 0 : flash_cache_record_size(flash_cache_index[index].length);
+    if (size > FLASH_CACHE_PAGE_DATA_B) return false;
+    if (magic == FLASH_CACHE_RECORD_MAGIC) {
+        if (flash_cache_stats.live_bytes - replaced + size > FLASH_CACHE_LIVE_LIMIT_B) return false;
+        if (index < 0 && flash_cache_stats.records == FLASH_CACHE_MAX_ENTRIES) return false;
+    }
+
+    // Move to a new page if the record won't fit in this one. Each move
+    // may reclaim a page, so a few may be needed to free enough space
+    uint32_t moves = 0;
+    while (flash_cache_write_offset + size > (flash_cache_head + 1) * FLASH_CACHE_PAGE_SIZE_B) {
+        if (moves++ == FLASH_CACHE_PAGES || !flash_cache_advance()) return false;
+    }
+
+    const FlashCacheRecordHeader header = {
+        .magic = magic,
+        .key = key,
+        .length = length,
+        .check = ~(magic ^ key ^ length)
+    };
+
+    // Take the space now, so a failed record is skipped, not overwritten
+    uint32_t offset = flash_cache_write_offset;
+    flash_cache_write_offset += size;
+    if (!flash_cache_program(offset, &header, sizeof(header))) return false;
+
+    flash_cache_record.open = true;
+    flash_cache_record.magic = magic;
+    flash_cache_record.key = key;
+    flash_cache_record.length = length;
+    flash_cache_record.header_offset = offset;
+    flash_cache_record.offset = offset + sizeof(header);
+    flash_cache_record.written = 0;
+    flash_cache_record.pending_length = 0;
+    flash_cache_record.crc = digest_crc32(digest_crc32(0, &key, sizeof(key)), &length, sizeof(length));
+    return true;
+}
+
+
+/**
+ * @brief Make the next page in the ring the head of the log. If that
+ *        leaves no erased page, reclaim the oldest.
+ *
+ * @returns `true` if the log has a new head, otherwise `false`.
+ */
+static bool flash_cache_advance(void) {
+
+    uint32_t page = (flash_cache_head + 1) % FLASH_CACHE_PAGES;
+    if (flash_cache_pages[page].in_use) return false;
+
+    const struct {
+        uint32_t    sequence;
+        uint32_t    sequence_check;
+        uint32_t    reserved[2];
+    } sequence = {
+        flash_cache_pages[flash_cache_head].sequence + 1,
+        ~(flash_cache_pages[flash_cache_head].sequence + 1),
+        { FLASH_CACHE_ERASED, FLASH_CACHE_ERASED }
+    };
+
+    if (!flash_cache_program(page * FLASH_CACHE_PAGE_SIZE_B + FLASH_QUAD_WORD_B, &sequence, sizeof(sequence))) return false;
+
+    flash_cache_pages[page].in_use = true;
+    flash_cache_pages[page].sequence = sequence.sequence;
+    flash_cache_head = page;
+    flash_cache_write_offset = page * FLASH_CACHE_PAGE_SIZE_B + sizeof(FlashCachePageHeader);
+
+    return flash_cache_pages[(page + 1) % FLASH_CACHE_PAGES].in_use ? flash_cache_reclaim() : true;
+}
+
+
+/**
+ * @brief Copy the oldest page's live records to the head, then erase it.
+ *
+ * @returns `true` if the page was reclaimed, otherwise `false`.
+ */
+static bool flash_cache_reclaim(void) {
+
+    uint32_t page = flash_cache_tail;
+    if (page == flash_cache_head) return false;
+
+    for (uint32_t i = 0 ; i < flash_cache_stats.records ; ++i) {
+        FlashCacheEntry* entry = &flash_cache_index[i];
+        if (entry->offset / FLASH_CACHE_PAGE_SIZE_B != page) continue;
+
+        uint32_t size = flash_cache_record_size(entry->length);
+        if (flash_cache_write_offset + size > (flash_cache_head + 1) * FLASH_CACHE_PAGE_SIZE_B) return false;
+
+        // Copy through RAM, a quad-word at a time
+        for (uint32_t offset = 0 ; offset < size ; offset += FLASH_QUAD_WORD_B) {
+            uint32_t quad_word[FLASH_QUAD_WORD_B / 4];
+            memcpy(quad_word, (const void*)flash_cache_address(entry->offset + offset), FLASH_QUAD_WORD_B);
+            if (!flash_cache_program(flash_cache_write_offset + offset, quad_word, FLASH_QUAD_WORD_B)) return false;
+        }
+
+        entry->offset = flash_cache_write_offset;
+        flash_cache_write_offset += size;
+        flash_cache_stats.relocations++;
+    }
+
+    if (!flash_cache_erase(page)) return false;
+    flash_cache_tail = (page + 1) % FLASH_CACHE_PAGES;
+    flash_cache_update_wear();
+    return true;
+}
+
+
+/**
+ * @brief Add a page's valid records to the index. On the head page,
+ *        also find where the next record goes.
+ *
+ * @param page: The page's index in the region.
+ *
+ * @returns `true` if the page was read, otherwise `false`.
+ */
+static bool flash_cache_scan_page(uint32_t page) {
+
+    uint32_t offset = page * FLASH_CACHE_PAGE_SIZE_B + sizeof(FlashCachePageHeader);
+    uint32_t end = (page + 1) * FLASH_CACHE_PAGE_SIZE_B;
+
+    while (offset + flash_cache_record_size(0) <= end) {
+        const FlashCacheRecordHeader* header = (const FlashCacheRecordHeader*)flash_cache_address(offset);
+        if (header->magic == FLASH_CACHE_ERASED && flash_cache_is_erased(offset, end - offset)) break;
+
+        uint32_t size = header->length <= FLASH_CACHE_PAGE_DATA_B ? flash_cache_record_size(header->length) : end;
+        if (header->check != ~(header->magic ^ header->key ^ header->length) || size > end - offset) {
+            // A damaged header: we can't tell where the next record starts,
+            // so treat the page as full
+            flash_cache_stats.corrupt++;
+            offset = end;
+            break;
+        }
+
+        const uint8_t* data = (const uint8_t*)(header + 1);
+        const FlashCacheRecordTrailer* trailer = (const FlashCacheRecordTrailer*)flash_cache_address(offset + size - sizeof(FlashCacheRecordTrailer));
+        uint32_t crc = digest_crc32(digest_crc32(0, &header->key, sizeof(header->key)), &header->length, sizeof(header->length));
+        crc = digest_crc32(crc, data, header->length);
+
+        if (trailer->magic != FLASH_CACHE_COMMIT_MAGIC || trailer->crc != crc) {
+            flash_cache_stats.corrupt++;
+        } else if (header->magic == FLASH_CACHE_TOMBSTONE_MAGIC) {
+            flash_cache_index_remove(header->key);
+        } else if (header->magic == FLASH_CACHE_RECORD_MAGIC) {
+            if (flash_cache_index_find(header->key) < 0 && flash_cache_stats.records == FLASH_CACHE_MAX_ENTRIES) {
+                flash_cache_stats.corrupt++;
+            } else {
+                flash_cache_index_put(header->key, offset, header->length);
+            }
+        }
+
+        offset += size;
+    }
+
+    if (page == flash_cache_head) flash_cache_write_offset = offset;
+    return true;
+}
+
+
+/**
+ * @brief Find a key in the index.
+ *
+ * @param key: The key.
+ *
+ * @returns The key's place in the index, or -1 if it has no record.
+ */
+static int32_t flash_cache_index_find(uint32_t key) {
+
+    for (uint32_t i = 0 ; i < flash_cache_stats.records ; ++i) {
+        if (flash_cache_index[i].key == key) return (int32_t)i;
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Point a key's index entry at a new record, adding it if need be.
+ *
+ * @param key:    The key.
+ * @param offset: The offset of the record in the region.
+ * @param length: The size of the record's data in bytes.
+ */
+static void flash_cache_index_put(uint32_t key, uint32_t offset, uint32_t length) {
+
+    int32_t index = flash_cache_index_find(key);
+    if (index < 0) {
+        index = (int32_t)flash_cache_stats.records++;
+    } else {
+        flash_cache_stats.live_bytes -= flash_cache_record_size(flash_cache_index[index].length);
+    }
+
+    flash_cache_index[index] = (FlashCacheEntry){ key, offset, length };
+    flash_cache_stats.live_bytes += flash_cache_record_size(length);
+}
+
+
+/**
+ * @brief Remove a key from the index.
+ *
+ * @param key: The key.
+ */
+static void flash_cache_index_remove(uint32_t key) {
+
+    int32_t index = flash_cache_index_find(key);
+    if (index < 0) return;
+
+    flash_cache_stats.live_bytes -= flash_cache_record_size(flash_cache_index[index].length);
+    flash_cache_index[index] = flash_cache_index[--flash_cache_stats.records];
+}
+
+
+/**
+ * @brief Update the wear counters from the pages' erase counts.
+ */
+static void flash_cache_update_wear(void) {
+
+    flash_cache_stats.min_erase_count = FLASH_CACHE_ERASED;
+    flash_cache_stats.max_erase_count = 0;
+    for (uint32_t page = 0 ; page < FLASH_CACHE_PAGES ; ++page) {
+        uint32_t count = flash_cache_pages[page].erase_count;
+        if (count < flash_cache_stats.min_erase_count) flash_cache_stats.min_erase_count = count;
+        if (count > flash_cache_stats.max_erase_count) flash_cache_stats.max_erase_count = count;
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _FLASH_CACHE_H_
+#define _FLASH_CACHE_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * CONSTANTS
+ */
+// The region the cache owns: the last pages of the STM32U585's 2MB flash,
+// clear of the application image. Pages are numbered across both banks
+#define     FLASH_CACHE_PAGE_SIZE_B     8192
+#define     FLASH_CACHE_FIRST_PAGE      252
+#define     FLASH_CACHE_PAGES           4
+
+// Most records the RAM index can hold
+#define     FLASH_CACHE_MAX_ENTRIES     24
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+// The live record for a key, by its offset in the region
+typedef struct {
+    uint32_t    key;
+    uint32_t    offset;
+    uint32_t    length;
+} FlashCacheEntry;
+
+typedef struct {
+    uint32_t    records;
+    uint32_t    live_bytes;
+    uint32_t    writes;
+    uint32_t    relocations;
+    uint32_t    erases;
+    uint32_t    corrupt;
+    uint32_t    min_erase_count;
+    uint32_t    max_erase_count;
+} FlashCacheStats;
+
+
+/*
+ * PROTOTYPES
+ */
+bool                    flash_cache_init(void);
+bool                    flash_cache_begin(uint32_t key, uint32_t length);
+bool                    flash_cache_write(const void* data, uint32_t length);
+bool                    flash_cache_commit(void);
+void                    flash_cache_abort(void);
+bool                    flash_cache_remove(uint32_t key);
+const uint8_t*          flash_cache_find(uint32_t key, uint32_t* length);
+bool                    flash_cache_get_key(uint32_t index, uint32_t* key);
+const FlashCacheStats*  flash_cache_get_stats(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _FLASH_CACHE_H_
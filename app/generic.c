@@ -10,6 +10,21 @@
 #include "app_version.h"
 
 
+/*
+ * GLOBALS
+ */
+// When each boot stage was first reached, in microseconds
+static uint64_t boot_times_us[BOOT_STAGE_COUNT] = { 0 };
+static const char* boot_stage_names[BOOT_STAGE_COUNT] = {
+    "main() entered",
+    "network requested",
+    "scheduler started",
+    "network up",
+    "first request sent",
+    "first response read"
+};
+
+
 /**
  * @brief Get the MV clock value.
  *
@@ -90,4 +105,38 @@ void control_system_led(bool do_enable) {
 
     enum MvStatus status = mvSystemLedEnable(do_enable ? 1 : 0);
     assert(status == MV_STATUS_OKAY);
+}
+
+
+/**
+ * @brief Note the first time a boot stage is reached. Once the first
+ *        response has been read, log when each stage was reached,
+ *        from the start of `main()`.
+ *
+ * @param stage: The stage reached.
+ */
+void boot_mark(BootStage stage) {
+
+    if (stage >= BOOT_STAGE_COUNT || boot_times_us[stage] != 0) return;
+    mvGetMicroseconds(&boot_times_us[stage]);
+    if (stage != BOOT_STAGE_FIRST_RESPONSE) return;
+
+    for (uint32_t i = 0 ; i < BOOT_STAGE_COUNT ; ++i) {
+        uint64_t since_us = boot_times_us[i] > boot_times_us[BOOT_STAGE_MAIN] ? boot_times_us[i] - boot_times_us[BOOT_STAGE_MAIN] : 0;
+        server_log("Boot timeline: %6lu.%03lu ms %s", (uint32_t)(since_us / 1000), (uint32_t)(since_us % 1000), boot_stage_names[i]);
+    }
+}
+
+
+/**
+ * @brief Get a millisecond tick that, unlike `HAL_GetTick()`, won't wrap
+ *        after 49 days: Microvisor's microsecond clock is 64-bit.
+ *
+ * @returns Milliseconds since the device started.
+ */
+uint64_t monotonic_ms(void) {
+
+    uint64_t us = 0;
+    mvGetMicroseconds(&us);
+    return us / 1000;
 }
\ No newline at end of file
@@ -15,6 +15,21 @@ extern "C" {
 #endif
 
 
+/*
+ * TYPES
+ */
+// Points in startup timed by `boot_mark()`, in the order they're expected
+typedef enum {
+    BOOT_STAGE_MAIN = 0,
+    BOOT_STAGE_NETWORK_REQUESTED,
+    BOOT_STAGE_SCHEDULER_STARTED,
+    BOOT_STAGE_NETWORK_UP,
+    BOOT_STAGE_FIRST_REQUEST,
+    BOOT_STAGE_FIRST_RESPONSE,
+    BOOT_STAGE_COUNT
+} BootStage;
+
+
 /*
  * PROTOTYPES
  */
@@ -22,6 +37,8 @@ void system_clock_config(void);
 void show_wake_reason(void);
 void log_device_info(void);
 void control_system_led(bool do_enable);
+void boot_mark(BootStage stage);
+uint64_t monotonic_ms(void);
 
 
 #ifdef __cplusplus
@@ -9,6 +9,39 @@
 #include "main.h"
 
 
+/*
+ * STATIC PROTOTYPES
+ */
+static HttpChannel* http_channel(uint32_t index);
+static bool         http_open_channel(uint32_t index);
+static void         http_close_channel(uint32_t index);
+static void         http_setup_notification_center(void);
+static void         http_handle_notification(const EventRecord* record, void* context);
+static void         http_engine_task(void* argument);
+static int32_t      http_idle_channel(void);
+static void         http_start_request(uint32_t index, const HttpRequest* request);
+static void         http_service_channel(uint32_t index);
+static void         http_request_timed_out(TimerEntry* timer, void* context);
+static void         http_pulse_due(TimerEntry* timer, void* context);
+static void         http_complete_request(uint32_t index, enum MvStatus status);
+static void         http_record_latency(uint32_t index);
+static void         http_record_stack(void);
+static uint32_t     http_url_hash(const char* url);
+static HttpValidator* http_find_validator(uint32_t url_hash);
+static void         http_update_validator(uint32_t url_hash, const HttpResponse* response);
+static void         http_copy_validator(char* destination, const char* source, uint32_t size);
+static uint32_t     http_queue_request(HttpRequest* request);
+static bool         http_request_has_header(const HttpRequest* request, const char* name);
+static bool         http_request_is_get(const HttpRequest* request);
+static enum MvStatus http_read_chunks(const HttpResponse* response, HttpBodyConsumer consumer, void* context);
+static bool         http_feed_inflater(const uint8_t* data, uint32_t length, void* context);
+static bool         http_feed_json(const uint8_t* data, uint32_t length, void* context);
+static bool         http_feed_cbor(const uint8_t* data, uint32_t length, void* context);
+static void         http_load_persisted(void);
+static bool         http_unpack_persisted(uint32_t url_hash, HttpResponse* response, HttpHeaderTable* headers);
+static void         http_persist_response(uint32_t index);
+
+
 /*
  * GLOBALS
  */
@@ -17,48 +50,677 @@
 static struct {
     MvNotificationHandle notification;
     MvNetworkHandle      network;
-    MvChannelHandle      channel;
-} http_handles = { 0, 0, 0 };
+} http_handles = { 0, 0 };
+
+// The channel pool. Each channel has its own send and receive buffers and
+// notification tag, so its requests can be in flight alongside the others'
+static HttpChannel http_channels[HTTP_CHANNEL_POOL_SIZE];
+
+// The engine task, which owns the channel pool, and its queue of
+// submitted requests. The ISR signals the engine when channel events arrive
+static osThreadId_t         http_engine = NULL;
+static osMessageQueueId_t   http_queue = NULL;
+static uint32_t             http_next_request_id = 1;
+
+// The engine's timers: request deadlines, telemetry's and the download
+// manager's, network re-requests, and the send schedule, on a 64-bit tick
+static TimerWheel           http_timers;
+
+// A task woken every `period_ms` by the engine. It's claimed by setting
+// `thread`, after which the engine starts the timer
+static struct {
+    TimerEntry              timer;
+    uint32_t                period_ms;
+    uint32_t                flag;
+    osThreadId_t volatile   thread;
+} http_pulse;
+
+// ETags and Last-Modified dates, by URL hash, most recently used first
+static HttpValidator http_validators[HTTP_VALIDATOR_CACHE_LEN];
+static uint32_t      http_validator_clock = 0;
+
+// Hashes of the URLs whose responses are kept in flash
+static uint32_t http_persisted_urls[HTTP_PERSIST_MAX_URLS];
+
+static HttpStats http_stats = { 0 };
+
+// Added to every request
+static const struct MvHttpHeader http_accept_encoding = HTTP_HEADER(HTTP_ACCEPT_ENCODING);
+
+
+/**
+ * @brief Create the request queue and start the HTTP engine task.
+ *
+ * Call before the scheduler starts. Requests may be submitted from then on.
+ *
+ * @returns `true` if the engine is running, otherwise `false`.
+ */
+bool http_start_engine(void) {
+
+    // This is the CMSIS/FreeRTOS thread task that sends HTTP requests
+    // and delivers their responses
+    const osThreadAttr_t attributes_thread_engine = {
+        .name = "HTTPEngine",
+        .stack_size = HTTP_ENGINE_STACK_SIZE_B,
+        .priority = osPriorityNormal
+    };
+
+    http_queue = osMessageQueueNew(HTTP_REQUEST_QUEUE_LEN, sizeof(HttpRequest), NULL);
+    if (http_queue == NULL) return false;
+
+    http_stats.stack_free_min = UINT32_MAX;
+    timer_wheel_init(&http_timers, monotonic_ms());
+    timer_wheel_init_timer(&http_pulse.timer, http_pulse_due, NULL);
+    for (uint32_t i = 0 ; i < HTTP_CHANNEL_POOL_SIZE ; ++i) {
+        HttpChannel* channel = &http_channels[i];
+        http_builder_init(&channel->request_headers, channel->request_arena, sizeof(channel->request_arena), HTTP_MAX_REQUEST_HEADERS);
+        timer_wheel_init_timer(&channel->deadline, http_request_timed_out, (void*)(uintptr_t)i);
+    }
+
+    http_engine = osThreadNew(http_engine_task, NULL, &attributes_thread_engine);
+    return http_engine != NULL;
+}
+
+
+/**
+ * @brief Queue an HTTP request.
+ *
+ * This does not block: the request is sent by the engine task when a pool
+ * channel is free. On completion, `callback` is called on the engine task
+ * with the outcome, which it may read until it returns. If `callback` is
+ * `NULL`, the submitting task is instead sent `HTTP_FLAG_REQUEST_DONE`,
+ * after which it gets the outcome with `http_get_response()`; it must then
+ * call `http_release()` to free the channel.
+ *
+ * @param method:      The HTTP method, eg. `"GET"`.
+ * @param url:         The target URL. Copied.
+ * @param headers:     Request headers, or `NULL`. Must remain valid until completion.
+ *                     A GET for a URL whose last response carried an ETag or
+ *                     Last-Modified header is made conditional automatically.
+ *                     A GET with a callback is answered from the response
+ *                     cache, without using the network, if the URL's last
+ *                     response is still fresh.
+ * @param num_headers: The number of headers.
+ * @param body:        The request body, or `NULL`. Must remain valid until completion.
+ * @param body_length: The size of the body in bytes.
+ * @param callback:    The completion callback, or `NULL`.
+ * @param context:     Passed to the callback.
+ *
+ * @returns The request's ID, or 0 if it could not be queued.
+ */
+uint32_t http_submit(const char* method, const char* url,
+                     const struct MvHttpHeader* headers, uint32_t num_headers,
+                     const uint8_t* body, uint32_t body_length,
+                     HttpCallback callback, void* context) {
+
+    HttpRequest request = {
+        .method_length = strlen(method),
+        .url_length = strlen(url),
+        .headers = headers,
+        .num_headers = num_headers,
+        .body = body,
+        .body_length = body_length,
+        .callback = callback,
+        .context = context,
+        .waiter = callback == NULL ? osThreadGetId() : NULL
+    };
+
+    if (request.method_length >= HTTP_MAX_METHOD_LEN || request.url_length >= HTTP_MAX_URL_LEN) {
+        server_error("HTTP request method or URL too long");
+        return 0;
+    }
+
+    memcpy(request.method, method, request.method_length + 1);
+    memcpy(request.url, url, request.url_length + 1);
+    return http_queue_request(&request);
+}
+
+
+/**
+ * @brief Queue an HTTP request laid out by a template.
+ *
+ * As `http_submit()`, but the fixed parts of the request come from the
+ * template with their lengths already known, and only the URL's variable
+ * field is converted. Nothing is formatted or measured.
+ *
+ * @param tmpl:     The request template. Must remain valid until completion.
+ * @param field:    The value of the URL's variable field.
+ * @param callback: The completion callback, or `NULL`.
+ * @param context:  Passed to the callback.
+ *
+ * @returns The request's ID, or 0 if it could not be queued.
+ */
+uint32_t http_submit_template(const HttpTemplate* tmpl, uint32_t field,
+                              HttpCallback callback, void* context) {
+
+    HttpRequest request = {
+        .method_length = tmpl->method_length,
+        .headers = tmpl->headers,
+        .num_headers = tmpl->num_headers,
+        .body = tmpl->body,
+        .body_length = tmpl->body_length,
+        .callback = callback,
+        .context = context,
+        .waiter = callback == NULL ? osThreadGetId() : NULL
+    };
+
+    request.url_length = http_template_url(tmpl, field, request.url, sizeof(request.url));
+    if (request.method_length >= HTTP_MAX_METHOD_LEN || request.url_length == 0) {
+        server_error("HTTP request method or URL too long");
+        return 0;
+    }
+
+    memcpy(request.method, tmpl->method, request.method_length + 1);
+    return http_queue_request(&request);
+}
+
+
+/**
+ * @brief Give a request its ID and queue it for the engine.
+ *
+ * @param request: The request.
+ *
+ * @returns The request's ID, or 0 if it could not be queued.
+ */
+static uint32_t http_queue_request(HttpRequest* request) {
+
+    if (http_queue == NULL) return 0;
+    if (request->num_headers > HTTP_MAX_REQUEST_HEADERS - HTTP_ADDED_HEADERS) {
+        server_error("Too many HTTP request headers");
+        return 0;
+    }
+
+    // Request IDs are never 0
+    do {
+        request->request_id = __atomic_fetch_add(&http_next_request_id, 1, __ATOMIC_RELAXED);
+    } while (request->request_id == 0);
+
+    if (osMessageQueuePut(http_queue, request, 0, 0) != osOK) {
+        server_error("HTTP request queue full");
+        return 0;
+    }
+
+    osThreadFlagsSet(http_engine, HTTP_FLAG_REQUEST_QUEUED);
+    return request->request_id;
+}
+
+
+/**
+ * @brief Get the outcome of a completed request made without a callback,
+ *        or one whose callback held it.
+ *
+ * @param request_id: The ID returned by `http_submit()`.
+ *
+ * @returns The outcome, or `NULL` if the request has not completed
+ *          or has been released.
+ */
+const HttpResponse* http_get_response(uint32_t request_id) {
+
+    for (uint32_t i = 0 ; i < HTTP_CHANNEL_POOL_SIZE ; ++i) {
+        if (http_channels[i].held && http_channels[i].response.request_id == request_id) {
+            return &http_channels[i].response;
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Keep a response in its channel after its callback returns, so it
+ *        can be read later. The channel takes no other request until it
+ *        is freed with `http_release()`. Call from the callback.
+ *
+ * A response served from the cache can't be held: its body and headers
+ * live in the cache, which may move or evict them once the callback returns.
+ *
+ * @param response: The response passed to the callback.
+ *
+ * @returns `true` if the response is held, `false` if it can't be.
+ */
+bool http_hold(const HttpResponse* response) {
+
+    if (response->body != NULL) return false;
+
+    for (uint32_t i = 0 ; i < HTTP_CHANNEL_POOL_SIZE ; ++i) {
+        if (&http_channels[i].response == response) {
+            http_channels[i].held = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Free the channel held by a completed request made without a
+ *        callback, or by one whose callback held it.
+ *
+ * @param request_id: The ID returned by `http_submit()`.
+ */
+void http_release(uint32_t request_id) {
+
+    for (uint32_t i = 0 ; i < HTTP_CHANNEL_POOL_SIZE ; ++i) {
+        if (http_channels[i].held && http_channels[i].response.request_id == request_id) {
+            http_builder_reset(&http_channels[i].request_headers);
+            http_channels[i].held = false;
+            osThreadFlagsSet(http_engine, HTTP_FLAG_REQUEST_QUEUED);
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief Look up one of a response's headers by name.
+ *
+ * @param response: The response.
+ * @param name:     The header name, in any case, eg. `"content-type"`.
+ *
+ * @returns The header's value, or `NULL` if the response has no such header.
+ */
+const char* http_find_header(const HttpResponse* response, const char* name) {
+
+    return response->headers != NULL ? http_headers_find(response->headers, name) : NULL;
+}
+
+
+/**
+ * @brief Get one of a response's headers by its position.
+ *
+ * @param response: The response.
+ * @param index:    The header's index.
+ * @param name:     Receives the header's name.
+ * @param value:    Receives the header's value.
+ *
+ * @returns `true` if there is such a header, otherwise `false`.
+ */
+bool http_get_header(const HttpResponse* response, uint32_t index, const char** name, const char** value) {
+
+    return response->headers != NULL && http_headers_get(response->headers, index, name, value);
+}
+
+
+/**
+ * @brief Read part or all of a response's body.
+ *
+ * @param response: The response.
+ * @param offset:   The offset in the body to read from.
+ * @param buffer:   Receives the body data.
+ * @param size:     The number of bytes to read.
+ *
+ * @returns The Microvisor status of the read.
+ */
+enum MvStatus http_read_body(const HttpResponse* response, uint32_t offset, uint8_t* buffer, uint32_t size) {
+
+    if (response->body != NULL) {
+        // A cached response is read from RAM
+        if (offset > response->body_length || size > response->body_length - offset) return MV_STATUS_OFFSETINVALID;
+        memcpy(buffer, response->body + offset, size);
+        return MV_STATUS_OKAY;
+    }
+
+    return mvReadHttpResponseBody(http_channels[response->channel].handle, offset, buffer, size);
+}
+
+
+/**
+ * @brief Pass a response's body to a consumer in chunks.
+ *
+ * A body compressed with gzip or deflate is inflated on the way, through
+ * the window of the response's channel, so the consumer always gets the
+ * decoded content and neither the compressed nor the inflated body need
+ * be held in full. A body with a SHA-256 Content-Digest is checked as it
+ * is read; the verdict comes at the end, so a consumer must not act on
+ * the body until this returns.
+ *
+ * @param response: The response.
+ * @param consumer: Called with each chunk in turn.
+ * @param context:  Passed to the consumer.
+ *
+ * @returns The Microvisor status of the first failed read,
+ *          `MV_STATUS_INVALIDBUFFER` if the body can't be decoded or
+ *          does not match its digest, otherwise `MV_STATUS_OKAY`.
+ */
+enum MvStatus http_stream_body(const HttpResponse* response, HttpBodyConsumer consumer, void* context) {
+
+    HttpContentEncoding encoding = response->typed.content_encoding;
+    if (encoding == HTTP_ENCODING_IDENTITY) return http_read_chunks(response, consumer, context);
+
+    if (encoding == HTTP_ENCODING_OTHER) {
+        server_error("Response %lu has an unsupported Content-Encoding", response->request_id);
+        return MV_STATUS_INVALIDBUFFER;
+    }
+
+    Inflater* inflater = &http_channels[response->channel].inflater;
+    inflate_init(inflater, encoding == HTTP_ENCODING_GZIP ? INFLATE_FORMAT_GZIP : INFLATE_FORMAT_ZLIB, consumer, context);
+
+    uint64_t start_us = 0;
+    uint64_t end_us = 0;
+    mvGetMicroseconds(&start_us);
+    enum MvStatus status = http_read_chunks(response, http_feed_inflater, inflater);
+    mvGetMicroseconds(&end_us);
+    if (status != MV_STATUS_OKAY) return status;
+
+    // The consumer may stop early, but otherwise the stream must be whole
+    if (!inflater->stopped && !inflate_finish(inflater)) {
+        http_stats.inflate_failures++;
+        server_error("Could not inflate response %lu body. Error: %lu", response->request_id, (uint32_t)inflater->error);
+        return MV_STATUS_INVALIDBUFFER;
+    }
+
+    uint32_t elapsed_us = end_us > start_us ? (uint32_t)(end_us - start_us) : 0;
+    http_stats.inflated_bodies++;
+    http_stats.inflate_in_bytes += inflater->total_in;
+    http_stats.inflate_out_bytes += inflater->total_out;
+    http_stats.inflate_us += elapsed_us;
+
+    // Ratios are inflated bytes per compressed byte, in hundredths
+    uint32_t ratio = inflater->total_in > 0 ? (uint32_t)((uint64_t)inflater->total_out * 100 / inflater->total_in) : 0;
+    uint32_t total_ratio = (uint32_t)(http_stats.inflate_out_bytes * 100 / http_stats.inflate_in_bytes);
+    uint32_t rate_kbs = (uint32_t)(http_stats.inflate_out_bytes * 1000 / (http_stats.inflate_us > 0 ? http_stats.inflate_us : 1));
+    server_log("Inflated %lu bytes to %lu (ratio %lu.%02lu) in %lu us. Bodies: %lu, ratio %lu.%02lu, %lu KB/s",
+               inflater->total_in, inflater->total_out, ratio / 100, ratio % 100, elapsed_us,
+               http_stats.inflated_bodies, total_ratio / 100, total_ratio % 100, rate_kbs);
+    return MV_STATUS_OKAY;
+}
+
+
+/**
+ * @brief Decode a response's body into a struct as it is read.
+ *
+ * The decoder is chosen by the response's Content-Type: JSON or CBOR.
+ * Either way the body is streamed through it in chunks, so no copy
+ * of the body is needed.
+ *
+ * @param response: The response.
+ * @param schema:   The struct's schema.
+ * @param target:   The struct.
+ * @param found:    Receives the schema's fields that were filled, as
+ *                  bits by field index.
+ *
+ * @returns `HTTP_DECODE_OK` if every field was filled, otherwise the reason not.
+ */
+HttpDecodeResult http_decode_body(const HttpResponse* response, const JsonSchema* schema, void* target, uint32_t* found) {
+
+    // Only one decoder is needed at a time, so they share the stack
+    union {
+        JsonDecoder json;
+        CborDecoder cbor;
+    } decoder;
+
+    *found = 0;
+    if (response->typed.content_encoding == HTTP_ENCODING_OTHER) return HTTP_DECODE_UNSUPPORTED;
+
+    bool is_cbor = response->typed.content_type == HTTP_CONTENT_CBOR;
+    if (is_cbor) {
+        cbor_decoder_init(&decoder.cbor, schema, target);
+    } else if (response->typed.content_type == HTTP_CONTENT_JSON) {
+        json_decoder_init(&decoder.json, schema, target);
+    } else {
+        return HTTP_DECODE_UNSUPPORTED;
+    }
+
+    if (http_stream_body(response, is_cbor ? http_feed_cbor : http_feed_json, &decoder) != MV_STATUS_OKAY) {
+        return HTTP_DECODE_READ_FAILED;
+    }
+
+    bool complete = is_cbor ? cbor_decoder_finish(&decoder.cbor) : json_decoder_finish(&decoder.json);
+    *found = is_cbor ? decoder.cbor.found : decoder.json.found;
+    return complete ? HTTP_DECODE_OK : HTTP_DECODE_INCOMPLETE;
+}
+
+
+/**
+ * @brief Drop the validators held for a URL, so the next GET for it
+ *        fetches the full resource. Use this when the result of the
+ *        last full response is no longer available to reuse.
+ *
+ * @param url: The URL.
+ */
+void http_forget_validators(const char* url) {
+
+    HttpValidator* validator = http_find_validator(http_url_hash(url));
+    if (validator != NULL) validator->url_hash = 0;
+}
+
+
+/**
+ * @brief Keep a URL's responses in flash, so they survive restarts.
+ *
+ * A GET's 200 response is stored if it carries an ETag or Last-Modified
+ * header. After a restart, GETs for the URL are made conditional from the
+ * stored response, and a 304 is delivered to the request's callback as the
+ * stored response, so the resource is downloaded again only if it has
+ * changed. Responses to requests without a callback are not replaced.
+ *
+ * @param url: The URL.
+ *
+ * @returns `true` if the URL's responses will be kept, otherwise `false`.
+ */
+bool http_persist_url(const char* url) {
+
+    uint32_t url_hash = http_url_hash(url);
+    for (uint32_t i = 0 ; i < HTTP_PERSIST_MAX_URLS ; ++i) {
+        uint32_t expected = 0;
+        if (http_persisted_urls[i] == url_hash) return true;
+        if (__atomic_compare_exchange_n(&http_persisted_urls[i], &expected, url_hash, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return true;
+    }
+
+    server_error("Too many persisted URLs");
+    return false;
+}
+
+
+/**
+ * @brief Wake the engine to check for work other than requests,
+ *        eg. a telemetry batch. May be called from an ISR.
+ */
+void http_wake_engine(void) {
+
+    if (http_engine != NULL) osThreadFlagsSet(http_engine, HTTP_FLAG_TELEMETRY);
+}
+
+
+/**
+ * @brief Start one of the engine's timers, or restart it. When it expires,
+ *        its callback is called on the engine task, which then services
+ *        telemetry, the download and the request queue. Call on the
+ *        engine task only, eg. from a request or notification callback.
+ *
+ * @param timer:     The timer, set up with `timer_wheel_init_timer()`.
+ * @param delay_ms:  How long until it expires.
+ * @param period_ms: How often it expires after that, or 0 for once.
+ */
+void http_timer_start(TimerEntry* timer, uint32_t delay_ms, uint32_t period_ms) {
+
+    timer_wheel_start(&http_timers, timer, delay_ms, period_ms);
+}
+
+
+/**
+ * @brief Stop one of the engine's timers. Call on the engine task only.
+ *
+ * @param timer: The timer.
+ */
+void http_timer_stop(TimerEntry* timer) {
+
+    timer_wheel_stop(&http_timers, timer);
+}
+
+
+/**
+ * @brief Have the engine send the calling task a thread flag now, and
+ *        every `period_ms` after, on a fixed schedule that doesn't drift
+ *        with the time the task takes to act on it. One task may do so.
+ *
+ * @param period_ms: The interval between flags.
+ * @param flag:      The thread flag to send.
+ *
+ * @returns `true` if the schedule was set up, `false` if one already is.
+ */
+bool http_start_pulse(uint32_t period_ms, uint32_t flag) {
+
+    if (http_engine == NULL || http_pulse.thread != NULL) return false;
+
+    http_pulse.period_ms = period_ms;
+    http_pulse.flag = flag;
+    http_pulse.thread = osThreadGetId();
+    http_wake_engine();
+    return true;
+}
+
+
+/**
+ * @brief Provide the channel reuse counters.
+ *
+ * @returns The counters.
+ */
+const HttpStats* http_get_stats(void) {
+
+    return &http_stats;
+}
+
+
+/**
+ * @brief Provide the engine's timer counters.
+ *
+ * @returns The counters.
+ */
+const TimerWheelStats* http_get_timer_stats(void) {
+
+    return &http_timers.stats;
+}
+
+
+/**
+ * @brief Function implementing the HTTP engine task thread.
+ *
+ * @param argument: Not used.
+ */
+static void http_engine_task(void* argument) {
 
-// Central store for HTTP request management notification records.
-// Holds HTTP_NT_BUFFER_SIZE_R records at a time -- each record is 16 bytes in size.
-static struct MvNotification http_notification_center[HTTP_NT_BUFFER_SIZE_R] __attribute__((aligned(8)));
-static volatile uint32_t current_notification_index = 0;
+    // The engine is the first task created
+    boot_mark(BOOT_STAGE_SCHEDULER_STARTED);
 
-// Defined in `main.c`
-extern volatile bool received_request;
-extern volatile bool channel_was_closed;
+    // Set up HTTP notifications
+    http_setup_notification_center();
+
+    // Pick up the responses kept in flash before the last restart
+    http_load_persisted();
+
+    // Run the thread's main loop
+    while (1) {
+        // Sleep until the ISR signals a channel event, a request is
+        // submitted or released, telemetry or a download is queued, or
+        // the next timer expires
+        osThreadFlagsWait(HTTP_FLAGS_ALL, osFlagsWaitAny, timer_wheel_wait_time(&http_timers, monotonic_ms()));
+
+        // Run the timers that are due: request deadlines mark their
+        // channels, and the rest mark work for the services below.
+        // Timers started from here on count from now
+        timer_wheel_advance(&http_timers, monotonic_ms());
+
+        // Start the send schedule once a task has asked for it
+        if (http_pulse.thread != NULL && !http_pulse.timer.running) {
+            timer_wheel_start(&http_timers, &http_pulse.timer, 0, http_pulse.period_ms);
+        }
+
+        // Hand the notifications the ISR has queued to their handlers,
+        // which mark channel events on their channels
+        notify_dispatch();
+
+        // Deliver completions first, so the channels they free
+        // can take queued requests straight away
+        for (uint32_t i = 0 ; i < HTTP_CHANNEL_POOL_SIZE ; ++i) {
+            http_service_channel(i);
+        }
+
+        // Queue a telemetry batch if one is due, to go out with the rest
+        telemetry_service(HAL_GetTick());
+
+        // Queue the next slice of a download, if one is running
+        download_service();
+
+        // Requests stay queued while the network is down, rather than
+        // failing to open channels, and go out together when it returns
+        int32_t index;
+        HttpRequest request;
+        while (net_is_up() && (index = http_idle_channel()) >= 0 && osMessageQueueGet(http_queue, &request, NULL, 0) == osOK) {
+            http_start_request((uint32_t)index, &request);
+        }
+    }
+}
+
+
+/**
+ * @brief Get a pool channel by index.
+ *
+ * @param index: The channel's index in the pool.
+ *
+ * @returns The channel, or `NULL` if the index is out of range.
+ */
+static HttpChannel* http_channel(uint32_t index) {
+
+    return index < HTTP_CHANNEL_POOL_SIZE ? &http_channels[index] : NULL;
+}
+
+
+/**
+ * @brief Find a channel that can take a new request,
+ *        preferring one that is already open.
+ *
+ * @returns The channel's pool index, or -1 if all are in use.
+ */
+static int32_t http_idle_channel(void) {
+
+    int32_t index = -1;
+    for (uint32_t i = 0 ; i < HTTP_CHANNEL_POOL_SIZE ; ++i) {
+        if (!http_channels[i].busy && !http_channels[i].held) {
+            if (http_channels[i].handle != 0) return (int32_t)i;
+            if (index < 0) index = (int32_t)i;
+        }
+    }
+
+    return index;
+}
 
 
 /**
  * @brief Open a new HTTP channel.
  *
+ * @param index: The channel's index in the pool.
+ *
  * @returns `true` if the channel is open, otherwise `false`.
  */
-bool http_open_channel(void) {
+static bool http_open_channel(uint32_t index) {
 
-    // Set up the HTTP channel's multi-use send and receive buffers
-    static uint8_t http_rx_buffer[HTTP_RX_BUFFER_SIZE_B] __attribute__((aligned(512)));
-    static uint8_t http_tx_buffer[HTTP_TX_BUFFER_SIZE_B] __attribute__((aligned(512)));
+    HttpChannel* channel = http_channel(index);
+    if (channel == NULL) return false;
 
     // Get the network channel handle.
-    // NOTE This is set in `logging.c` which puts the network in place
-    //      (ie. so the network handle != 0) well in advance of this being called
+    // NOTE The network is requested by `net_open_network()` in `network.c`,
+    //      which returns at once: it comes up, and may drop and be requested
+    //      again, asynchronously. The engine only starts requests while
+    //      `net_is_up()`, holding them in the queue until then, so the handle
+    //      is set by now. It is checked all the same, as a guard
     http_handles.network = net_get_handle();
     if (http_handles.network == 0) return false;
     server_log("Network handle: %lu", (uint32_t)http_handles.network);
 
-    // Configure the required data channel
+    // Configure the required data channel. Its tag identifies
+    // the channel's notifications to the ISR
     const struct MvOpenChannelParams channel_config = {
         .version = 1,
         .v1 = {
             .notification_handle = http_handles.notification,
-            .notification_tag    = USER_TAG_HTTP_OPEN_CHANNEL,
+            .notification_tag    = USER_TAG_HTTP_CHANNEL_BASE + index,
             .network_handle      = http_handles.network,
-            .receive_buffer      = http_rx_buffer,
-            .receive_buffer_len  = sizeof(http_rx_buffer),
-            .send_buffer         = http_tx_buffer,
-            .send_buffer_len     = sizeof(http_tx_buffer),
+            .receive_buffer      = channel->rx_buffer,
+            .receive_buffer_len  = sizeof(channel->rx_buffer),
+            .send_buffer         = channel->tx_buffer,
+            .send_buffer_len     = sizeof(channel->tx_buffer),
             .channel_type        = MV_CHANNELTYPE_HTTP,
             .endpoint            = {
                 .data = (uint8_t*)"",
@@ -69,161 +731,759 @@ bool http_open_channel(void) {
 
     // Ask Microvisor to open the channel
     // and confirm that it has accepted the request
-    enum MvStatus status = mvOpenChannel(&channel_config, &http_handles.channel);
+    enum MvStatus status = mvOpenChannel(&channel_config, &channel->handle);
     if (status == MV_STATUS_OKAY) {
-        server_log("HTTP channel handle: %lu", (uint32_t)http_handles.channel);
+        http_stats.channel_opens++;
+        server_log("HTTP channel %lu handle: %lu", index, (uint32_t)channel->handle);
         return true;
     }
 
-    server_error("Could not open HTTP channel. Status: %i", status);
+    server_error("Could not open HTTP channel %lu. Status: %i", index, status);
     return false;
 }
 
 
 /**
- * @brief Close the currently open HTTP channel.
+ * @brief Close an open HTTP channel.
+ *
+ * @param index: The channel's index in the pool.
  */
-void http_close_channel(void) {
+static void http_close_channel(uint32_t index) {
+
+    HttpChannel* channel = http_channel(index);
+    if (channel == NULL) return;
 
     // If we have a valid channel handle -- ie. it is non-zero --
     // then ask Microvisor to close it and confirm acceptance of
     // the closure request.
-    if (http_handles.channel != 0) {
-        MvChannelHandle old = http_handles.channel;
-        enum MvStatus status = mvCloseChannel(&http_handles.channel);
+    if (channel->handle != 0) {
+        MvChannelHandle old = channel->handle;
+        enum MvStatus status = mvCloseChannel(&channel->handle);
         do_assert((status == MV_STATUS_OKAY || status == MV_STATUS_CHANNELCLOSED), "Channel closure");
         server_log("HTTP channel %lu closed (status code: %i)", (uint32_t)old, status);
     }
 
     // Confirm the channel handle has been invalidated by Microvisor
-    do_assert(http_handles.channel == 0, "Channel handle not zero");
+    do_assert(channel->handle == 0, "Channel handle not zero");
+    channel->close_pending = false;
 }
 
 
 /**
- * @brief Provide the current channel handle.
+ * @brief Route the channels' notifications to the engine task.
  *
- * @returns The channel handle.
+ * The calling task is sent `HTTP_FLAG_NOTIFICATION` when notifications
+ * arrive, and dispatches them to their handlers.
  */
-MvChannelHandle http_get_handle(void) {
+static void http_setup_notification_center(void) {
 
-    return http_handles.channel;
+    http_handles.notification = notify_init();
+    notify_register(USER_TAG_HTTP_CHANNEL_BASE, HTTP_CHANNEL_POOL_SIZE, http_handle_notification, NULL);
+    notify_set_dispatcher(osThreadGetId(), HTTP_FLAG_NOTIFICATION);
 }
 
 
 /**
- * @brief Configure the channel notification center.
+ * @brief Mark a channel notification on the channel it was tagged for.
+ *        Called on the engine task, which acts on the channel's events
+ *        when it next services it.
+ *
+ * @param record:  The notification record.
+ * @param context: Not used.
  */
-void http_setup_notification_center(void) {
-
-    // Clear the notification store
-    memset((void *)http_notification_center, 0x00, sizeof(http_notification_center));
+static void http_handle_notification(const EventRecord* record, void* context) {
 
-    // Configure a notification center for network-centric notifications
-    const struct MvNotificationSetup http_notification_setup = {
-        .irq = TIM8_BRK_IRQn,
-        .buffer = (struct MvNotification *)http_notification_center,
-        .buffer_size = sizeof(http_notification_center)
-    };
+    HttpChannel* channel = http_channel(record->tag - USER_TAG_HTTP_CHANNEL_BASE);
+    if (channel == NULL) return;
 
-    // Ask Microvisor to establish the notification center
-    // and confirm that it has accepted the request
-    enum MvStatus status = mvSetupNotifications(&http_notification_setup, &http_handles.notification);
-    do_assert(status == MV_STATUS_OKAY, "Could not set up HTTP channel notification center");
-
-    // Start the notification IRQ
-    NVIC_ClearPendingIRQ(TIM8_BRK_IRQn);
-    NVIC_EnableIRQ(TIM8_BRK_IRQn);
-    server_log("HTTP notification center handle: %lu", (uint32_t)http_handles.notification);
+    if (record->event_type == MV_EVENTTYPE_CHANNELDATAREADABLE) {
+        // Received data is read when the channel is serviced
+        channel->events |= HTTP_FLAG_RESPONSE_READY;
+        channel->response_us = record->microseconds;
+    } else if (record->event_type == MV_EVENTTYPE_CHANNELNOTCONNECTED) {
+        // The HTTP channel signaled its unexpected closure
+        channel->events |= HTTP_FLAG_CHANNEL_CLOSED;
+    }
 }
 
 
 /**
- * @brief Send a stock HTTP request.
+ * @brief Send a queued request on a pool channel.
+ *
+ * If the channel is already open, it is reused. Otherwise it is opened.
+ * If the request can't be sent, it completes with the failure status.
+ * A GET that can be served from the cache completes at once instead,
+ * using the channel only to hold its response.
  *
- * @returns `true` if the request was accepted by Microvisor, otherwise `false`
+ * @param index:   The channel's index in the pool.
+ * @param request: The request.
  */
-enum MvStatus http_send_request(uint32_t item_number) {
+static void http_start_request(uint32_t index, const HttpRequest* request) {
+
+    HttpChannel* channel = &http_channels[index];
+    channel->callback = request->callback;
+    channel->context = request->context;
+    channel->waiter = request->waiter;
+    channel->response = (HttpResponse){
+        .request_id = request->request_id,
+        .channel = index
+    };
+
+    // Only whole-resource GETs take part in caching and conditional
+    // requests: a Range request's response is part of the resource
+    channel->url_hash = http_url_hash(request->url);
+    channel->cacheable = http_request_is_get(request) && !http_request_has_header(request, "Range");
+
+    // Requests without a callback hold their response after completion,
+    // so they can't be given one whose body lives in the cache
+    if (channel->cacheable && channel->callback != NULL && http_cache_lookup(channel->url_hash, &channel->response, &channel->headers)) {
+        const HttpCacheStats* stats = http_cache_get_stats();
+        server_log("HTTP request %lu served from cache. Hits: %lu, misses: %lu, evictions: %lu",
+                   request->request_id, stats->hits, stats->misses, stats->evictions);
+        http_complete_request(index, MV_STATUS_OKAY);
+        return;
+    }
+
+    mvGetMicroseconds(&channel->start_us);
+    channel->reused = channel->handle != 0;
 
     // Make sure we have a valid channel handle
-    if (http_handles.channel == 0) {
-        // There's no open channel, so open
-        // one now and try to send again
-        http_open_channel();
-        return http_send_request(item_number);
+    if (channel->handle == 0) {
+        // The channel isn't open, so open it now
+        if (!http_open_channel(index)) {
+            http_complete_request(index, MV_STATUS_CHANNELCLOSED);
+            return;
+        }
+    } else {
+        http_stats.opens_saved++;
+    }
+
+    server_log("Preparing HTTP request %lu on channel %lu", request->request_id, index);
+
+    // Build the headers in the channel's arena: the submitter's by reference,
+    // then, to make a GET conditional, the validators from the URL's last
+    // full response. The arena is reset once the response is consumed
+    HttpHeaderBuilder* headers = &channel->request_headers;
+    for (uint32_t i = 0 ; i < request->num_headers ; ++i) {
+        // Without one of its headers, the request would mean something else
+        if (!http_builder_add(headers, &request->headers[i])) {
+            server_error("HTTP request %lu has too many headers: %lu, room for %lu",
+                         request->request_id, request->num_headers, (uint32_t)HTTP_MAX_REQUEST_HEADERS);
+            http_complete_request(index, MV_STATUS_INVALIDBUFFER);
+            return;
+        }
+    }
+
+    // The engine's own headers are optional: the request works without
+    // them, just not conditionally or compressed. Only GETs ask for a
+    // compressed response, so other requests -- posts that fill the send
+    // buffer -- don't pay for the header
+    uint32_t dropped = 0;
+    if (http_request_is_get(request) && !http_request_has_header(request, "Accept-Encoding")) {
+        if (!http_builder_add(headers, &http_accept_encoding)) dropped++;
+    }
+
+    const HttpValidator* validator = channel->cacheable ? http_find_validator(channel->url_hash) : NULL;
+    if (validator != NULL && validator->etag[0] != '\0') {
+        if (!http_builder_add_text(headers, "If-None-Match: ", sizeof("If-None-Match: ") - 1, validator->etag, strlen(validator->etag))) dropped++;
+    }
+
+    if (validator != NULL && validator->last_modified[0] != '\0') {
+        if (!http_builder_add_text(headers, "If-Modified-Since: ", sizeof("If-Modified-Since: ") - 1, validator->last_modified, strlen(validator->last_modified))) dropped++;
+    }
+
+    if (dropped > 0) {
+        http_stats.headers_dropped += dropped;
+        server_error("No room for %lu of the engine's headers on HTTP request %lu. Dropped in all: %lu",
+                     dropped, request->request_id, http_stats.headers_dropped);
     }
 
-    server_log("Preparing HTTP request");
+    // Microvisor copies the request into the channel's send buffer, so
+    // make sure it fits before handing it over
+    uint32_t request_size = request->method_length + request->url_length + headers->request_size + request->body_length;
+    if (request_size > HTTP_TX_BUFFER_SIZE_B) {
+        server_error("HTTP request %lu too large: %lu bytes, %lu available", request->request_id, request_size, (uint32_t)HTTP_TX_BUFFER_SIZE_B);
+        http_complete_request(index, MV_STATUS_INVALIDBUFFER);
+        return;
+    }
 
     // Set up the request
-    const char verb[] = "GET";
-    const char body[] = "";
-    char url[64] = "";
-    snprintf(url, 64, "https://jsonplaceholder.typicode.com/todos/%lu", item_number);
-    const struct MvHttpHeader hdrs[] = {};
     const struct MvHttpRequest request_config = {
         .method = {
-            .data = (const uint8_t *)verb,
-            .length = strlen(verb)
+            .data = (const uint8_t *)request->method,
+            .length = request->method_length
         },
         .url = {
-            .data = (const uint8_t *)url,
-            .length = strlen(url)
+            .data = (const uint8_t *)request->url,
+            .length = request->url_length
         },
-        .num_headers = 0,
-        .headers = hdrs,
+        .num_headers = headers->num_headers,
+        .headers = headers->headers,
         .body = {
-            .data = (const uint8_t *)body,
-            .length = strlen(body)
+            .data = request->body,
+            .length = request->body_length
         },
         .timeout_ms = 10000
     };
 
     // Issue the request -- and check its status
-    enum MvStatus status = mvSendHttpRequest(http_handles.channel, &request_config);
+    enum MvStatus status = mvSendHttpRequest(channel->handle, &request_config);
     if (status == MV_STATUS_OKAY) {
+        channel->busy = true;
+        http_timer_start(&channel->deadline, CHANNEL_KILL_PERIOD_MS, 0);
         server_log("Request sent to the Microvisor Cloud");
-    } else if (status == MV_STATUS_CHANNELCLOSED) {
-        server_error("HTTP channel %lu already closed", (uint32_t)http_handles.channel);
+        boot_mark(BOOT_STAGE_FIRST_REQUEST);
+        return;
+    }
+
+    if (status == MV_STATUS_CHANNELCLOSED) {
+        server_error("HTTP channel %lu already closed", (uint32_t)channel->handle);
     } else {
         server_error("Could not issue request. Status: %i", status);
     }
 
-    return status;
+    // A failed send closes the channel so the next request gets a fresh one
+    channel->close_pending = true;
+    http_complete_request(index, status);
 }
 
 
 /**
- * @brief The HTTP channel notification interrupt handler.
+ * @brief Act on a channel's events: deliver its response, or fail its
+ *        request if the channel closed or the request timed out.
  *
- * This is called by Microvisor -- we need to check for key events
- * and extract HTTP response data when it is available.
+ * @param index: The channel's index in the pool.
  */
-void TIM8_BRK_IRQHandler(void) {
+static void http_service_channel(uint32_t index) {
 
-    // Check for a suitable event: readable data in the channel
-    bool got_notification = false;
-    struct MvNotification notification = http_notification_center[current_notification_index];
-    if (notification.event_type == MV_EVENTTYPE_CHANNELDATAREADABLE) {
-        // Flag we need to access received data and to close the HTTP channel
-        // when we're back in the main loop. This lets us exit the ISR quickly.
-        // We should not make Microvisor System Calls in the ISR.
-        received_request = true;
-        got_notification = true;
+    HttpChannel* channel = &http_channels[index];
+    uint32_t events = channel->events;
+    channel->events = 0;
+
+    // Respond to unexpected channel closure
+    if ((events & HTTP_FLAG_CHANNEL_CLOSED) != 0) {
+        enum MvClosureReason reason = 0;
+        if (mvGetChannelClosureReason(channel->handle, &reason) == MV_STATUS_OKAY) {
+            server_log("Closure reason: %lu", (uint32_t)reason);
+        }
+
+        channel->close_pending = true;
     }
 
-    if (notification.event_type == MV_EVENTTYPE_CHANNELNOTCONNECTED) {
-        // The HTTP channel signaled its unexpected closure
-        channel_was_closed = true;
-        got_notification = true;
+    if (channel->busy) {
+        if ((events & HTTP_FLAG_RESPONSE_READY) != 0) {
+            // Process a request's response if indicated by the ISR
+            http_complete_request(index, MV_STATUS_OKAY);
+        } else if (channel->close_pending) {
+            http_complete_request(index, MV_STATUS_CHANNELCLOSED);
+        } else if ((events & HTTP_FLAG_TIMED_OUT) != 0) {
+            // Force-close the channel if the request has been left open too long
+            server_error("HTTP request timed out");
+            channel->close_pending = true;
+            http_complete_request(index, MV_STATUS_CHANNELCLOSED);
+        }
+    }
+
+    // Close the HTTP channel if it failed or timed out. If it's not being
+    // kept open for the next request, we can also close it now we're
+    // done with the response
+    if (!channel->busy && !channel->held && channel->handle != 0
+        && (channel->close_pending || !HTTP_KEEP_CHANNEL_OPEN)) {
+        http_close_channel(index);
+    }
+}
+
+
+/**
+ * @brief Mark a channel's request as timed out, for `http_service_channel()`
+ *        to fail. Called by the engine's timers.
+ *
+ * @param timer:   The channel's deadline.
+ * @param context: The channel's index in the pool.
+ */
+static void http_request_timed_out(TimerEntry* timer, void* context) {
+
+    http_channels[(uintptr_t)context].events |= HTTP_FLAG_TIMED_OUT;
+}
+
+
+/**
+ * @brief Wake the task on the send schedule. Called by the engine's timers.
+ *
+ * @param timer:   The schedule's timer.
+ * @param context: Not used.
+ */
+static void http_pulse_due(TimerEntry* timer, void* context) {
+
+    osThreadFlagsSet(http_pulse.thread, http_pulse.flag);
+}
+
+
+/**
+ * @brief Complete a channel's request and notify its submitter.
+ *
+ * @param index:  The channel's index in the pool.
+ * @param status: `MV_STATUS_OKAY` if a response is readable, otherwise
+ *                the reason the request failed. If the channel isn't
+ *                busy, the response was served from the cache.
+ */
+static void http_complete_request(uint32_t index, enum MvStatus status) {
+
+    HttpChannel* channel = &http_channels[index];
+    HttpResponse* response = &channel->response;
+    response->status = status;
+
+    if (status == MV_STATUS_OKAY && channel->busy) {
+        // We have received data via the channel so read the response metadata
+        struct MvHttpResponseData resp_data;
+        response->status = mvReadHttpResponseData(channel->handle, &resp_data);
+        if (response->status == MV_STATUS_OKAY) {
+            boot_mark(BOOT_STAGE_FIRST_RESPONSE);
+            response->result = resp_data.result;
+            response->status_code = resp_data.status_code;
+            response->num_headers = resp_data.num_headers;
+            response->body_length = resp_data.body_length;
+
+            // Read all the headers once, up front
+            http_headers_load(&channel->headers, channel->handle, resp_data.num_headers, &response->typed);
+            response->headers = &channel->headers;
+
+            // Keep the response's validators, and the response itself
+            // if it may be reused, for the next request. A 304 confirms
+            // the cached response is still current
+            if (channel->cacheable && response->result == MV_HTTPRESULT_OK) {
+                http_update_validator(channel->url_hash, response);
+                if (response->status_code == 304) {
+                    http_cache_refresh(channel->url_hash, response);
+                } else {
+                    http_cache_store(channel->url_hash, response);
+                }
+
+                http_persist_response(index);
+            }
+        } else {
+            server_error("Response data read failed. Status: %i", response->status);
+        }
+    }
+
+    http_record_latency(index);
+    http_timer_stop(&channel->deadline);
+    channel->busy = false;
+
+    if (channel->callback != NULL) {
+        // The callback may hold the response with `http_hold()`
+        channel->callback(response, channel->context);
+    } else if (channel->waiter != NULL) {
+        // Hold the response in the channel until the submitter releases it
+        channel->held = true;
+        osThreadFlagsSet(channel->waiter, HTTP_FLAG_REQUEST_DONE);
+    }
+
+    // The response has been consumed unless it's held
+    if (!channel->held) http_builder_reset(&channel->request_headers);
+    http_record_stack();
+}
+
+
+/**
+ * @brief Record the timing of a request whose response has just arrived.
+ *
+ * @param index: The channel's index in the pool.
+ */
+static void http_record_latency(uint32_t index) {
+
+    HttpChannel* channel = &http_channels[index];
+    if (!channel->busy || channel->response.status != MV_STATUS_OKAY) return;
+
+    uint64_t latency_us = channel->response_us > channel->start_us ? channel->response_us - channel->start_us : 0;
+    if (channel->reused) {
+        http_stats.reused_requests++;
+        http_stats.reused_latency_us += latency_us;
+    } else {
+        http_stats.fresh_requests++;
+        http_stats.fresh_latency_us += latency_us;
+    }
+
+    uint32_t fresh_avg_us = http_stats.fresh_requests > 0 ? (uint32_t)(http_stats.fresh_latency_us / http_stats.fresh_requests) : 0;
+    uint32_t reused_avg_us = http_stats.reused_requests > 0 ? (uint32_t)(http_stats.reused_latency_us / http_stats.reused_requests) : 0;
+    server_log("Request latency %lu us (%s channel %lu). Opens: %lu, saved: %lu. Avg latency new/reused: %lu/%lu us",
+               (uint32_t)latency_us, channel->reused ? "reused" : "new", index,
+               http_stats.channel_opens, http_stats.opens_saved, fresh_avg_us, reused_avg_us);
+}
+
+
+/**
+ * @brief Record how much of the engine's stack has never been used, once
+ *        a response has been handled, logging each new low.
+ *
+ * NOTE The callbacks have run by now, so this includes the deepest path:
+ *      a compressed, digest-checked body streamed through its consumer.
+ *      Size HTTP_ENGINE_STACK_SIZE_B from the lowest value logged on
+ *      hardware, leaving a margin.
+ */
+static void http_record_stack(void) {
+
+    uint32_t free_b = osThreadGetStackSpace(osThreadGetId());
+    if (free_b >= http_stats.stack_free_min) return;
+
+    http_stats.stack_free_min = free_b;
+    server_log("HTTP engine stack: %lu of %lu bytes never used", free_b, (uint32_t)HTTP_ENGINE_STACK_SIZE_B);
+}
+
+
+/**
+ * @brief Hash a URL (FNV-1a).
+ *
+ * @param url: The URL.
+ *
+ * @returns The hash, which is never 0.
+ */
+static uint32_t http_url_hash(const char* url) {
+
+    uint32_t hash = digest_fnv1a(DIGEST_FNV1A_BASIS, url, strlen(url), false);
+    return hash != 0 ? hash : 1;
+}
+
+
+/**
+ * @brief Find the validators held for a URL.
+ *
+ * @param url_hash: The hash of the URL.
+ *
+ * @returns The validators, or `NULL` if there are none.
+ */
+static HttpValidator* http_find_validator(uint32_t url_hash) {
+
+    for (uint32_t i = 0 ; i < HTTP_VALIDATOR_CACHE_LEN ; ++i) {
+        if (http_validators[i].url_hash == url_hash) {
+            http_validators[i].last_used = ++http_validator_clock;
+            return &http_validators[i];
+        }
     }
 
-    if (got_notification) {
-        // Point to the next record to be written
-        current_notification_index = (current_notification_index + 1) % HTTP_NT_BUFFER_SIZE_R;
+    return NULL;
+}
+
 
-        // Clear the current notifications event
-        // See https://www.twilio.com/docs/iot/microvisor/microvisor-notifications#buffer-overruns
-        notification.event_type = 0;
+/**
+ * @brief Record or refresh a URL's validators from its response.
+ *
+ * A full response replaces them, or drops them if it has none. A 304
+ * leaves them as they are. The least recently used URL's validators
+ * make way for a new URL's.
+ *
+ * @param url_hash: The hash of the URL.
+ * @param response: The response.
+ */
+static void http_update_validator(uint32_t url_hash, const HttpResponse* response) {
+
+    if (response->status_code != 200) return;
+
+    HttpValidator* validator = http_find_validator(url_hash);
+    if (response->typed.etag == NULL && response->typed.last_modified == NULL) {
+        if (validator != NULL) validator->url_hash = 0;
+        return;
+    }
+
+    if (validator == NULL) {
+        validator = &http_validators[0];
+        for (uint32_t i = 1 ; i < HTTP_VALIDATOR_CACHE_LEN ; ++i) {
+            if (http_validators[i].last_used < validator->last_used) validator = &http_validators[i];
+        }
+
+        validator->url_hash = url_hash;
+        validator->last_used = ++http_validator_clock;
+    }
+
+    http_copy_validator(validator->etag, response->typed.etag, sizeof(validator->etag));
+    http_copy_validator(validator->last_modified, response->typed.last_modified, sizeof(validator->last_modified));
+}
+
+
+/**
+ * @brief Store a validator, or clear it if absent or too long to send back intact.
+ *
+ * @param destination: The validator store.
+ * @param source:      The header value, or `NULL`.
+ * @param size:        The size of the store in bytes.
+ */
+static void http_copy_validator(char* destination, const char* source, uint32_t size) {
+
+    destination[0] = '\0';
+    if (source != NULL && strlen(source) < size) strcpy(destination, source);
+}
+
+
+/**
+ * @brief Check whether a request's submitter gave it a header.
+ *
+ * @param request: The request.
+ * @param name:    The header's name.
+ *
+ * @returns `true` if the request has the header, otherwise `false`.
+ */
+static bool http_request_has_header(const HttpRequest* request, const char* name) {
+
+    uint32_t length = strlen(name);
+    for (uint32_t i = 0 ; i < request->num_headers ; ++i) {
+        const struct MvHttpHeader* header = &request->headers[i];
+        if (header->length > length && header->data[length] == ':' && strncasecmp((const char*)header->data, name, length) == 0) return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Check whether a request is a GET.
+ *
+ * @param request: The request.
+ *
+ * @returns `true` if the request's method is GET, otherwise `false`.
+ */
+static bool http_request_is_get(const HttpRequest* request) {
+
+    return request->method_length == 3 && memcmp(request->method, "GET", 3) == 0;
+}
+
+
+/**
+ * @brief Read a response's body as sent and pass it to a consumer in
+ *        fixed-size chunks. Each chunk is read into the same small
+ *        buffer, so the RAM needed doesn't depend on the size of the body.
+ *        If the response has a Content-Digest, each chunk is also hashed,
+ *        and the body checked once the consumer has had it all.
+ *
+ * @param response: The response.
+ * @param consumer: Called with each chunk in turn.
+ * @param context:  Passed to the consumer.
+ *
+ * @returns The Microvisor status of the first failed read,
+ *          `MV_STATUS_INVALIDBUFFER` if the body does not match its
+ *          digest, otherwise `MV_STATUS_OKAY`.
+ */
+static enum MvStatus http_read_chunks(const HttpResponse* response, HttpBodyConsumer consumer, void* context) {
+
+    uint8_t chunk[HTTP_BODY_CHUNK_SIZE_B];
+    uint32_t offset = 0;
+
+    // A body with a Content-Digest is hashed as it is read, as sent
+    uint8_t expected[DIGEST_SHA256_SIZE_B];
+    const char* content_digest = response->typed.content_digest;
+    bool verify = content_digest != NULL && digest_parse_sha256(content_digest, expected);
+    DigestSha256 sha;
+    uint64_t hash_us = 0;
+    if (verify) digest_sha256_init(&sha);
+
+    while (offset < response->body_length) {
+        uint32_t length = response->body_length - offset;
+        if (length > sizeof(chunk)) length = sizeof(chunk);
+
+        enum MvStatus status = http_read_body(response, offset, chunk, length);
+        if (status != MV_STATUS_OKAY) return status;
+
+        if (verify) {
+            uint64_t start_us = 0;
+            uint64_t end_us = 0;
+            mvGetMicroseconds(&start_us);
+            digest_sha256_update(&sha, chunk, length);
+            mvGetMicroseconds(&end_us);
+            hash_us += end_us > start_us ? end_us - start_us : 0;
+        }
+
+        if (!consumer(chunk, length, context)) {
+            // The consumer has stopped, so the body can't be checked
+            verify = false;
+            break;
+        }
+
+        offset += length;
+    }
+
+    if (verify) {
+        // The consumer has had the body already, and must drop it on failure
+        uint8_t digest[DIGEST_SHA256_SIZE_B];
+        digest_sha256_final(&sha, digest);
+        http_stats.digests_checked++;
+        http_stats.digest_bytes += response->body_length;
+        http_stats.digest_us += hash_us;
+        if (!digest_equal(digest, expected, DIGEST_SHA256_SIZE_B)) {
+            http_stats.digest_failures++;
+            server_error("Response %lu body does not match its Content-Digest", response->request_id);
+            return MV_STATUS_INVALIDBUFFER;
+        }
+
+        uint32_t rate_kbs = (uint32_t)(http_stats.digest_bytes * 1000 / (http_stats.digest_us > 0 ? http_stats.digest_us : 1));
+        server_log("Verified SHA-256 of response %lu: %lu bytes in %lu us. Bodies: %lu, %lu KB/s",
+                   response->request_id, response->body_length, (uint32_t)hash_us, http_stats.digests_checked, rate_kbs);
+    }
+
+    return MV_STATUS_OKAY;
+}
+
+
+/**
+ * @brief Pass a chunk of a compressed response body to an inflater,
+ *        which passes what it inflates on to the body's consumer.
+ *
+ * @param data:    The chunk.
+ * @param length:  The size of the chunk in bytes.
+ * @param context: The inflater.
+ *
+ * @returns `true` to read the next chunk, or `false` if the body is
+ *          corrupt or the consumer has stopped.
+ */
+static bool http_feed_inflater(const uint8_t* data, uint32_t length, void* context) {
+
+    return inflate_feed((Inflater*)context, data, length);
+}
+
+
+/**
+ * @brief Pass a chunk of a response body to a JSON decoder.
+ *
+ * @param data:    The chunk.
+ * @param length:  The size of the chunk in bytes.
+ * @param context: The decoder.
+ *
+ * @returns `true` to read the next chunk, or `false` if the body is malformed.
+ */
+static bool http_feed_json(const uint8_t* data, uint32_t length, void* context) {
+
+    return json_decoder_feed((JsonDecoder*)context, data, length);
+}
+
+
+/**
+ * @brief Pass a chunk of a response body to a CBOR decoder.
+ *
+ * @param data:    The chunk.
+ * @param length:  The size of the chunk in bytes.
+ * @param context: The decoder.
+ *
+ * @returns `true` to read the next chunk, or `false` if the body is malformed.
+ */
+static bool http_feed_cbor(const uint8_t* data, uint32_t length, void* context) {
+
+    return cbor_decoder_feed((CborDecoder*)context, data, length);
+}
+
+
+/**
+ * @brief Read the responses kept in flash and take up their validators,
+ *        so the first GETs for their URLs are conditional.
+ */
+static void http_load_persisted(void) {
+
+    if (!flash_cache_init()) {
+        server_error("Could not read the flash cache");
+        return;
+    }
+
+    // No request is in flight yet, so a channel's header table is free to use
+    HttpResponse response;
+    uint32_t url_hash = 0;
+    for (uint32_t i = 0 ; flash_cache_get_key(i, &url_hash) ; ++i) {
+        if (http_unpack_persisted(url_hash, &response, &http_channels[0].headers)) http_update_validator(url_hash, &response);
+    }
+
+    const FlashCacheStats* stats = flash_cache_get_stats();
+    server_log("Flash cache: %lu responses (%lu bytes). Page erases: %lu..%lu",
+               stats->records, stats->live_bytes, stats->min_erase_count, stats->max_erase_count);
+}
+
+
+/**
+ * @brief Get the response to a URL kept in flash.
+ *
+ * @param url_hash: The hash of the URL.
+ * @param response: Receives the response. Its body is read in place.
+ * @param headers:  Receives the response's headers.
+ *
+ * @returns `true` if there is such a response, otherwise `false`.
+ */
+static bool http_unpack_persisted(uint32_t url_hash, HttpResponse* response, HttpHeaderTable* headers) {
+
+    uint32_t length = 0;
+    const uint8_t* data = flash_cache_find(url_hash, &length);
+    if (data == NULL || length < sizeof(HttpPersistedResponse)) return false;
+
+    HttpPersistedResponse persisted;
+    memcpy(&persisted, data, sizeof(persisted));
+    if (sizeof(persisted) + persisted.headers_length + persisted.body_length != length) return false;
+
+    data += sizeof(persisted);
+    http_headers_unpack(headers, data, persisted.num_headers, persisted.headers_length, &response->typed);
+    response->status = MV_STATUS_OKAY;
+    response->result = MV_HTTPRESULT_OK;
+    response->status_code = persisted.status_code;
+    response->num_headers = persisted.num_headers;
+    response->body_length = persisted.body_length;
+    response->body = data + persisted.headers_length;
+    response->headers = headers;
+    return true;
+}
+
+
+/**
+ * @brief Keep a persisted URL's response in flash, or stand its stored
+ *        response in for a 304.
+ *
+ * @param index: The channel's index in the pool.
+ */
+static void http_persist_response(uint32_t index) {
+
+    HttpChannel* channel = &http_channels[index];
+    HttpResponse* response = &channel->response;
+
+    if (response->status_code == 304) {
+        // Requests without a callback hold their response, so they
+        // can't be given one that a later flash write may move
+        if (channel->callback != NULL && http_unpack_persisted(channel->url_hash, response, &channel->headers)) {
+            server_log("HTTP request %lu not modified: using the response kept in flash", response->request_id);
+        }
+
+        return;
+    }
+
+    bool persisted_url = false;
+    for (uint32_t i = 0 ; i < HTTP_PERSIST_MAX_URLS ; ++i) {
+        if (http_persisted_urls[i] == channel->url_hash) persisted_url = true;
+    }
+
+    // Without validators, the response can't be confirmed after a restart
+    // so there is no point keeping it. Nor is any response it replaces
+    const HttpHeaderTable* headers = response->headers;
+    if (!persisted_url || response->status_code != 200 || headers->truncated
+        || (response->typed.etag == NULL && response->typed.last_modified == NULL)) {
+        flash_cache_remove(channel->url_hash);
+        return;
+    }
+
+    const HttpPersistedResponse persisted = {
+        .status_code = response->status_code,
+        .body_length = response->body_length,
+        .num_headers = (uint16_t)headers->count,
+        .headers_length = (uint16_t)http_headers_pack(headers, NULL, 0)
+    };
+
+    // Write the headers in their packed form, straight from the table
+    bool stored = flash_cache_begin(channel->url_hash, sizeof(persisted) + persisted.headers_length + persisted.body_length)
+                  && flash_cache_write(&persisted, sizeof(persisted))
+                  && flash_cache_write(headers->entries, headers->count * sizeof(HttpHeader))
+                  && flash_cache_write(headers->arena, headers->arena_used);
+
+    uint8_t chunk[HTTP_BODY_CHUNK_SIZE_B];
+    for (uint32_t offset = 0 ; stored && offset < response->body_length ; offset += sizeof(chunk)) {
+        uint32_t length = response->body_length - offset;
+        if (length > sizeof(chunk)) length = sizeof(chunk);
+        stored = http_read_body(response, offset, chunk, length) == MV_STATUS_OKAY && flash_cache_write(chunk, length);
+    }
+
+    if (stored && flash_cache_commit()) {
+        server_log("HTTP response to request %lu kept in flash", response->request_id);
+    } else {
+        flash_cache_abort();
+        server_error("Could not keep HTTP response to request %lu in flash", response->request_id);
     }
 }
@@ -15,7 +15,65 @@
  */
 #define     HTTP_RX_BUFFER_SIZE_B       2560
 #define     HTTP_TX_BUFFER_SIZE_B       512
-#define     HTTP_NT_BUFFER_SIZE_R       8
+
+// Thread flags raised on the HTTP engine task. The first two are also
+// kept per channel, once the engine has dispatched its notifications, as
+// is HTTP_FLAG_TIMED_OUT, raised by the channel's request deadline
+#define     HTTP_FLAG_RESPONSE_READY    0x01
+#define     HTTP_FLAG_CHANNEL_CLOSED    0x02
+#define     HTTP_FLAG_TIMED_OUT         0x20
+#define     HTTP_FLAG_REQUEST_QUEUED    0x04
+#define     HTTP_FLAG_TELEMETRY         0x08
+#define     HTTP_FLAG_NOTIFICATION      0x10
+#define     HTTP_FLAGS_ALL              (HTTP_FLAG_REQUEST_QUEUED | HTTP_FLAG_TELEMETRY | HTTP_FLAG_NOTIFICATION)
+
+// Thread flag raised on a submitting task when its request, made
+// without a callback, has completed. See `http_submit()`
+#define     HTTP_FLAG_REQUEST_DONE      0x0100
+
+// Set to false to close the HTTP channel after every response
+#define     HTTP_KEEP_CHANNEL_OPEN      true
+
+// Channels in the pool, ie. the maximum number of requests in flight.
+// Each channel's notifications are tagged with its pool index plus the base
+#ifndef HTTP_CHANNEL_POOL_SIZE
+#define     HTTP_CHANNEL_POOL_SIZE      3
+#endif
+#define     USER_TAG_HTTP_CHANNEL_BASE  0x100
+
+// The engine task's stack. It runs the response callbacks, which may
+// inflate and digest-check bodies, so watch `stack_free_min` in the
+// stats before cutting it
+#define     HTTP_ENGINE_STACK_SIZE_B    12288
+
+// Submitted requests awaiting a free channel
+#define     HTTP_REQUEST_QUEUE_LEN      8
+#define     HTTP_MAX_METHOD_LEN         8
+#define     HTTP_MAX_URL_LEN            128
+
+// Request headers, including those the engine adds itself. Each channel
+// builds its request's headers in an arena of entries plus text, which
+// holds the engine's conditional headers at their longest
+#define     HTTP_MAX_REQUEST_HEADERS    8
+#define     HTTP_ADDED_HEADERS          3
+#define     HTTP_REQUEST_TEXT_SIZE_B    160
+#define     HTTP_REQUEST_ARENA_SIZE_B   (HTTP_MAX_REQUEST_HEADERS * sizeof(struct MvHttpHeader) + HTTP_REQUEST_TEXT_SIZE_B)
+
+// Validators kept from GET responses, for conditional requests.
+// An IMF-fixdate, as used by Last-Modified, is 29 characters
+#define     HTTP_VALIDATOR_CACHE_LEN    24
+#define     HTTP_MAX_ETAG_LEN           64
+#define     HTTP_MAX_DATE_LEN           32
+
+// Response bodies are streamed to consumers in chunks of this size
+#define     HTTP_BODY_CHUNK_SIZE_B      128
+
+// Sent with every GET. Compressed bodies are inflated as they are
+// streamed, through a window of `INFLATE_WINDOW_SIZE_B` per channel
+#define     HTTP_ACCEPT_ENCODING        "Accept-Encoding: gzip, deflate"
+
+// URLs whose responses may be kept in flash. See `http_persist_url()`
+#define     HTTP_PERSIST_MAX_URLS       8
 
 
 #ifdef __cplusplus
@@ -23,14 +81,161 @@ extern "C" {
 #endif
 
 
+/*
+ * TYPES
+ */
+// Channel reuse counters. Latency runs from the start of a request,
+// including any channel open, to its response becoming readable.
+// Inflate time includes the consumer's handling of the inflated data.
+// Digest time is hashing alone. `headers_dropped` counts headers the
+// engine would have added but had no room for. `stack_free_min` is the
+// least of the engine's stack left unused after a response, UINT32_MAX
+// until the first
+typedef struct {
+    uint32_t    channel_opens;
+    uint32_t    opens_saved;
+    uint32_t    fresh_requests;
+    uint32_t    reused_requests;
+    uint64_t    fresh_latency_us;
+    uint64_t    reused_latency_us;
+    uint32_t    inflated_bodies;
+    uint32_t    inflate_failures;
+    uint64_t    inflate_in_bytes;
+    uint64_t    inflate_out_bytes;
+    uint64_t    inflate_us;
+    uint32_t    digests_checked;
+    uint32_t    digest_failures;
+    uint64_t    digest_bytes;
+    uint64_t    digest_us;
+    uint32_t    headers_dropped;
+    uint32_t    stack_free_min;
+} HttpStats;
+
+// The outcome of a request, passed to its completion callback.
+// `status` is `MV_STATUS_OKAY` if a response was received, in which
+// case the other fields are valid, the headers can be looked up with
+// `http_find_header()` and the body read with `http_read_body()`, as
+// sent, or with `http_stream_body()`, inflated if it was compressed and
+// checked against its Content-Digest if it has one.
+// `body` is set when the response was served from the cache
+typedef struct {
+    uint32_t                request_id;
+    uint32_t                channel;
+    enum MvStatus           status;
+    enum MvHttpResult       result;
+    uint32_t                status_code;
+    uint32_t                num_headers;
+    uint32_t                body_length;
+    HttpTypedHeaders        typed;
+    const HttpHeaderTable*  headers;
+    // Set if the response was served from the cache, in which case the
+    // body and header values point into the cache, and are valid only
+    // until the callback returns: such responses can't be held
+    const uint8_t*          body;
+} HttpResponse;
+
+typedef void (*HttpCallback)(const HttpResponse* response, void* context);
+
+// The outcome of decoding a response body into a struct
+typedef enum {
+    HTTP_DECODE_OK = 0,
+    HTTP_DECODE_UNSUPPORTED,
+    HTTP_DECODE_READ_FAILED,
+    HTTP_DECODE_INCOMPLETE
+} HttpDecodeResult;
+
+// Receives a response body chunk by chunk. Return `false` to stop reading
+typedef bool (*HttpBodyConsumer)(const uint8_t* data, uint32_t length, void* context);
+
+// A submitted request, as queued for the engine. The method and URL are
+// copied in, with their lengths; the headers and body must remain valid
+// until completion
+typedef struct {
+    uint32_t                    request_id;
+    char                        method[HTTP_MAX_METHOD_LEN];
+    char                        url[HTTP_MAX_URL_LEN];
+    uint32_t                    method_length;
+    uint32_t                    url_length;
+    const struct MvHttpHeader*  headers;
+    uint32_t                    num_headers;
+    const uint8_t*              body;
+    uint32_t                    body_length;
+    HttpCallback                callback;
+    void*                       context;
+    osThreadId_t                waiter;
+} HttpRequest;
+
+// The validators of a URL's last full response, sent back as
+// If-None-Match and If-Modified-Since so an unchanged resource
+// comes back as a bodiless 304
+typedef struct {
+    uint32_t    url_hash;
+    uint32_t    last_used;
+    char        etag[HTTP_MAX_ETAG_LEN + 1];
+    char        last_modified[HTTP_MAX_DATE_LEN + 1];
+} HttpValidator;
+
+// How a response is kept in flash: this, then its headers as packed
+// by `http_headers_pack()`, then its body
+typedef struct {
+    uint32_t    status_code;
+    uint32_t    body_length;
+    uint16_t    num_headers;
+    uint16_t    headers_length;
+} HttpPersistedResponse;
+
+// A pool channel and the request it's carrying
+typedef struct {
+    uint8_t             rx_buffer[HTTP_RX_BUFFER_SIZE_B] __attribute__((aligned(512)));
+    uint8_t             tx_buffer[HTTP_TX_BUFFER_SIZE_B] __attribute__((aligned(512)));
+    uint8_t             request_arena[HTTP_REQUEST_ARENA_SIZE_B] __attribute__((aligned(8)));
+    Inflater            inflater;
+    HttpHeaderBuilder   request_headers;
+    MvChannelHandle     handle;
+    bool                busy;
+    bool                reused;
+    bool                close_pending;
+    volatile bool       held;
+    TimerEntry          deadline;
+    uint64_t            start_us;
+    uint64_t            response_us;
+    uint32_t            events;
+    HttpCallback        callback;
+    void*               context;
+    osThreadId_t        waiter;
+    uint32_t            url_hash;
+    bool                cacheable;
+    HttpResponse        response;
+    HttpHeaderTable     headers;
+} HttpChannel;
+
+
 /*
  * PROTOTYPES
  */
-void            http_setup_notification_center(void);
-bool            http_open_channel(void);
-void            http_close_channel(void);
-MvChannelHandle http_get_handle(void);
-enum MvStatus   http_send_request(uint32_t item_number);
+bool                http_start_engine(void);
+uint32_t            http_submit(const char* method, const char* url,
+                                const struct MvHttpHeader* headers, uint32_t num_headers,
+                                const uint8_t* body, uint32_t body_length,
+                                HttpCallback callback, void* context);
+uint32_t            http_submit_template(const HttpTemplate* tmpl, uint32_t field,
+                                         HttpCallback callback, void* context);
+const HttpResponse* http_get_response(uint32_t request_id);
+bool                http_hold(const HttpResponse* response);
+void                http_release(uint32_t request_id);
+const char*         http_find_header(const HttpResponse* response, const char* name);
+bool                http_get_header(const HttpResponse* response, uint32_t index, const char** name, const char** value);
+enum MvStatus       http_read_body(const HttpResponse* response, uint32_t offset, uint8_t* buffer, uint32_t size);
+enum MvStatus       http_stream_body(const HttpResponse* response, HttpBodyConsumer consumer, void* context);
+HttpDecodeResult    http_decode_body(const HttpResponse* response, const JsonSchema* schema, void* target, uint32_t* found);
+void                http_forget_validators(const char* url);
+bool                http_persist_url(const char* url);
+void                http_wake_engine(void);
+void                http_timer_start(TimerEntry* timer, uint32_t delay_ms, uint32_t period_ms);
+void                http_timer_stop(TimerEntry* timer);
+bool                http_start_pulse(uint32_t period_ms, uint32_t flag);
+const HttpStats*    http_get_stats(void);
+const TimerWheelStats* http_get_timer_stats(void);
 
 
 #ifdef __cplusplus
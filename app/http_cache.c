@@ -0,0 +1,253 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static uint32_t         http_cache_now(void);
+static int32_t          http_cache_freshness(const HttpResponse* response);
+static HttpCacheEntry*  http_cache_find(uint32_t url_hash);
+static void             http_cache_remove(HttpCacheEntry* entry);
+static HttpCacheEntry*  http_cache_least_recent(void);
+
+
+/*
+ * GLOBALS
+ */
+// Cached responses' packed headers and bodies, kept contiguous from
+// the start of the arena. Entries with a `url_hash` of 0 are free
+static uint8_t          http_cache_arena[HTTP_CACHE_SIZE_B] __attribute__((aligned(4)));
+static HttpCacheEntry   http_cache_entries[HTTP_CACHE_MAX_ENTRIES];
+static uint32_t         http_cache_clock = 0;
+
+static HttpCacheStats   http_cache_stats = { 0 };
+
+
+/**
+ * @brief Serve a request from the cache if it holds a fresh response.
+ *
+ * The response's body points into the cache, so it is valid only
+ * until the next response is stored, and `http_hold()` refuses it.
+ *
+ * @param url_hash: The hash of the request's URL.
+ * @param response: Receives the cached response.
+ * @param headers:  Receives the cached response's headers.
+ *
+ * @returns `true` if the response was served, otherwise `false`.
+ */
+bool http_cache_lookup(uint32_t url_hash, HttpResponse* response, HttpHeaderTable* headers) {
+
+    HttpCacheEntry* entry = http_cache_find(url_hash);
+    if (entry == NULL || (int32_t)(entry->expires_s - http_cache_now()) <= 0) {
+        // A stale entry is kept: a 304 for a conditional request can refresh it
+        http_cache_stats.misses++;
+        return false;
+    }
+
+    entry->last_used = ++http_cache_clock;
+    http_cache_stats.hits++;
+
+    const uint8_t* data = &http_cache_arena[entry->offset];
+    http_headers_unpack(headers, data, entry->num_headers, entry->headers_length, &response->typed);
+    response->status = MV_STATUS_OKAY;
+    response->result = MV_HTTPRESULT_OK;
+    response->status_code = entry->status_code;
+    response->num_headers = entry->num_headers;
+    response->body_length = entry->body_length;
+    response->body = data + entry->headers_length;
+    response->headers = headers;
+    return true;
+}
+
+
+/**
+ * @brief Keep a response if its headers allow it to be reused.
+ *
+ * Only complete 200 responses with a freshness lifetime from
+ * Cache-Control or Expires are stored. The least recently used
+ * responses make way for it.
+ *
+ * @param url_hash: The hash of the request's URL.
+ * @param response: The response, whose body is still readable.
+ */
+void http_cache_store(uint32_t url_hash, const HttpResponse* response) {
+
+    // Drop any earlier response for the URL, whatever becomes of this one
+    HttpCacheEntry* entry = http_cache_find(url_hash);
+    if (entry != NULL) http_cache_remove(entry);
+
+    int32_t freshness = http_cache_freshness(response);
+    if (response->status_code != 200 || freshness <= 0 || response->headers->truncated) return;
+
+    uint32_t headers_length = http_headers_pack(response->headers, NULL, 0);
+    uint32_t size = (headers_length + response->body_length + 3) & ~3u;
+    if (size > HTTP_CACHE_MAX_ENTRY_B) return;
+
+    // Find a free entry, and room for the data at the end of the arena
+    entry = NULL;
+    for (uint32_t i = 0 ; i < HTTP_CACHE_MAX_ENTRIES ; ++i) {
+        if (http_cache_entries[i].url_hash == 0) {
+            entry = &http_cache_entries[i];
+            break;
+        }
+    }
+
+    while (entry == NULL || HTTP_CACHE_SIZE_B - http_cache_stats.bytes_used < size) {
+        HttpCacheEntry* victim = http_cache_least_recent();
+        http_cache_remove(victim);
+        http_cache_stats.evictions++;
+        if (entry == NULL) entry = victim;
+    }
+
+    uint8_t* data = &http_cache_arena[http_cache_stats.bytes_used];
+    http_headers_pack(response->headers, data, headers_length);
+    if (http_read_body(response, 0, data + headers_length, response->body_length) != MV_STATUS_OKAY) return;
+
+    *entry = (HttpCacheEntry){
+        .url_hash = url_hash,
+        .expires_s = http_cache_now() + (uint32_t)freshness,
+        .last_used = ++http_cache_clock,
+        .offset = http_cache_stats.bytes_used,
+        .status_code = response->status_code,
+        .body_length = response->body_length,
+        .headers_length = (uint16_t)headers_length,
+        .num_headers = (uint16_t)response->headers->count
+    };
+
+    http_cache_stats.bytes_used += size;
+    http_cache_stats.stores++;
+}
+
+
+/**
+ * @brief Extend the life of a cached response after a 304 confirms it.
+ *
+ * @param url_hash: The hash of the request's URL.
+ * @param response: The 304 response.
+ */
+void http_cache_refresh(uint32_t url_hash, const HttpResponse* response) {
+
+    HttpCacheEntry* entry = http_cache_find(url_hash);
+    if (entry == NULL) return;
+
+    int32_t freshness = http_cache_freshness(response);
+    if (freshness > 0) {
+        entry->expires_s = http_cache_now() + (uint32_t)freshness;
+    } else if (response->typed.cache_control.no_store) {
+        http_cache_remove(entry);
+    }
+}
+
+
+/**
+ * @brief Provide the cache counters.
+ *
+ * @returns The counters.
+ */
+const HttpCacheStats* http_cache_get_stats(void) {
+
+    return &http_cache_stats;
+}
+
+
+/**
+ * @brief Get the time since boot in seconds.
+ */
+static uint32_t http_cache_now(void) {
+
+    uint64_t us = 0;
+    mvGetMicroseconds(&us);
+    return (uint32_t)(us / 1000000);
+}
+
+
+/**
+ * @brief Work out how long a response may be reused for.
+ *
+ * Cache-Control's max-age takes precedence over Expires,
+ * which is taken relative to the response's Date.
+ *
+ * @param response: The response.
+ *
+ * @returns The freshness lifetime in seconds, or 0 if it can't be reused.
+ */
+static int32_t http_cache_freshness(const HttpResponse* response) {
+
+    const HttpCacheControl* cache_control = &response->typed.cache_control;
+    if (cache_control->no_store || cache_control->no_cache) return 0;
+    if (cache_control->max_age != HTTP_NO_MAX_AGE) return cache_control->max_age;
+
+    uint32_t expires = 0;
+    uint32_t date = 0;
+    if (!http_parse_date(http_find_header(response, "expires"), &expires)
+        || !http_parse_date(http_find_header(response, "date"), &date)) return 0;
+    return expires > date ? (int32_t)(expires - date) : 0;
+}
+
+
+/**
+ * @brief Find a URL's cached response.
+ *
+ * @param url_hash: The hash of the URL.
+ *
+ * @returns The entry, or `NULL` if there is none.
+ */
+static HttpCacheEntry* http_cache_find(uint32_t url_hash) {
+
+    for (uint32_t i = 0 ; i < HTTP_CACHE_MAX_ENTRIES ; ++i) {
+        if (http_cache_entries[i].url_hash == url_hash) return &http_cache_entries[i];
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Free a cached response, closing up the gap its data leaves.
+ *
+ * @param entry: The entry.
+ */
+static void http_cache_remove(HttpCacheEntry* entry) {
+
+    uint32_t size = (entry->headers_length + entry->body_length + 3) & ~3u;
+    uint32_t end = entry->offset + size;
+    memmove(&http_cache_arena[entry->offset], &http_cache_arena[end], http_cache_stats.bytes_used - end);
+    http_cache_stats.bytes_used -= size;
+
+    for (uint32_t i = 0 ; i < HTTP_CACHE_MAX_ENTRIES ; ++i) {
+        if (http_cache_entries[i].url_hash != 0 && http_cache_entries[i].offset > entry->offset) {
+            http_cache_entries[i].offset -= size;
+        }
+    }
+
+    entry->url_hash = 0;
+}
+
+
+/**
+ * @brief Find the least recently used cached response.
+ *
+ * Only called when the cache is not empty.
+ *
+ * @returns The entry.
+ */
+static HttpCacheEntry* http_cache_least_recent(void) {
+
+    HttpCacheEntry* oldest = NULL;
+    for (uint32_t i = 0 ; i < HTTP_CACHE_MAX_ENTRIES ; ++i) {
+        HttpCacheEntry* entry = &http_cache_entries[i];
+        if (entry->url_hash != 0 && (oldest == NULL || (int32_t)(entry->last_used - oldest->last_used) < 0)) {
+            oldest = entry;
+        }
+    }
+
+    return oldest;
+}
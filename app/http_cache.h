@@ -0,0 +1,68 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _HTTP_CACHE_H_
+#define _HTTP_CACHE_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Static memory for cached headers and bodies, and the most responses held
+#define     HTTP_CACHE_SIZE_B           8192
+#define     HTTP_CACHE_MAX_ENTRIES      16
+
+// Larger responses are not cached, so one can't flush all the others
+#define     HTTP_CACHE_MAX_ENTRY_B      (HTTP_CACHE_SIZE_B / 4)
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+// A cached response. Its packed headers and then its body are
+// stored at `offset` in the cache's arena
+typedef struct {
+    uint32_t    url_hash;
+    uint32_t    expires_s;
+    uint32_t    last_used;
+    uint32_t    offset;
+    uint32_t    status_code;
+    uint32_t    body_length;
+    uint16_t    headers_length;
+    uint16_t    num_headers;
+} HttpCacheEntry;
+
+typedef struct {
+    uint32_t    hits;
+    uint32_t    misses;
+    uint32_t    stores;
+    uint32_t    evictions;
+    uint32_t    bytes_used;
+} HttpCacheStats;
+
+
+/*
+ * PROTOTYPES
+ */
+bool                    http_cache_lookup(uint32_t url_hash, HttpResponse* response, HttpHeaderTable* headers);
+void                    http_cache_store(uint32_t url_hash, const HttpResponse* response);
+void                    http_cache_refresh(uint32_t url_hash, const HttpResponse* response);
+const HttpCacheStats*   http_cache_get_stats(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _HTTP_CACHE_H_
@@ -0,0 +1,434 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     http_headers_index(HttpHeaderTable* table, uint32_t entry);
+static void     http_headers_parse_typed(const HttpHeaderTable* table, HttpTypedHeaders* typed);
+static bool     http_token_equals(const char* text, uint32_t length, const char* token);
+static int32_t  http_parse_number(const char* text, uint32_t digits);
+
+
+/**
+ * @brief Read all of a response's headers into a table.
+ *
+ * Each header is read once, straight into the table's arena, and split
+ * into its name and value there. Headers that don't fit the arena or
+ * the table are dropped, and `truncated` is set.
+ *
+ * @param table:       The table to fill.
+ * @param handle:      The channel holding the response.
+ * @param num_headers: The number of headers in the response.
+ * @param typed:       Receives the typed values of key headers.
+ */
+void http_headers_load(HttpHeaderTable* table, MvChannelHandle handle, uint32_t num_headers, HttpTypedHeaders* typed) {
+
+    // Zero the arena once, so each header read into it is terminated
+    memset((void *)table, 0x00, sizeof(HttpHeaderTable));
+
+    for (uint32_t i = 0 ; i < num_headers ; ++i) {
+        // Leave room for the terminator. Microvisor doesn't add one
+        uint32_t space = sizeof(table->arena) - table->arena_used - 1;
+        if (table->count == HTTP_MAX_HEADERS || space < 2) {
+            table->truncated = true;
+            break;
+        }
+
+        char* line = &table->arena[table->arena_used];
+        if (mvReadHttpResponseHeader(handle, i, (uint8_t*)line, space) != MV_STATUS_OKAY) continue;
+        uint32_t length = strnlen(line, space);
+        if (length == space) {
+            // The header may not have fit: drop it and those after it
+            memset((void *)line, 0x00, space);
+            table->truncated = true;
+            break;
+        }
+
+        // Split 'Name: value' by terminating the name at the colon
+        char* colon = memchr(line, ':', length);
+        if (colon == NULL) {
+            memset((void *)line, 0x00, length);
+            continue;
+        }
+
+        *colon = '\0';
+        char* value = colon + 1;
+        while (*value == ' ' || *value == '\t') value++;
+        char* end = line + length;
+        while (end > value && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) *--end = '\0';
+
+        HttpHeader* header = &table->entries[table->count];
+        header->name_offset = (uint16_t)(line - table->arena);
+        header->value_offset = (uint16_t)(value - table->arena);
+        header->hash = http_header_hash(line, (uint32_t)(colon - line));
+        http_headers_index(table, table->count++);
+        table->arena_used += length + 1;
+    }
+
+    http_headers_parse_typed(table, typed);
+}
+
+
+/**
+ * @brief Look up a header's value by name.
+ *
+ * @param table: The table.
+ * @param name:  The header name, in any case.
+ *
+ * @returns The value, or `NULL` if the response has no such header.
+ */
+const char* http_headers_find(const HttpHeaderTable* table, const char* name) {
+
+    uint32_t hash = http_header_hash(name, strlen(name));
+    for (uint32_t probe = 0 ; probe < HTTP_HEADER_SLOTS ; ++probe) {
+        uint8_t slot = table->slots[(hash + probe) & (HTTP_HEADER_SLOTS - 1)];
+        if (slot == 0) break;
+
+        const HttpHeader* header = &table->entries[slot - 1];
+        if (header->hash == hash && strcasecmp(&table->arena[header->name_offset], name) == 0) {
+            return &table->arena[header->value_offset];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Get a header by its position in the response.
+ *
+ * @param table: The table.
+ * @param index: The header's index.
+ * @param name:  Receives the header's name.
+ * @param value: Receives the header's value.
+ *
+ * @returns `true` if there is such a header, otherwise `false`.
+ */
+bool http_headers_get(const HttpHeaderTable* table, uint32_t index, const char** name, const char** value) {
+
+    if (index >= table->count) return false;
+    *name = &table->arena[table->entries[index].name_offset];
+    *value = &table->arena[table->entries[index].value_offset];
+    return true;
+}
+
+
+/**
+ * @brief Copy a table's headers into a compact form for storage.
+ *
+ * The form is the table's entries followed by the used part of its arena.
+ *
+ * @param table:  The table.
+ * @param buffer: Receives the packed headers, or `NULL` to just get their size.
+ * @param size:   The size of the buffer in bytes.
+ *
+ * @returns The size of the packed headers in bytes, or 0 if they don't fit.
+ */
+uint32_t http_headers_pack(const HttpHeaderTable* table, uint8_t* buffer, uint32_t size) {
+
+    uint32_t entries_size = table->count * sizeof(HttpHeader);
+    uint32_t packed_size = entries_size + table->arena_used;
+    if (buffer == NULL) return packed_size;
+    if (packed_size > size) return 0;
+
+    memcpy(buffer, table->entries, entries_size);
+    memcpy(buffer + entries_size, table->arena, table->arena_used);
+    return packed_size;
+}
+
+
+/**
+ * @brief Rebuild a table from headers packed by `http_headers_pack()`.
+ *
+ * @param table:  The table to fill.
+ * @param packed: The packed headers.
+ * @param count:  The number of headers.
+ * @param size:   The size of the packed headers in bytes.
+ * @param typed:  Receives the typed values of key headers.
+ */
+void http_headers_unpack(HttpHeaderTable* table, const uint8_t* packed, uint32_t count, uint32_t size, HttpTypedHeaders* typed) {
+
+    memset((void *)table, 0x00, sizeof(HttpHeaderTable));
+
+    uint32_t entries_size = count * sizeof(HttpHeader);
+    if (count <= HTTP_MAX_HEADERS && size >= entries_size && size - entries_size < sizeof(table->arena)) {
+        memcpy(table->entries, packed, entries_size);
+        memcpy(table->arena, packed + entries_size, size - entries_size);
+        table->arena_used = size - entries_size;
+        table->count = count;
+        for (uint32_t i = 0 ; i < count ; ++i) http_headers_index(table, i);
+    }
+
+    http_headers_parse_typed(table, typed);
+}
+
+
+/**
+ * @brief Convert an HTTP date to seconds since the Unix epoch.
+ *
+ * Only the IMF-fixdate form servers must send is accepted,
+ * eg. `Sun, 06 Nov 1994 08:49:37 GMT`.
+ *
+ * @param date:    The date.
+ * @param seconds: Receives the time.
+ *
+ * @returns `true` if the date was valid, otherwise `false`.
+ */
+bool http_parse_date(const char* date, uint32_t* seconds) {
+
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    if (date == NULL || strlen(date) != 29 || date[3] != ',' || strcmp(&date[25], " GMT") != 0) return false;
+
+    int32_t month = -1;
+    for (uint32_t i = 0 ; i < 12 ; ++i) {
+        if (strncmp(&date[8], &months[i * 3], 3) == 0) month = (int32_t)i;
+    }
+
+    int32_t day = http_parse_number(&date[5], 2);
+    int32_t year = http_parse_number(&date[12], 4);
+    int32_t hour = http_parse_number(&date[17], 2);
+    int32_t minute = http_parse_number(&date[20], 2);
+    int32_t second = http_parse_number(&date[23], 2);
+    if (month < 0 || day < 1 || day > 31 || year < 1970 || hour < 0 || hour > 23
+        || minute < 0 || minute > 59 || second < 0 || second > 60) return false;
+
+    // Days since the epoch, from the proleptic Gregorian calendar
+    // with the year starting in March, so leap days come last
+    int32_t y = year - (month < 2 ? 1 : 0);
+    int32_t era = y / 400;
+    int32_t year_of_era = y - era * 400;
+    int32_t day_of_year = (153 * (month < 2 ? month + 10 : month - 2) + 2) / 5 + day - 1;
+    int32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    int32_t days = era * 146097 + day_of_era - 719468;
+
+    *seconds = (uint32_t)days * 86400 + (uint32_t)(hour * 3600 + minute * 60 + second);
+    return true;
+}
+
+
+/**
+ * @brief Hash a header name, ignoring case (FNV-1a).
+ *
+ * @param name:   The name.
+ * @param length: The length of the name in bytes.
+ *
+ * @returns The hash.
+ */
+uint32_t http_header_hash(const char* name, uint32_t length) {
+
+    return digest_fnv1a(DIGEST_FNV1A_BASIS, name, length, true);
+}
+
+
+/**
+ * @brief Set up a request header builder on an arena.
+ *
+ * @param builder:     The builder.
+ * @param arena:       The arena. Must be aligned for `struct MvHttpHeader`.
+ * @param size:        The size of the arena in bytes.
+ * @param max_headers: The most headers a request may have. Room for their
+ *                     entries is taken from the start of the arena.
+ */
+void http_builder_init(HttpHeaderBuilder* builder, void* arena, uint32_t size, uint32_t max_headers) {
+
+    do_assert(max_headers * sizeof(struct MvHttpHeader) <= size, "Header arena too small for its entries");
+    builder->headers = (struct MvHttpHeader*)arena;
+    builder->max_headers = max_headers;
+    builder->arena = (uint8_t*)arena;
+    builder->arena_size = size;
+    http_builder_reset(builder);
+}
+
+
+/**
+ * @brief Free everything a builder holds, ready for the next request.
+ *
+ * @param builder: The builder.
+ */
+void http_builder_reset(HttpHeaderBuilder* builder) {
+
+    builder->num_headers = 0;
+    builder->arena_used = builder->max_headers * sizeof(struct MvHttpHeader);
+    builder->request_size = 0;
+}
+
+
+/**
+ * @brief Add a header whose text is held elsewhere.
+ *
+ * Only the entry is taken from the arena: the text is not copied, so it
+ * must remain valid until the request has been sent.
+ *
+ * @param builder: The builder.
+ * @param header:  The header, as `Name: value`.
+ *
+ * @returns `true` if the header was added, or `false` if there are too many.
+ */
+bool http_builder_add(HttpHeaderBuilder* builder, const struct MvHttpHeader* header) {
+
+    if (builder->num_headers == builder->max_headers) return false;
+    builder->headers[builder->num_headers++] = *header;
+    builder->request_size += header->length + HTTP_HEADER_OVERHEAD_B;
+    return true;
+}
+
+
+/**
+ * @brief Add a header, writing its text into the arena.
+ *
+ * The header takes exactly the space its text needs.
+ *
+ * @param builder:      The builder.
+ * @param name:         The header name, with its colon and space, eg. `"Accept: "`.
+ * @param name_length:  The length of the name in bytes.
+ * @param value:        The value.
+ * @param value_length: The length of the value in bytes.
+ *
+ * @returns `true` if the header was added, or `false` if the arena is full.
+ */
+bool http_builder_add_text(HttpHeaderBuilder* builder, const char* name, uint32_t name_length, const char* value, uint32_t value_length) {
+
+    uint32_t length = name_length + value_length;
+    if (builder->num_headers == builder->max_headers || length > builder->arena_size - builder->arena_used) return false;
+
+    uint8_t* text = &builder->arena[builder->arena_used];
+    memcpy(text, name, name_length);
+    memcpy(&text[name_length], value, value_length);
+    builder->arena_used += length;
+
+    const struct MvHttpHeader header = { text, length };
+    return http_builder_add(builder, &header);
+}
+
+
+/**
+ * @brief Add a header to the table's hash index.
+ *
+ * @param table: The table.
+ * @param entry: The header's index in the table.
+ */
+static void http_headers_index(HttpHeaderTable* table, uint32_t entry) {
+
+    uint32_t hash = table->entries[entry].hash;
+    for (uint32_t probe = 0 ; probe < HTTP_HEADER_SLOTS ; ++probe) {
+        uint8_t* slot = &table->slots[(hash + probe) & (HTTP_HEADER_SLOTS - 1)];
+        if (*slot == 0) {
+            *slot = (uint8_t)(entry + 1);
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief Parse the headers response handling depends on.
+ *
+ * @param table: The table.
+ * @param typed: Receives the values.
+ */
+static void http_headers_parse_typed(const HttpHeaderTable* table, HttpTypedHeaders* typed) {
+
+    typed->content_length = HTTP_NO_CONTENT_LENGTH;
+    typed->content_type = HTTP_CONTENT_NONE;
+    typed->content_encoding = HTTP_ENCODING_IDENTITY;
+    typed->etag = http_headers_find(table, "etag");
+    typed->last_modified = http_headers_find(table, "last-modified");
+    typed->content_digest = http_headers_find(table, "content-digest");
+    typed->cache_control = (HttpCacheControl){ HTTP_NO_MAX_AGE, false, false };
+
+    const char* value = http_headers_find(table, "content-length");
+    if (value != NULL && *value >= '0' && *value <= '9') {
+        typed->content_length = (uint32_t)strtoul(value, NULL, 10);
+    }
+
+    value = http_headers_find(table, "content-type");
+    if (value != NULL) {
+        // Compare the media type only, not any parameters
+        uint32_t length = strcspn(value, "; ");
+        if (http_token_equals(value, length, "application/json")) {
+            typed->content_type = HTTP_CONTENT_JSON;
+        } else if (http_token_equals(value, length, "application/cbor")) {
+            typed->content_type = HTTP_CONTENT_CBOR;
+        } else if (length > 5 && strncasecmp(value, "text/", 5) == 0) {
+            typed->content_type = HTTP_CONTENT_TEXT;
+        } else {
+            typed->content_type = HTTP_CONTENT_OTHER;
+        }
+    }
+
+    value = http_headers_find(table, "content-encoding");
+    if (value != NULL) {
+        uint32_t length = strcspn(value, ", ");
+        if (http_token_equals(value, length, "gzip") || http_token_equals(value, length, "x-gzip")) {
+            typed->content_encoding = HTTP_ENCODING_GZIP;
+        } else if (http_token_equals(value, length, "deflate")) {
+            typed->content_encoding = HTTP_ENCODING_DEFLATE;
+        } else if (!http_token_equals(value, length, "identity")) {
+            typed->content_encoding = HTTP_ENCODING_OTHER;
+        }
+
+        // Codings applied one after another can't be undone
+        if (value[length] == ',') typed->content_encoding = HTTP_ENCODING_OTHER;
+    }
+
+    value = http_headers_find(table, "cache-control");
+    while (value != NULL && *value != '\0') {
+        // Directives are comma-separated
+        while (*value == ' ' || *value == ',') value++;
+        uint32_t length = strcspn(value, ", ");
+        if (length > 8 && strncasecmp(value, "max-age=", 8) == 0) {
+            typed->cache_control.max_age = (int32_t)strtol(value + 8, NULL, 10);
+        } else if (http_token_equals(value, length, "no-cache")) {
+            typed->cache_control.no_cache = true;
+        } else if (http_token_equals(value, length, "no-store")) {
+            typed->cache_control.no_store = true;
+        }
+
+        value += length;
+    }
+}
+
+
+/**
+ * @brief Compare a token with a string, ignoring case.
+ *
+ * @param text:   The token.
+ * @param length: The length of the token in bytes.
+ * @param token:  The string.
+ *
+ * @returns `true` if they match, otherwise `false`.
+ */
+static bool http_token_equals(const char* text, uint32_t length, const char* token) {
+
+    return strlen(token) == length && strncasecmp(text, token, length) == 0;
+}
+
+
+/**
+ * @brief Read a fixed-width decimal number.
+ *
+ * @param text:   The digits.
+ * @param digits: The number of digits.
+ *
+ * @returns The number, or -1 if a character isn't a digit.
+ */
+static int32_t http_parse_number(const char* text, uint32_t digits) {
+
+    int32_t value = 0;
+    for (uint32_t i = 0 ; i < digits ; ++i) {
+        if (text[i] < '0' || text[i] > '9') return -1;
+        value = value * 10 + (text[i] - '0');
+    }
+
+    return value;
+}
@@ -0,0 +1,127 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _HTTP_HEADERS_H_
+#define _HTTP_HEADERS_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     HTTP_MAX_HEADERS            16
+#define     HTTP_HEADER_ARENA_SIZE_B    768
+
+// Hash index slots. Must be a power of two, comfortably above HTTP_MAX_HEADERS
+#define     HTTP_HEADER_SLOTS           32
+
+// `content_length` when the response has no Content-Length header
+#define     HTTP_NO_CONTENT_LENGTH      0xFFFFFFFF
+
+// `max_age` when Cache-Control has no max-age directive
+#define     HTTP_NO_MAX_AGE             -1
+
+// The bytes each request header adds to the request beyond its text: its CRLF
+#define     HTTP_HEADER_OVERHEAD_B      2
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+typedef enum {
+    HTTP_CONTENT_NONE = 0,
+    HTTP_CONTENT_JSON,
+    HTTP_CONTENT_CBOR,
+    HTTP_CONTENT_TEXT,
+    HTTP_CONTENT_OTHER
+} HttpContentType;
+
+// Content codings the engine can undo. See `http_stream_body()`
+typedef enum {
+    HTTP_ENCODING_IDENTITY = 0,
+    HTTP_ENCODING_GZIP,
+    HTTP_ENCODING_DEFLATE,
+    HTTP_ENCODING_OTHER
+} HttpContentEncoding;
+
+typedef struct {
+    int32_t     max_age;
+    bool        no_cache;
+    bool        no_store;
+} HttpCacheControl;
+
+// A cached header. Its name and value are NUL-terminated strings in the
+// table's arena; the hash is of the lower-cased name
+typedef struct {
+    uint32_t    hash;
+    uint16_t    name_offset;
+    uint16_t    value_offset;
+} HttpHeader;
+
+// All of a response's headers, read once, with a hash index by name
+typedef struct {
+    uint32_t    count;
+    uint32_t    arena_used;
+    bool        truncated;
+    HttpHeader  entries[HTTP_MAX_HEADERS];
+    uint8_t     slots[HTTP_HEADER_SLOTS];
+    char        arena[HTTP_HEADER_ARENA_SIZE_B];
+} HttpHeaderTable;
+
+// The headers response handling needs, parsed up front
+typedef struct {
+    uint32_t            content_length;
+    HttpContentType     content_type;
+    HttpContentEncoding content_encoding;
+    const char*         etag;
+    const char*         last_modified;
+    const char*         content_digest;
+    HttpCacheControl    cache_control;
+} HttpTypedHeaders;
+
+// Builds a request's headers in a bump arena: room for the header entries
+// at its start, then the text of any headers written into it. Nothing is
+// freed on its own; the whole arena is reset once the request is done with.
+// `request_size` is the headers' size in the request as sent
+typedef struct {
+    struct MvHttpHeader*    headers;
+    uint32_t                num_headers;
+    uint32_t                max_headers;
+    uint8_t*                arena;
+    uint32_t                arena_size;
+    uint32_t                arena_used;
+    uint32_t                request_size;
+} HttpHeaderBuilder;
+
+
+/*
+ * PROTOTYPES
+ */
+void        http_headers_load(HttpHeaderTable* table, MvChannelHandle handle, uint32_t num_headers, HttpTypedHeaders* typed);
+const char* http_headers_find(const HttpHeaderTable* table, const char* name);
+bool        http_headers_get(const HttpHeaderTable* table, uint32_t index, const char** name, const char** value);
+uint32_t    http_headers_pack(const HttpHeaderTable* table, uint8_t* buffer, uint32_t size);
+void        http_headers_unpack(HttpHeaderTable* table, const uint8_t* packed, uint32_t count, uint32_t size, HttpTypedHeaders* typed);
+bool        http_parse_date(const char* date, uint32_t* seconds);
+uint32_t    http_header_hash(const char* name, uint32_t length);
+void        http_builder_init(HttpHeaderBuilder* builder, void* arena, uint32_t size, uint32_t max_headers);
+void        http_builder_reset(HttpHeaderBuilder* builder);
+bool        http_builder_add(HttpHeaderBuilder* builder, const struct MvHttpHeader* header);
+bool        http_builder_add_text(HttpHeaderBuilder* builder, const char* name, uint32_t name_length, const char* value, uint32_t value_length);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _HTTP_HEADERS_H_
@@ -0,0 +1,95 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <string.h>
+#include "http_template.h"
+
+
+/*
+ * NOTE This module has no RTOS dependencies, so it can be built for the
+ *      host too -- see `sim/bench/template_bench.c`.
+ */
+
+
+/*
+ * GLOBALS
+ */
+// "00" to "99", so numbers convert two digits per division
+static const char http_digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+
+/**
+ * @brief Write a request's URL from its template.
+ *
+ * The fixed parts are copied, not formatted, so the only
+ * work per request is converting the field.
+ *
+ * @param tmpl:     The request template.
+ * @param field:    The value of the URL's variable field.
+ * @param url:      Receives the URL, NUL-terminated.
+ * @param size:     The size of the buffer in bytes.
+ *
+ * @returns The length of the URL, or 0 if it doesn't fit.
+ */
+uint32_t http_template_url(const HttpTemplate* tmpl, uint32_t field, char* url, uint32_t size) {
+
+    // Check against the longest possible field, so the check is a constant
+    if (tmpl->prefix_length + HTTP_MAX_DECIMAL_LEN + tmpl->suffix_length >= size) return 0;
+
+    memcpy(url, tmpl->prefix, tmpl->prefix_length);
+    uint32_t length = tmpl->prefix_length;
+    length += http_u32_to_dec(field, &url[length]);
+    memcpy(&url[length], tmpl->suffix, tmpl->suffix_length);
+    length += tmpl->suffix_length;
+    url[length] = '\0';
+    return length;
+}
+
+
+/**
+ * @brief Write a number in decimal.
+ *
+ * @param value:  The number.
+ * @param buffer: Receives the digits, not NUL-terminated. Must have
+ *                room for HTTP_MAX_DECIMAL_LEN characters.
+ *
+ * @returns The number of digits.
+ */
+uint32_t http_u32_to_dec(uint32_t value, char* buffer) {
+
+    uint32_t length = 1;
+    for (uint32_t bound = 10 ; length < HTTP_MAX_DECIMAL_LEN && value >= bound ; bound *= 10) length++;
+
+    // Fill from the right, two digits at a time
+    char* digit = buffer + length;
+    while (value >= 100) {
+        const char* pair = &http_digit_pairs[(value % 100) * 2];
+        value /= 100;
+        *--digit = pair[1];
+        *--digit = pair[0];
+    }
+
+    if (value >= 10) {
+        *--digit = http_digit_pairs[value * 2 + 1];
+        *--digit = http_digit_pairs[value * 2];
+    } else {
+        *--digit = (char)('0' + value);
+    }
+
+    return length;
+}
@@ -0,0 +1,82 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _HTTP_TEMPLATE_H_
+#define _HTTP_TEMPLATE_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "mv_syscalls.h"
+
+
+/*
+ * CONSTANTS
+ */
+// Most digits in a decimal `uint32_t`
+#define     HTTP_MAX_DECIMAL_LEN        10
+
+/*
+ * Lays out the fixed parts of a request, with their lengths taken at
+ * compile time. Each must be a string literal. The URL is `prefix`, then
+ * the request's variable field in decimal, then `suffix`. Add headers
+ * and a body with designated initializers. For example:
+ *
+ *   static const struct MvHttpHeader thing_headers[] = { HTTP_HEADER("Accept: application/json") };
+ *   static const HttpTemplate thing_template = {
+ *       HTTP_TEMPLATE("GET", "https://example.com/things/", "?full=1"),
+ *       .headers = thing_headers,
+ *       .num_headers = 1
+ *   };
+ */
+#define     HTTP_TEMPLATE(method_text, prefix_text, suffix_text) \
+                .method = (method_text), .method_length = sizeof(method_text) - 1, \
+                .prefix = (prefix_text), .prefix_length = sizeof(prefix_text) - 1, \
+                .suffix = (suffix_text), .suffix_length = sizeof(suffix_text) - 1
+
+#define     HTTP_HEADER(text)           { (const uint8_t*)(text), sizeof(text) - 1 }
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+typedef struct {
+    const char*                 method;
+    uint32_t                    method_length;
+    const char*                 prefix;
+    uint32_t                    prefix_length;
+    const char*                 suffix;
+    uint32_t                    suffix_length;
+    const struct MvHttpHeader*  headers;
+    uint32_t                    num_headers;
+    const uint8_t*              body;
+    uint32_t                    body_length;
+} HttpTemplate;
+
+
+/*
+ * PROTOTYPES
+ */
+uint32_t    http_template_url(const HttpTemplate* tmpl, uint32_t field, char* url, uint32_t size);
+uint32_t    http_u32_to_dec(uint32_t value, char* buffer);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _HTTP_TEMPLATE_H_
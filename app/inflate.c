@@ -0,0 +1,931 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <string.h>
+#include "inflate.h"
+#include "digest.h"
+
+
+/*
+ * NOTE This module has no Microvisor or RTOS dependencies, so it can be
+ *      built for the host too -- see `sim/bench/inflate_bench.c`.
+ *
+ *      Deflate (RFC 1951) is decoded by a state machine that stops
+ *      wherever the input runs out, keeping any part-read bits, and picks
+ *      up there on the next feed. Huffman codes are held in canonical
+ *      form, as counts per length and symbols in code order, and decoded
+ *      a bit at a time, which needs far less RAM than lookup tables.
+ *      The output is written to the window, which doubles as the output
+ *      buffer: it is passed to the sink whenever the window wraps.
+ */
+
+
+/*
+ * CONSTANTS
+ */
+enum {
+    INFLATE_STATE_GZIP_HEADER = 0,
+    INFLATE_STATE_GZIP_EXTRA_LENGTH,
+    INFLATE_STATE_GZIP_EXTRA,
+    INFLATE_STATE_GZIP_NAME,
+    INFLATE_STATE_GZIP_COMMENT,
+    INFLATE_STATE_GZIP_HEADER_CRC,
+    INFLATE_STATE_ZLIB_HEADER,
+    INFLATE_STATE_BLOCK_HEADER,
+    INFLATE_STATE_STORED_LENGTH,
+    INFLATE_STATE_STORED_CHECK,
+    INFLATE_STATE_STORED_COPY,
+    INFLATE_STATE_TABLE_COUNTS,
+    INFLATE_STATE_CODE_LENGTH_CODE,
+    INFLATE_STATE_CODE_LENGTHS,
+    INFLATE_STATE_CODE_LENGTH_REPEAT,
+    INFLATE_STATE_LITERAL_LENGTH,
+    INFLATE_STATE_LENGTH_EXTRA,
+    INFLATE_STATE_DISTANCE,
+    INFLATE_STATE_DISTANCE_EXTRA,
+    INFLATE_STATE_TRAILER,
+    INFLATE_STATE_DONE,
+    INFLATE_STATE_ERROR
+};
+
+// gzip member header (RFC 1952)
+#define     INFLATE_GZIP_HEADER_B       10
+#define     INFLATE_GZIP_FHCRC          0x02
+#define     INFLATE_GZIP_FEXTRA         0x04
+#define     INFLATE_GZIP_FNAME          0x08
+#define     INFLATE_GZIP_FCOMMENT       0x10
+#define     INFLATE_GZIP_RESERVED       0xE0
+
+// zlib stream header (RFC 1950)
+#define     INFLATE_ZLIB_FDICT          0x20
+
+#define     INFLATE_BLOCK_STORED        0
+#define     INFLATE_BLOCK_FIXED         1
+#define     INFLATE_BLOCK_DYNAMIC       2
+
+#define     INFLATE_END_OF_BLOCK        256
+#define     INFLATE_LENGTH_SYMBOLS      29
+#define     INFLATE_MAX_LITERAL_CODES   286
+#define     INFLATE_MAX_DISTANCE_CODES  30
+#define     INFLATE_CODE_LENGTH_CODES   19
+
+// `inflate_decode()` results other than symbols
+#define     INFLATE_NEED_INPUT          -1
+#define     INFLATE_BAD_CODE            -2
+
+#define     INFLATE_ADLER_BASE          65521
+#define     INFLATE_ADLER_RUN           5552
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static bool     inflate_step(Inflater* inflater);
+static bool     inflate_next_header(Inflater* inflater);
+static bool     inflate_zlib_header(Inflater* inflater);
+static bool     inflate_stored(Inflater* inflater);
+static bool     inflate_code_lengths(Inflater* inflater);
+static bool     inflate_build_dynamic(Inflater* inflater);
+static bool     inflate_codes(Inflater* inflater);
+static bool     inflate_copy(Inflater* inflater, uint32_t distance);
+static bool     inflate_trailer(Inflater* inflater);
+static void     inflate_end_block(Inflater* inflater);
+static void     inflate_fixed_codes(Inflater* inflater);
+static int32_t  inflate_build(uint16_t* counts, uint16_t* symbols, const uint8_t* lengths, uint32_t count);
+static int32_t  inflate_decode(Inflater* inflater, const uint16_t* counts, const uint16_t* symbols);
+static void     inflate_fill(Inflater* inflater);
+static bool     inflate_need(Inflater* inflater, uint32_t count);
+static uint32_t inflate_take(Inflater* inflater, uint32_t count);
+static bool     inflate_byte(Inflater* inflater, uint8_t* byte);
+static bool     inflate_put(Inflater* inflater, uint8_t byte);
+static bool     inflate_flush(Inflater* inflater);
+static bool     inflate_fail(Inflater* inflater, InflateError error);
+static uint32_t inflate_adler32(uint32_t adler, const uint8_t* data, uint32_t length);
+
+
+/*
+ * GLOBALS
+ */
+static const uint16_t length_base[INFLATE_LENGTH_SYMBOLS] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const uint8_t length_extra[INFLATE_LENGTH_SYMBOLS] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const uint16_t distance_base[INFLATE_MAX_DISTANCE_CODES] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const uint8_t distance_extra[INFLATE_MAX_DISTANCE_CODES] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// The order in which a dynamic block sends the code length code's lengths
+static const uint8_t code_length_order[INFLATE_CODE_LENGTH_CODES] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+
+/**
+ * @brief Prepare an inflater for a new stream.
+ *
+ * @param inflater: The inflater.
+ * @param format:   The stream's wrapper.
+ * @param sink:     Called with each run of inflated data.
+ * @param context:  Passed to the sink.
+ */
+void inflate_init(Inflater* inflater, InflateFormat format, InflateSink sink, void* context) {
+
+    inflater->sink = sink;
+    inflater->context = context;
+    inflater->format = format;
+    inflater->state = format == INFLATE_FORMAT_GZIP ? INFLATE_STATE_GZIP_HEADER
+                    : format == INFLATE_FORMAT_ZLIB ? INFLATE_STATE_ZLIB_HEADER : INFLATE_STATE_BLOCK_HEADER;
+    inflater->error = INFLATE_ERROR_NONE;
+    inflater->header_flags = 0;
+    inflater->final_block = false;
+    inflater->fixed_codes = false;
+    inflater->window_full = false;
+    inflater->stopped = false;
+    inflater->bits = 0;
+    inflater->bit_count = 0;
+    inflater->index = 0;
+    inflater->position = 0;
+    inflater->flushed = 0;
+    inflater->check = format == INFLATE_FORMAT_ZLIB ? 1 : 0;
+    inflater->total_in = 0;
+    inflater->total_out = 0;
+}
+
+
+/**
+ * @brief Inflate the next part of a stream.
+ *
+ * @param inflater: The inflater.
+ * @param data:     The compressed data.
+ * @param length:   The size of the data in bytes.
+ *
+ * @returns `true` if more of the stream can be fed, or `false` if it is
+ *          corrupt or the sink stopped it.
+ */
+bool inflate_feed(Inflater* inflater, const uint8_t* data, uint32_t length) {
+
+    if (inflater->state == INFLATE_STATE_ERROR || inflater->stopped) return false;
+
+    inflater->input = data;
+    inflater->input_end = data + length;
+    inflater->total_in += length;
+
+    // Each step runs until it completes its part of the stream, needs
+    // more input, or fails
+    while (inflater->state != INFLATE_STATE_DONE) {
+        uint8_t state = inflater->state;
+        if (!inflate_step(inflater)) return false;
+        if (inflater->state == state) break;
+    }
+
+    // Pass on whatever has been inflated so far
+    return inflate_flush(inflater);
+}
+
+
+/**
+ * @brief Check whether the whole stream has been inflated and verified.
+ *
+ * @param inflater: The inflater.
+ *
+ * @returns `true` if the stream is complete, otherwise `false`.
+ */
+bool inflate_finish(const Inflater* inflater) {
+
+    return inflater->state == INFLATE_STATE_DONE && !inflater->stopped;
+}
+
+
+/**
+ * @brief Run the inflater's current state as far as the input allows.
+ *
+ * @param inflater: The inflater.
+ *
+ * @returns `false` if the stream is corrupt or the sink stopped it, otherwise `true`.
+ */
+static bool inflate_step(Inflater* inflater) {
+
+    uint8_t byte;
+    switch (inflater->state) {
+        case INFLATE_STATE_GZIP_HEADER:
+            while (inflater->index < INFLATE_GZIP_HEADER_B) {
+                if (!inflate_byte(inflater, &byte)) return true;
+
+                // ID1, ID2, CM (deflate) and FLG matter; MTIME, XFL and OS don't
+                switch (inflater->index++) {
+                    case 0:
+                        if (byte != 0x1F) return inflate_fail(inflater, INFLATE_ERROR_HEADER);
+                        break;
+                    case 1:
+                        if (byte != 0x8B) return inflate_fail(inflater, INFLATE_ERROR_HEADER);
+                        break;
+                    case 2:
+                        if (byte != 8) return inflate_fail(inflater, INFLATE_ERROR_HEADER);
+                        break;
+                    case 3:
+                        if ((byte & INFLATE_GZIP_RESERVED) != 0) return inflate_fail(inflater, INFLATE_ERROR_HEADER);
+                        inflater->header_flags = byte;
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            return inflate_next_header(inflater);
+
+        case INFLATE_STATE_GZIP_EXTRA_LENGTH:
+            while (inflater->index < 2) {
+                if (!inflate_byte(inflater, &byte)) return true;
+                inflater->length |= (uint16_t)byte << (8 * inflater->index++);
+            }
+
+            inflater->state = INFLATE_STATE_GZIP_EXTRA;
+            return true;
+
+        case INFLATE_STATE_GZIP_EXTRA:
+            while (inflater->length > 0) {
+                if (!inflate_byte(inflater, &byte)) return true;
+                inflater->length--;
+            }
+
+            return inflate_next_header(inflater);
+
+        case INFLATE_STATE_GZIP_NAME:
+        case INFLATE_STATE_GZIP_COMMENT:
+            // Both are NUL-terminated
+            do {
+                if (!inflate_byte(inflater, &byte)) return true;
+            } while (byte != 0);
+
+            return inflate_next_header(inflater);
+
+        case INFLATE_STATE_GZIP_HEADER_CRC:
+            while (inflater->index < 2) {
+                if (!inflate_byte(inflater, &byte)) return true;
+                inflater->index++;
+            }
+
+            return inflate_next_header(inflater);
+
+        case INFLATE_STATE_ZLIB_HEADER:
+            return inflate_zlib_header(inflater);
+
+        case INFLATE_STATE_BLOCK_HEADER:
+            if (!inflate_need(inflater, 3)) return true;
+            inflater->final_block = inflate_take(inflater, 1) == 1;
+            switch (inflate_take(inflater, 2)) {
+                case INFLATE_BLOCK_STORED:
+                    // Stored data starts on a byte boundary
+                    inflate_take(inflater, inflater->bit_count & 7);
+                    inflater->state = INFLATE_STATE_STORED_LENGTH;
+                    return true;
+                case INFLATE_BLOCK_FIXED:
+                    if (!inflater->fixed_codes) inflate_fixed_codes(inflater);
+                    inflater->state = INFLATE_STATE_LITERAL_LENGTH;
+                    return true;
+                case INFLATE_BLOCK_DYNAMIC:
+                    inflater->state = INFLATE_STATE_TABLE_COUNTS;
+                    return true;
+                default:
+                    return inflate_fail(inflater, INFLATE_ERROR_DATA);
+            }
+
+        case INFLATE_STATE_STORED_LENGTH:
+            if (!inflate_need(inflater, 16)) return true;
+            inflater->length = (uint16_t)inflate_take(inflater, 16);
+            inflater->state = INFLATE_STATE_STORED_CHECK;
+            return true;
+
+        case INFLATE_STATE_STORED_CHECK:
+            if (!inflate_need(inflater, 16)) return true;
+            if ((uint16_t)~inflate_take(inflater, 16) != inflater->length) return inflate_fail(inflater, INFLATE_ERROR_DATA);
+            inflater->state = INFLATE_STATE_STORED_COPY;
+            return true;
+
+        case INFLATE_STATE_STORED_COPY:
+            return inflate_stored(inflater);
+
+        case INFLATE_STATE_TABLE_COUNTS:
+            if (!inflate_need(inflater, 14)) return true;
+            inflater->literal_codes = (uint16_t)(inflate_take(inflater, 5) + 257);
+            inflater->distance_codes = (uint16_t)(inflate_take(inflater, 5) + 1);
+            inflater->length_codes = (uint16_t)(inflate_take(inflater, 4) + 4);
+            if (inflater->literal_codes > INFLATE_MAX_LITERAL_CODES || inflater->distance_codes > INFLATE_MAX_DISTANCE_CODES) {
+                return inflate_fail(inflater, INFLATE_ERROR_DATA);
+            }
+
+            inflater->index = 0;
+            inflater->state = INFLATE_STATE_CODE_LENGTH_CODE;
+            return true;
+
+        case INFLATE_STATE_CODE_LENGTH_CODE:
+            while (inflater->index < inflater->length_codes) {
+                if (!inflate_need(inflater, 3)) return true;
+                inflater->lengths[code_length_order[inflater->index++]] = (uint8_t)inflate_take(inflater, 3);
+            }
+
+            while (inflater->index < INFLATE_CODE_LENGTH_CODES) inflater->lengths[code_length_order[inflater->index++]] = 0;
+
+            // The code length code is held in the distance code's space
+            // until the code lengths it encodes have been read
+            inflater->fixed_codes = false;
+            if (inflate_build(inflater->distance.counts, inflater->distance.symbols, inflater->lengths, INFLATE_CODE_LENGTH_CODES) != 0) {
+                return inflate_fail(inflater, INFLATE_ERROR_DATA);
+            }
+
+            inflater->index = 0;
+            inflater->state = INFLATE_STATE_CODE_LENGTHS;
+            return true;
+
+        case INFLATE_STATE_CODE_LENGTHS:
+        case INFLATE_STATE_CODE_LENGTH_REPEAT:
+            return inflate_code_lengths(inflater);
+
+        case INFLATE_STATE_LITERAL_LENGTH:
+            return inflate_codes(inflater);
+
+        case INFLATE_STATE_LENGTH_EXTRA:
+            if (!inflate_need(inflater, length_extra[inflater->symbol])) return true;
+            inflater->length = (uint16_t)(length_base[inflater->symbol] + inflate_take(inflater, length_extra[inflater->symbol]));
+            inflater->state = INFLATE_STATE_DISTANCE;
+            return true;
+
+        case INFLATE_STATE_DISTANCE: {
+            inflate_fill(inflater);
+            int32_t symbol = inflate_decode(inflater, inflater->distance.counts, inflater->distance.symbols);
+            if (symbol == INFLATE_NEED_INPUT) return true;
+            if (symbol < 0 || symbol >= INFLATE_MAX_DISTANCE_CODES) return inflate_fail(inflater, INFLATE_ERROR_DATA);
+            inflater->symbol = (uint16_t)symbol;
+            inflater->state = INFLATE_STATE_DISTANCE_EXTRA;
+            return true;
+        }
+
+        case INFLATE_STATE_DISTANCE_EXTRA:
+            if (!inflate_need(inflater, distance_extra[inflater->symbol])) return true;
+            inflater->state = INFLATE_STATE_LITERAL_LENGTH;
+            return inflate_copy(inflater, distance_base[inflater->symbol] + inflate_take(inflater, distance_extra[inflater->symbol]));
+
+        case INFLATE_STATE_TRAILER:
+            return inflate_trailer(inflater);
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * @brief Move on to the next optional part of a gzip header, or to the
+ *        first block once there are none left.
+ *
+ * @param inflater: The inflater.
+ *
+ * @returns `true`.
+ */
+static bool inflate_next_header(Inflater* inflater) {
+
+    static const struct {
+        uint8_t flag;
+        uint8_t state;
+    } parts[] = {
+        { INFLATE_GZIP_FEXTRA,   INFLATE_STATE_GZIP_EXTRA_LENGTH },
+        { INFLATE_GZIP_FNAME,    INFLATE_STATE_GZIP_NAME },
+        { INFLATE_GZIP_FCOMMENT, INFLATE_STATE_GZIP_COMMENT },
+        { INFLATE_GZIP_FHCRC,    INFLATE_STATE_GZIP_HEADER_CRC }
+    };
+
+    inflater->index = 0;
+    inflater->length = 0;
+    for (uint32_t i = 0 ; i < sizeof(parts) / sizeof(parts[0]) ; ++i) {
+        if ((inflater->header_flags & parts[i].flag) != 0) {
+            inflater->header_flags &= ~parts[i].flag;
+            inflater->state = parts[i].state;
+            return true;
+        }
+    }
+
+    inflater->state = INFLATE_STATE_BLOCK_HEADER;
+    return true;
+}
+
+
+/**
+ * @brief Read a zlib header, or fall back to raw deflate if there isn't one.
+ *
+ * @param inflater: The inflater.
+ *
+ * @returns `false` if the header can't be used, otherwise `true`.
+ */
+static bool inflate_zlib_header(Inflater* inflater) {
+
+    if (!inflate_need(inflater, 16)) return true;
+
+    // Look at the header before taking it, so it can be left in place
+    uint32_t cmf = inflater->bits & 0xFF;
+    uint32_t flags = (inflater->bits >> 8) & 0xFF;
+    if ((cmf & 0x0F) != 8 || ((cmf << 8) | flags) % 31 != 0) {
+        inflater->format = INFLATE_FORMAT_RAW;
+        inflater->state = INFLATE_STATE_BLOCK_HEADER;
+        return true;
+    }
+
+    if ((flags & INFLATE_ZLIB_FDICT) != 0) return inflate_fail(inflater, INFLATE_ERROR_HEADER);
+    if ((cmf >> 4) + 8 > INFLATE_WINDOW_BITS) return inflate_fail(inflater, INFLATE_ERROR_WINDOW);
+
+    inflate_take(inflater, 16);
+    inflater->state = INFLATE_STATE_BLOCK_HEADER;
+    return true;
+}
+
+
+/**
+ * @brief Copy a stored block's data to the output: first any bytes
+ *        already in the bit buffer, then straight from the input.
+ *
+ * @param inflater: The inflater.
+ *
+ * @returns `false` if the sink stopped the stream, otherwise `true`.
+ */
+static bool inflate_stored(Inflater* inflater) {
+
+    while (inflater->length > 0 && inflater->bit_count >= 8) {
+        if (!inflate_put(inflater, (uint8_t)inflate_take(inflater, 8))) return false;
+        inflater->length--;
+    }
+
+    while (inflater->length > 0 && inflater->input < inflater->input_end) {
+        uint32_t run = inflater->length;
+        uint32_t available = (uint32_t)(inflater->input_end - inflater->input);
+        if (run > available) run = available;
+        if (run > INFLATE_WINDOW_SIZE_B - inflater->position) run = INFLATE_WINDOW_SIZE_B - inflater->position;
+
+        memcpy(&inflater->window[inflater->position], inflater->input, run);
+        inflater->input += run;
+        inflater->length -= (uint16_t)run;
+        inflater->position += run;
+        if (inflater->position == INFLATE_WINDOW_SIZE_B && !inflate_flush(inflater)) return false;
+    }
+
+    if (inflater->length == 0) inflate_end_block(inflater);
+    return true;
+}
+
+
+/**
+ * @brief Read a dynamic block's literal/length and distance code lengths,
+ *        then build the codes.
+ *
+ * @param inflater: The inflater.
+ *
+ * @returns `false` if the lengths are invalid, otherwise `true`.
+ */
+static bool inflate_code_lengths(Inflater* inflater) {
+
+    uint32_t total = inflater->literal_codes + inflater->distance_codes;
+    while (inflater->index < total) {
+        if (inflater->state == INFLATE_STATE_CODE_LENGTHS) {
+            inflate_fill(inflater);
+            int32_t symbol = inflate_decode(inflater, inflater->distance.counts, inflater->distance.symbols);
+            if (symbol == INFLATE_NEED_INPUT) return true;
+            if (symbol < 0) return inflate_fail(inflater, INFLATE_ERROR_DATA);
+            if (symbol < 16) {
+                inflater->lengths[inflater->index++] = (uint8_t)symbol;
+                continue;
+            }
+
+            inflater->symbol = (uint16_t)symbol;
+            inflater->state = INFLATE_STATE_CODE_LENGTH_REPEAT;
+        }
+
+        // 16 repeats the last length 3-6 times; 17 and 18 repeat zero 3-10 and 11-138 times
+        uint32_t extra = inflater->symbol == 16 ? 2 : (inflater->symbol == 17 ? 3 : 7);
+        if (!inflate_need(inflater, extra)) return true;
+
+        uint32_t repeat = inflate_take(inflater, extra) + (inflater->symbol == 18 ? 11 : 3);
+        uint8_t length = 0;
+        if (inflater->symbol == 16) {
+            if (inflater->index == 0) return inflate_fail(inflater, INFLATE_ERROR_DATA);
+            length = inflater->lengths[inflater->index - 1];
+        }
+
+        if (inflater->index + repeat > total) return inflate_fail(inflater, INFLATE_ERROR_DATA);
+        memset(&inflater->lengths[inflater->index], length, repeat);
+        inflater->index += (uint16_t)repeat;
+        inflater->state = INFLATE_STATE_CODE_LENGTHS;
+    }
+
+    return inflate_build_dynamic(inflater);
+}
+
+
+/**
+ * @brief Build a dynamic block's codes from their lengths.
+ *
+ * @param inflater: The inflater.
+ *
+ * @returns `false` if the codes are invalid, otherwise `true`.
+ */
+static bool inflate_build_dynamic(Inflater* inflater) {
+
+    // The block must be able to end
+    if (inflater->lengths[INFLATE_END_OF_BLOCK] == 0) return inflate_fail(inflater, INFLATE_ERROR_DATA);
+
+    // Incomplete codes are only allowed if they have a single symbol
+    int32_t left = inflate_build(inflater->litlen.counts, inflater->litlen.symbols, inflater->lengths, inflater->literal_codes);
+    if (left < 0 || (left > 0 && inflater->literal_codes - inflater->litlen.counts[0] != 1)) {
+        return inflate_fail(inflater, INFLATE_ERROR_DATA);
+    }
+
+    left = inflate_build(inflater->distance.counts, inflater->distance.symbols, &inflater->lengths[inflater->literal_codes], inflater->distance_codes);
+    if (left < 0 || (left > 0 && inflater->distance_codes - inflater->distance.counts[0] != 1)) {
+        return inflate_fail(inflater, INFLATE_ERROR_DATA);
+    }
+
+    inflater->state = INFLATE_STATE_LITERAL_LENGTH;
+    return true;
+}
+
+
+/**
+ * @brief Decode a block's literals until a match, the end of the block,
+ *        or the end of the input.
+ *
+ * @param inflater: The inflater.
+ *
+ * @returns `false` if the data is invalid or the sink stopped the stream, otherwise `true`.
+ */
+static bool inflate_codes(Inflater* inflater) {
+
+    while (1) {
+        inflate_fill(inflater);
+        int32_t symbol = inflate_decode(inflater, inflater->litlen.counts, inflater->litlen.symbols);
+        if (symbol == INFLATE_NEED_INPUT) return true;
+        if (symbol < 0) return inflate_fail(inflater, INFLATE_ERROR_DATA);
+
+        if (symbol < INFLATE_END_OF_BLOCK) {
+            if (!inflate_put(inflater, (uint8_t)symbol)) return false;
+            continue;
+        }
+
+        if (symbol == INFLATE_END_OF_BLOCK) {
+            inflate_end_block(inflater);
+            return true;
+        }
+
+        // A match: its length's extra bits and its distance come next
+        symbol -= INFLATE_END_OF_BLOCK + 1;
+        if (symbol >= INFLATE_LENGTH_SYMBOLS) return inflate_fail(inflater, INFLATE_ERROR_DATA);
+        inflater->symbol = (uint16_t)symbol;
+        inflater->state = INFLATE_STATE_LENGTH_EXTRA;
+        return true;
+    }
+}
+
+
+/**
+ * @brief Output a match: a copy of earlier output, `inflater->length`
+ *        bytes long, from `distance` bytes back.
+ *
+ * @param inflater: The inflater.
+ * @param distance: How far back the copy starts.
+ *
+ * @returns `false` if the match reaches outside the window or the sink
+ *          stopped the stream, otherwise `true`.
+ */
+static bool inflate_copy(Inflater* inflater, uint32_t distance) {
+
+    if (distance > (inflater->window_full ? INFLATE_WINDOW_SIZE_B : inflater->position)) {
+        return inflate_fail(inflater, INFLATE_ERROR_WINDOW);
+    }
+
+    // Copy byte by byte: the source may overlap the bytes being written
+    uint32_t from = (inflater->position - distance) & (INFLATE_WINDOW_SIZE_B - 1);
+    for (uint32_t i = 0 ; i < inflater->length ; ++i) {
+        if (!inflate_put(inflater, inflater->window[from])) return false;
+        from = (from + 1) & (INFLATE_WINDOW_SIZE_B - 1);
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Check the stream's trailer against the output: a gzip member's
+ *        CRC-32 and length, or a zlib stream's Adler-32.
+ *
+ * @param inflater: The inflater.
+ *
+ * @returns `false` if the trailer doesn't match, otherwise `true`.
+ */
+static bool inflate_trailer(Inflater* inflater) {
+
+    uint32_t size = inflater->format == INFLATE_FORMAT_GZIP ? 8 : 4;
+    uint8_t byte;
+    while (inflater->index < size) {
+        if (!inflate_byte(inflater, &byte)) return true;
+
+        // gzip's fields are little-endian, zlib's big-endian
+        uint32_t expected;
+        if (inflater->format == INFLATE_FORMAT_GZIP) {
+            uint32_t field = inflater->index < 4 ? inflater->check : inflater->total_out;
+            expected = (field >> (8 * (inflater->index & 3))) & 0xFF;
+        } else {
+            expected = (inflater->check >> (24 - 8 * inflater->index)) & 0xFF;
+        }
+
+        if (byte != expected) return inflate_fail(inflater, INFLATE_ERROR_CHECK);
+        inflater->index++;
+    }
+
+    inflater->state = INFLATE_STATE_DONE;
+    return true;
+}
+
+
+/**
+ * @brief Move on from a block to the next, or to the trailer after the last.
+ *
+ * @param inflater: The inflater.
+ */
+static void inflate_end_block(Inflater* inflater) {
+
+    if (!inflater->final_block) {
+        inflater->state = INFLATE_STATE_BLOCK_HEADER;
+        return;
+    }
+
+    // The trailer starts on a byte boundary, and is checked against
+    // everything output, so pass that on first
+    inflate_take(inflater, inflater->bit_count & 7);
+    inflate_flush(inflater);
+    inflater->index = 0;
+    inflater->state = inflater->format == INFLATE_FORMAT_RAW ? INFLATE_STATE_DONE : INFLATE_STATE_TRAILER;
+}
+
+
+/**
+ * @brief Build the fixed literal/length and distance codes.
+ *
+ * @param inflater: The inflater.
+ */
+static void inflate_fixed_codes(Inflater* inflater) {
+
+    uint8_t* lengths = inflater->lengths;
+    memset(lengths, 8, 144);
+    memset(&lengths[144], 9, 256 - 144);
+    memset(&lengths[256], 7, 280 - 256);
+    memset(&lengths[280], 8, INFLATE_LITLEN_CODES - 280);
+    inflate_build(inflater->litlen.counts, inflater->litlen.symbols, lengths, INFLATE_LITLEN_CODES);
+
+    memset(lengths, 5, INFLATE_MAX_DISTANCE_CODES);
+    inflate_build(inflater->distance.counts, inflater->distance.symbols, lengths, INFLATE_MAX_DISTANCE_CODES);
+    inflater->fixed_codes = true;
+}
+
+
+/**
+ * @brief Build a canonical Huffman code from its symbols' code lengths.
+ *
+ * @param counts:  Receives the number of codes of each length.
+ * @param symbols: Receives the symbols in code order.
+ * @param lengths: Each symbol's code length, or 0 if it is unused.
+ * @param count:   The number of symbols.
+ *
+ * @returns 0 if the code is complete, more if it is incomplete, or less
+ *          if it is over-subscribed.
+ */
+static int32_t inflate_build(uint16_t* counts, uint16_t* symbols, const uint8_t* lengths, uint32_t count) {
+
+    memset(counts, 0, (INFLATE_MAX_CODE_BITS + 1) * sizeof(uint16_t));
+    for (uint32_t symbol = 0 ; symbol < count ; ++symbol) counts[lengths[symbol]]++;
+    if (counts[0] == count) return 0;
+
+    int32_t left = 1;
+    for (uint32_t length = 1 ; length <= INFLATE_MAX_CODE_BITS ; ++length) {
+        left = (left << 1) - counts[length];
+        if (left < 0) return left;
+    }
+
+    // Each length's codes start where the shorter ones end
+    uint16_t offsets[INFLATE_MAX_CODE_BITS + 1];
+    offsets[1] = 0;
+    for (uint32_t length = 1 ; length < INFLATE_MAX_CODE_BITS ; ++length) offsets[length + 1] = offsets[length] + counts[length];
+    for (uint32_t symbol = 0 ; symbol < count ; ++symbol) {
+        if (lengths[symbol] != 0) symbols[offsets[lengths[symbol]]++] = (uint16_t)symbol;
+    }
+
+    return left;
+}
+
+
+/**
+ * @brief Decode a symbol from the bit buffer. Huffman codes are sent most
+ *        significant bit first, so are read a bit at a time until the code
+ *        so far falls in the range of codes of its length.
+ *
+ * @param inflater: The inflater.
+ * @param counts:   The code's counts per length.
+ * @param symbols:  The code's symbols.
+ *
+ * @returns The symbol, `INFLATE_NEED_INPUT` if the buffer holds too few
+ *          bits, in which case none are taken, or `INFLATE_BAD_CODE`.
+ */
+static int32_t inflate_decode(Inflater* inflater, const uint16_t* counts, const uint16_t* symbols) {
+
+    uint32_t bits = inflater->bits;
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+    for (uint32_t length = 1 ; length <= INFLATE_MAX_CODE_BITS ; ++length) {
+        if (length > inflater->bit_count) return INFLATE_NEED_INPUT;
+
+        code |= bits & 1;
+        bits >>= 1;
+        int32_t count = counts[length];
+        if (code - first < count) {
+            inflater->bits = bits;
+            inflater->bit_count -= length;
+            return symbols[index + code - first];
+        }
+
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return INFLATE_BAD_CODE;
+}
+
+
+/**
+ * @brief Top up the bit buffer from the input, a byte at a time.
+ *
+ * @param inflater: The inflater.
+ */
+static inline void inflate_fill(Inflater* inflater) {
+
+    while (inflater->bit_count <= 24 && inflater->input < inflater->input_end) {
+        inflater->bits |= (uint32_t)*inflater->input++ << inflater->bit_count;
+        inflater->bit_count += 8;
+    }
+}
+
+
+/**
+ * @brief Make sure the bit buffer holds enough bits, if the input allows.
+ *
+ * @param inflater: The inflater.
+ * @param count:    The number of bits needed, no more than 25.
+ *
+ * @returns `true` if the bits are there, otherwise `false`.
+ */
+static inline bool inflate_need(Inflater* inflater, uint32_t count) {
+
+    if (inflater->bit_count < count) inflate_fill(inflater);
+    return inflater->bit_count >= count;
+}
+
+
+/**
+ * @brief Take bits from the bit buffer, least significant first.
+ *
+ * @param inflater: The inflater.
+ * @param count:    The number of bits, no more than 16, which the buffer holds.
+ *
+ * @returns The bits.
+ */
+static inline uint32_t inflate_take(Inflater* inflater, uint32_t count) {
+
+    uint32_t value = inflater->bits & ((1u << count) - 1);
+    inflater->bits >>= count;
+    inflater->bit_count -= count;
+    return value;
+}
+
+
+/**
+ * @brief Take a whole byte from the input, via the bit buffer.
+ *        The stream must be at a byte boundary.
+ *
+ * @param inflater: The inflater.
+ * @param byte:     Receives the byte.
+ *
+ * @returns `true` if there was a byte, otherwise `false`.
+ */
+static bool inflate_byte(Inflater* inflater, uint8_t* byte) {
+
+    if (!inflate_need(inflater, 8)) return false;
+    *byte = (uint8_t)inflate_take(inflater, 8);
+    return true;
+}
+
+
+/**
+ * @brief Output a byte into the window, passing the window on once full.
+ *
+ * @param inflater: The inflater.
+ * @param byte:     The byte.
+ *
+ * @returns `false` if the sink stopped the stream, otherwise `true`.
+ */
+static inline bool inflate_put(Inflater* inflater, uint8_t byte) {
+
+    inflater->window[inflater->position++] = byte;
+    return inflater->position < INFLATE_WINDOW_SIZE_B || inflate_flush(inflater);
+}
+
+
+/**
+ * @brief Pass the output not yet seen by the sink to it, adding it to
+ *        the stream's check value, and wrap the window if it is full.
+ *
+ * @param inflater: The inflater.
+ *
+ * @returns `false` if the sink stopped the stream, otherwise `true`.
+ */
+static bool inflate_flush(Inflater* inflater) {
+
+    uint32_t length = inflater->position - inflater->flushed;
+    if (length > 0 && !inflater->stopped) {
+        const uint8_t* data = &inflater->window[inflater->flushed];
+        if (inflater->format == INFLATE_FORMAT_GZIP) {
+            inflater->check = digest_crc32(inflater->check, data, length);
+        } else if (inflater->format == INFLATE_FORMAT_ZLIB) {
+            inflater->check = inflate_adler32(inflater->check, data, length);
+        }
+
+        inflater->total_out += length;
+        if (!inflater->sink(data, length, inflater->context)) inflater->stopped = true;
+    }
+
+    if (inflater->position == INFLATE_WINDOW_SIZE_B) {
+        inflater->position = 0;
+        inflater->window_full = true;
+    }
+
+    inflater->flushed = inflater->position;
+    return !inflater->stopped;
+}
+
+
+/**
+ * @brief Mark the stream as corrupt.
+ *
+ * @param inflater: The inflater.
+ * @param error:    Why.
+ *
+ * @returns `false`.
+ */
+static bool inflate_fail(Inflater* inflater, InflateError error) {
+
+    inflater->error = error;
+    inflater->state = INFLATE_STATE_ERROR;
+    return false;
+}
+
+
+/**
+ * @brief Add data to an Adler-32 checksum.
+ *
+ * @param adler:  The checksum so far, or 1 to start.
+ * @param data:   The data.
+ * @param length: The size of the data in bytes.
+ *
+ * @returns The updated checksum.
+ */
+static uint32_t inflate_adler32(uint32_t adler, const uint8_t* data, uint32_t length) {
+
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (length > 0) {
+        // The sums can't overflow within a run this long
+        uint32_t run = length < INFLATE_ADLER_RUN ? length : INFLATE_ADLER_RUN;
+        length -= run;
+        while (run-- > 0) {
+            a += *data++;
+            b += a;
+        }
+
+        a %= INFLATE_ADLER_BASE;
+        b %= INFLATE_ADLER_BASE;
+    }
+
+    return (b << 16) | a;
+}
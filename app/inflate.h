@@ -0,0 +1,125 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _INFLATE_H_
+#define _INFLATE_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * CONSTANTS
+ */
+// The sliding window: the furthest back a match may reach. Deflate allows
+// up to 15 bits, 32KB; streams compressed with a larger window than this
+// fail to inflate. Servers must be set to match, eg. zlib's `windowBits`
+#ifndef INFLATE_WINDOW_BITS
+#define     INFLATE_WINDOW_BITS         10
+#endif
+#define     INFLATE_WINDOW_SIZE_B       (1 << INFLATE_WINDOW_BITS)
+
+#define     INFLATE_MAX_CODE_BITS       15
+#define     INFLATE_LITLEN_CODES        288
+#define     INFLATE_DISTANCE_CODES      32
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+// The stream's wrapper: a gzip member, as `Content-Encoding: gzip`, zlib,
+// as `deflate`, or none. Some servers send `deflate` unwrapped, so a zlib
+// stream without a valid header is taken to be raw deflate
+typedef enum {
+    INFLATE_FORMAT_GZIP = 0,
+    INFLATE_FORMAT_ZLIB,
+    INFLATE_FORMAT_RAW
+} InflateFormat;
+
+typedef enum {
+    INFLATE_ERROR_NONE = 0,
+    INFLATE_ERROR_HEADER,
+    INFLATE_ERROR_DATA,
+    INFLATE_ERROR_WINDOW,
+    INFLATE_ERROR_CHECK
+} InflateError;
+
+// Receives inflated data a run at a time. Return `false` to stop
+typedef bool (*InflateSink)(const uint8_t* data, uint32_t length, void* context);
+
+// A canonical Huffman code: the number of codes of each length, and the
+// symbols in code order
+typedef struct {
+    uint16_t    counts[INFLATE_MAX_CODE_BITS + 1];
+    uint16_t    symbols[INFLATE_LITLEN_CODES];
+} InflateLitLenCode;
+
+typedef struct {
+    uint16_t    counts[INFLATE_MAX_CODE_BITS + 1];
+    uint16_t    symbols[INFLATE_DISTANCE_CODES];
+} InflateDistanceCode;
+
+// Inflater state. Resumable at any byte, so a stream can be fed in chunks
+// split anywhere. Output is passed to the sink as it leaves the window,
+// and at the end of each feed. Uses no heap
+typedef struct {
+    InflateSink         sink;
+    void*               context;
+    const uint8_t*      input;
+    const uint8_t*      input_end;
+    uint8_t             format;
+    uint8_t             state;
+    uint8_t             error;
+    uint8_t             header_flags;
+    bool                final_block;
+    bool                fixed_codes;
+    bool                window_full;
+    bool                stopped;
+    uint32_t            bits;
+    uint32_t            bit_count;
+    uint16_t            symbol;
+    uint16_t            length;
+    uint16_t            literal_codes;
+    uint16_t            distance_codes;
+    uint16_t            length_codes;
+    uint16_t            index;
+    uint32_t            position;
+    uint32_t            flushed;
+    uint32_t            check;
+    uint32_t            total_in;
+    uint32_t            total_out;
+    uint8_t             lengths[INFLATE_LITLEN_CODES + INFLATE_DISTANCE_CODES];
+    InflateLitLenCode   litlen;
+    InflateDistanceCode distance;
+    uint8_t             window[INFLATE_WINDOW_SIZE_B];
+} Inflater;
+
+
+/*
+ * PROTOTYPES
+ */
+void        inflate_init(Inflater* inflater, InflateFormat format, InflateSink sink, void* context);
+bool        inflate_feed(Inflater* inflater, const uint8_t* data, uint32_t length);
+bool        inflate_finish(const Inflater* inflater);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _INFLATE_H_
@@ -0,0 +1,596 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <string.h>
+#include "json.h"
+
+
+/*
+ * NOTE This module has no Microvisor or RTOS dependencies, so it can be
+ *      built for the host too -- see `sim/bench/json_bench.c`.
+ *
+ *      The parser is a byte-at-a-time state machine. Everything it needs
+ *      to resume mid-token lives in `JsonParser`, so chunk boundaries can
+ *      fall anywhere, including inside strings, escapes and numbers.
+ *      Numbers are passed on as text; they are checked only for
+ *      legal characters.
+ */
+
+
+/*
+ * CONSTANTS
+ */
+enum {
+    JSON_STATE_VALUE = 0,
+    JSON_STATE_VALUE_OR_END,
+    JSON_STATE_KEY,
+    JSON_STATE_KEY_OR_END,
+    JSON_STATE_COLON,
+    JSON_STATE_AFTER_VALUE,
+    JSON_STATE_STRING,
+    JSON_STATE_ESCAPE,
+    JSON_STATE_UNICODE,
+    JSON_STATE_NUMBER,
+    JSON_STATE_LITERAL,
+    JSON_STATE_DONE,
+    JSON_STATE_ERROR
+};
+
+#define     JSON_CONTAINER_OBJECT       0
+#define     JSON_CONTAINER_ARRAY        1
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static bool         json_step(JsonParser* parser, uint8_t c);
+static bool         json_start_value(JsonParser* parser, uint8_t c);
+static bool         json_open(JsonParser* parser, uint8_t container);
+static bool         json_close(JsonParser* parser, uint8_t container);
+static void         json_emit(JsonParser* parser, JsonEventType type);
+static void         json_append(JsonParser* parser, uint8_t c);
+static void         json_append_utf8(JsonParser* parser, uint16_t code);
+static bool         json_is_space(uint8_t c);
+static const char*  json_literal_text(uint8_t type);
+static void         json_decode_event(const JsonEvent* event, void* context);
+static bool         json_decode_integer(const char* text, bool is_signed, int64_t* result);
+
+
+/**
+ * @brief Prepare a parser for a new document.
+ *
+ * @param parser:  The parser.
+ * @param handler: Called with each event.
+ * @param context: Passed to the handler.
+ */
+void json_init(JsonParser* parser, JsonHandler handler, void* context) {
+
+    memset((void *)parser, 0x00, sizeof(JsonParser));
+    parser->handler = handler;
+    parser->context = context;
+    parser->state = JSON_STATE_VALUE;
+}
+
+
+/**
+ * @brief Parse the next chunk of a document.
+ *
+ * @param parser: The parser.
+ * @param data:   The chunk.
+ * @param length: The size of the chunk in bytes.
+ *
+ * @returns `false` if the document is malformed, otherwise `true`.
+ */
+bool json_feed(JsonParser* parser, const uint8_t* data, uint32_t length) {
+
+    for (uint32_t i = 0 ; i < length ; ++i) {
+        if (!json_step(parser, data[i])) {
+            parser->state = JSON_STATE_ERROR;
+            return false;
+        }
+
+        parser->bytes++;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Signal the end of a document.
+ *
+ * A top-level number has no terminator, so it is emitted here.
+ *
+ * @param parser: The parser.
+ *
+ * @returns `true` if a complete, well-formed document was parsed, otherwise `false`.
+ */
+bool json_finish(JsonParser* parser) {
+
+    if (parser->state == JSON_STATE_NUMBER && parser->depth == 0) {
+        json_emit(parser, JSON_EVENT_NUMBER);
+        parser->state = JSON_STATE_DONE;
+    }
+
+    return parser->state == JSON_STATE_DONE;
+}
+
+
+/**
+ * @brief Advance the parser by one byte.
+ *
+ * @param parser: The parser.
+ * @param c:      The byte.
+ *
+ * @returns `false` if the byte is illegal here, otherwise `true`.
+ */
+static bool json_step(JsonParser* parser, uint8_t c) {
+
+    switch (parser->state) {
+        case JSON_STATE_VALUE:
+            if (json_is_space(c)) return true;
+            return json_start_value(parser, c);
+
+        case JSON_STATE_VALUE_OR_END:
+            if (json_is_space(c)) return true;
+            if (c == ']') return json_close(parser, JSON_CONTAINER_ARRAY);
+            return json_start_value(parser, c);
+
+        case JSON_STATE_KEY_OR_END:
+            if (c == '}') return json_close(parser, JSON_CONTAINER_OBJECT);
+            // Fall through
+        case JSON_STATE_KEY:
+            if (json_is_space(c)) return true;
+            if (c != '"') return false;
+            parser->in_key = true;
+            parser->key_length = 0;
+            parser->state = JSON_STATE_STRING;
+            return true;
+
+        case JSON_STATE_COLON:
+            if (json_is_space(c)) return true;
+            if (c != ':') return false;
+            parser->state = JSON_STATE_VALUE;
+            return true;
+
+        case JSON_STATE_AFTER_VALUE:
+            if (json_is_space(c)) return true;
+            if (c == ',') {
+                parser->state = parser->containers[parser->depth - 1] == JSON_CONTAINER_OBJECT ? JSON_STATE_KEY : JSON_STATE_VALUE;
+                return true;
+            }
+
+            if (c == '}') return json_close(parser, JSON_CONTAINER_OBJECT);
+            if (c == ']') return json_close(parser, JSON_CONTAINER_ARRAY);
+            return false;
+
+        case JSON_STATE_STRING:
+            if (c == '"') {
+                if (parser->in_key) {
+                    parser->key[parser->key_length] = '\0';
+                    parser->have_key = true;
+                    parser->in_key = false;
+                    parser->state = JSON_STATE_COLON;
+                } else {
+                    json_emit(parser, JSON_EVENT_STRING);
+                }
+
+                return true;
+            }
+
+            if (c == '\\') {
+                parser->state = JSON_STATE_ESCAPE;
+                return true;
+            }
+
+            // Control characters must be escaped
+            if (c < 0x20) return false;
+            json_append(parser, c);
+            return true;
+
+        case JSON_STATE_ESCAPE:
+            parser->state = JSON_STATE_STRING;
+            switch (c) {
+                case '"':
+                case '\\':
+                case '/':   json_append(parser, c);     return true;
+                case 'b':   json_append(parser, '\b');  return true;
+                case 'f':   json_append(parser, '\f');  return true;
+                case 'n':   json_append(parser, '\n');  return true;
+                case 'r':   json_append(parser, '\r');  return true;
+                case 't':   json_append(parser, '\t');  return true;
+                case 'u':
+                    parser->unicode_digits = 0;
+                    parser->unicode_value = 0;
+                    parser->state = JSON_STATE_UNICODE;
+                    return true;
+                default:
+                    return false;
+            }
+
+        case JSON_STATE_UNICODE:
+            if (c >= '0' && c <= '9') {
+                c -= '0';
+            } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+                c = (c | 0x20) - 'a' + 10;
+            } else {
+                return false;
+            }
+
+            parser->unicode_value = (parser->unicode_value << 4) | c;
+            if (++parser->unicode_digits == 4) {
+                // NOTE Surrogate pairs are not combined: each half
+                //      is encoded as it stands
+                json_append_utf8(parser, parser->unicode_value);
+                parser->state = JSON_STATE_STRING;
+            }
+
+            return true;
+
+        case JSON_STATE_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                json_append(parser, c);
+                return true;
+            }
+
+            // The number ends at the first byte that can't be part of it,
+            // which must then be handled as the byte after a value
+            json_emit(parser, JSON_EVENT_NUMBER);
+            if (parser->state == JSON_STATE_DONE) return json_is_space(c);
+            return json_step(parser, c);
+
+        case JSON_STATE_LITERAL: {
+            const char* text = json_literal_text(parser->literal);
+            if (c != (uint8_t)text[parser->literal_index]) return false;
+            if (text[++parser->literal_index] == '\0') json_emit(parser, (JsonEventType)parser->literal);
+            return true;
+        }
+
+        case JSON_STATE_DONE:
+            // Only whitespace may follow the document
+            return json_is_space(c);
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * @brief Begin a value at its first byte.
+ *
+ * @param parser: The parser.
+ * @param c:      The byte.
+ *
+ * @returns `false` if no value can start with the byte, otherwise `true`.
+ */
+static bool json_start_value(JsonParser* parser, uint8_t c) {
+
+    parser->value_length = 0;
+    parser->truncated = false;
+
+    switch (c) {
+        case '{':
+            return json_open(parser, JSON_CONTAINER_OBJECT);
+        case '[':
+            return json_open(parser, JSON_CONTAINER_ARRAY);
+        case '"':
+            parser->in_key = false;
+            parser->state = JSON_STATE_STRING;
+            return true;
+        case 't':
+            parser->literal = JSON_EVENT_TRUE;
+            break;
+        case 'f':
+            parser->literal = JSON_EVENT_FALSE;
+            break;
+        case 'n':
+            parser->literal = JSON_EVENT_NULL;
+            break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                json_append(parser, c);
+                parser->state = JSON_STATE_NUMBER;
+                return true;
+            }
+
+            return false;
+    }
+
+    parser->literal_index = 1;
+    parser->state = JSON_STATE_LITERAL;
+    return true;
+}
+
+
+/**
+ * @brief Enter an object or array.
+ *
+ * @param parser:    The parser.
+ * @param container: `JSON_CONTAINER_OBJECT` or `JSON_CONTAINER_ARRAY`.
+ *
+ * @returns `false` if the document is nested too deeply, otherwise `true`.
+ */
+static bool json_open(JsonParser* parser, uint8_t container) {
+
+    if (parser->depth == JSON_MAX_DEPTH) return false;
+
+    json_emit(parser, container == JSON_CONTAINER_OBJECT ? JSON_EVENT_OBJECT_START : JSON_EVENT_ARRAY_START);
+    parser->containers[parser->depth++] = container;
+    if (parser->depth > parser->max_depth) parser->max_depth = parser->depth;
+    parser->state = container == JSON_CONTAINER_OBJECT ? JSON_STATE_KEY_OR_END : JSON_STATE_VALUE_OR_END;
+    return true;
+}
+
+
+/**
+ * @brief Leave an object or array.
+ *
+ * @param parser:    The parser.
+ * @param container: `JSON_CONTAINER_OBJECT` or `JSON_CONTAINER_ARRAY`.
+ *
+ * @returns `false` if that is not the container being parsed, otherwise `true`.
+ */
+static bool json_close(JsonParser* parser, uint8_t container) {
+
+    if (parser->depth == 0 || parser->containers[parser->depth - 1] != container) return false;
+
+    parser->depth--;
+    json_emit(parser, container == JSON_CONTAINER_OBJECT ? JSON_EVENT_OBJECT_END : JSON_EVENT_ARRAY_END);
+    return true;
+}
+
+
+/**
+ * @brief Pass an event to the handler and move on to what follows a value.
+ *
+ * @param parser: The parser.
+ * @param type:   The event type.
+ */
+static void json_emit(JsonParser* parser, JsonEventType type) {
+
+    bool is_end = type == JSON_EVENT_OBJECT_END || type == JSON_EVENT_ARRAY_END;
+    bool has_text = type == JSON_EVENT_STRING || type == JSON_EVENT_NUMBER;
+
+    parser->value[parser->value_length] = '\0';
+    const JsonEvent event = {
+        .type = type,
+        .depth = parser->depth,
+        .key = parser->have_key && !is_end ? parser->key : NULL,
+        .key_length = parser->have_key && !is_end ? parser->key_length : 0,
+        .value = has_text ? parser->value : NULL,
+        .length = has_text ? parser->value_length : 0,
+        .truncated = has_text && parser->truncated
+    };
+
+    // The key applies to the value it precedes only
+    if (!is_end) parser->have_key = false;
+    if (parser->handler != NULL) parser->handler(&event, parser->context);
+
+    // The top-level value completes the document
+    parser->state = parser->depth == 0 ? JSON_STATE_DONE : JSON_STATE_AFTER_VALUE;
+}
+
+
+/**
+ * @brief Add a byte to the key or value being parsed, or note
+ *        that it was dropped because the buffer is full.
+ *
+ * @param parser: The parser.
+ * @param c:      The byte.
+ */
+static void json_append(JsonParser* parser, uint8_t c) {
+
+    if (parser->in_key) {
+        if (parser->key_length < JSON_MAX_KEY_LEN) parser->key[parser->key_length++] = (char)c;
+    } else if (parser->value_length < JSON_MAX_VALUE_LEN) {
+        parser->value[parser->value_length++] = (char)c;
+    } else {
+        parser->truncated = true;
+    }
+}
+
+
+/**
+ * @brief Add a `\u` escaped character to the key or value being parsed.
+ *
+ * @param parser: The parser.
+ * @param code:   The UTF-16 code unit.
+ */
+static void json_append_utf8(JsonParser* parser, uint16_t code) {
+
+    if (code < 0x80) {
+        json_append(parser, (uint8_t)code);
+    } else if (code < 0x800) {
+        json_append(parser, (uint8_t)(0xC0 | (code >> 6)));
+        json_append(parser, (uint8_t)(0x80 | (code & 0x3F)));
+    } else {
+        json_append(parser, (uint8_t)(0xE0 | (code >> 12)));
+        json_append(parser, (uint8_t)(0x80 | ((code >> 6) & 0x3F)));
+        json_append(parser, (uint8_t)(0x80 | (code & 0x3F)));
+    }
+}
+
+
+/**
+ * @brief Check for JSON whitespace.
+ *
+ * @param c: The byte.
+ *
+ * @returns `true` if the byte is whitespace, otherwise `false`.
+ */
+static bool json_is_space(uint8_t c) {
+
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+
+/**
+ * @brief Get the text of a literal.
+ *
+ * @param type: `JSON_EVENT_TRUE`, `JSON_EVENT_FALSE` or `JSON_EVENT_NULL`.
+ *
+ * @returns The literal.
+ */
+static const char* json_literal_text(uint8_t type) {
+
+    switch (type) {
+        case JSON_EVENT_TRUE:   return "true";
+        case JSON_EVENT_FALSE:  return "false";
+        default:                return "null";
+    }
+}
+
+
+/**
+ * @brief Hash a key the way `JSON_KEY_HASH()` does.
+ *
+ * @param key:    The key.
+ * @param length: The length of the key in bytes.
+ *
+ * @returns The hash.
+ */
+uint32_t json_key_hash(const char* key, uint32_t length) {
+
+    if (length == 0) return 0;
+    return (length << 16) ^ ((uint32_t)(uint8_t)key[0] << 8) ^ (uint32_t)(uint8_t)key[length - 1];
+}
+
+
+/**
+ * @brief Prepare to decode an object into a struct.
+ *
+ * Fields absent from the document are left as they are in the struct.
+ *
+ * @param decoder: The decoder.
+ * @param schema:  The struct's schema.
+ * @param target:  The struct to fill.
+ */
+void json_decoder_init(JsonDecoder* decoder, const JsonSchema* schema, void* target) {
+
+    json_init(&decoder->parser, json_decode_event, decoder);
+    decoder->schema = schema;
+    decoder->target = (uint8_t*)target;
+    decoder->found = 0;
+}
+
+
+/**
+ * @brief Decode the next chunk of a document.
+ *
+ * @param decoder: The decoder.
+ * @param data:    The chunk.
+ * @param length:  The size of the chunk in bytes.
+ *
+ * @returns `false` if the document is malformed, otherwise `true`.
+ */
+bool json_decoder_feed(JsonDecoder* decoder, const uint8_t* data, uint32_t length) {
+
+    return json_feed(&decoder->parser, data, length);
+}
+
+
+/**
+ * @brief Signal the end of a document being decoded.
+ *
+ * @param decoder: The decoder.
+ *
+ * @returns `true` if the document was well formed and
+ *          every schema field was filled, otherwise `false`.
+ */
+bool json_decoder_finish(JsonDecoder* decoder) {
+
+    uint32_t all = decoder->schema->count >= 32 ? 0xFFFFFFFF : (1UL << decoder->schema->count) - 1;
+    return json_finish(&decoder->parser) && decoder->found == all;
+}
+
+
+/**
+ * @brief Parser event handler that stores a top-level member's value in
+ *        the schema field with the same key.
+ *
+ * The key is matched by its hash, so only a field whose hash matches
+ * needs its key compared. Values of the wrong type are ignored.
+ *
+ * @param event:   The parser event.
+ * @param context: The decoder.
+ */
+static void json_decode_event(const JsonEvent* event, void* context) {
+
+    JsonDecoder* decoder = (JsonDecoder*)context;
+    if (event->depth != 1 || event->key == NULL) return;
+
+    uint32_t hash = json_key_hash(event->key, event->key_length);
+    const JsonSchema* schema = decoder->schema;
+    for (uint32_t i = 0 ; i < schema->count ; ++i) {
+        const JsonField* field = &schema->fields[i];
+        if (field->hash != hash || memcmp(field->key, event->key, event->key_length + 1) != 0) continue;
+
+        uint8_t* member = decoder->target + field->offset;
+        int64_t number = 0;
+        switch (field->type) {
+            case JSON_FIELD_UINT32:
+                if (event->type != JSON_EVENT_NUMBER || !json_decode_integer(event->value, false, &number)) return;
+                *(uint32_t*)member = (uint32_t)number;
+                break;
+            case JSON_FIELD_INT32:
+                if (event->type != JSON_EVENT_NUMBER || !json_decode_integer(event->value, true, &number)) return;
+                *(int32_t*)member = (int32_t)number;
+                break;
+            case JSON_FIELD_BOOL:
+                if (event->type != JSON_EVENT_TRUE && event->type != JSON_EVENT_FALSE) return;
+                *(bool*)member = event->type == JSON_EVENT_TRUE;
+                break;
+            case JSON_FIELD_STRING: {
+                if (event->type != JSON_EVENT_STRING) return;
+                uint32_t length = event->length < field->size ? event->length : field->size - 1u;
+                memcpy(member, event->value, length);
+                member[length] = '\0';
+                break;
+            }
+            default:
+                return;
+        }
+
+        decoder->found |= 1UL << i;
+        return;
+    }
+}
+
+
+/**
+ * @brief Convert number text to a 32-bit integer.
+ *
+ * @param text:      The number, as passed by the parser.
+ * @param is_signed: `true` to accept negative values.
+ * @param result:    Receives the value.
+ *
+ * @returns `false` if the number is not an integer in range, otherwise `true`.
+ */
+static bool json_decode_integer(const char* text, bool is_signed, int64_t* result) {
+
+    bool negative = *text == '-';
+    if (negative) {
+        if (!is_signed) return false;
+        text++;
+    }
+
+    if (*text == '\0') return false;
+
+    int64_t value = 0;
+    for ( ; *text != '\0' ; ++text) {
+        if (*text < '0' || *text > '9') return false;
+        value = value * 10 + (*text - '0');
+        if (value > (is_signed ? 0x80000000LL : 0xFFFFFFFFLL)) return false;
+    }
+
+    if (negative) value = -value;
+    if (is_signed && value > 0x7FFFFFFFLL) return false;
+    *result = value;
+    return true;
+}
@@ -0,0 +1,174 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _JSON_H_
+#define _JSON_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/*
+ * CONSTANTS
+ */
+// Deepest nesting of objects and arrays the parser will accept
+#define     JSON_MAX_DEPTH              8
+
+// Keys and scalar values longer than these are truncated
+#define     JSON_MAX_KEY_LEN            32
+#define     JSON_MAX_VALUE_LEN          96
+
+// Hash of a key's length and first and last characters. Used to match
+// object members against a schema, so it must give the same result as
+// `json_key_hash()`. With a string literal, it is computed at compile time
+#define     JSON_KEY_HASH(key)          (((uint32_t)(sizeof(key) - 1) << 16) ^ ((uint32_t)(uint8_t)(key)[0] << 8) ^ (uint32_t)(uint8_t)(key)[sizeof(key) - 2])
+
+/*
+ * Schema support. A struct and its schema are declared once from a list of
+ * `FIELD(type_name, key, member, kind, size)` entries, where `kind` is one of
+ * UINT32, INT32, BOOL or STRING, and `size` is a STRING field's capacity
+ * including its NUL. For example:
+ *
+ *   #define THING_FIELDS(FIELD, T) \
+ *       FIELD(T, "id",    id,    UINT32, 0) \
+ *       FIELD(T, "name",  name,  STRING, 16)
+ *
+ *   typedef struct { THING_FIELDS(JSON_STRUCT_MEMBER, Thing) } Thing;
+ *   JSON_DEFINE_SCHEMA(thing_schema, Thing, THING_FIELDS);
+ */
+#define     JSON_MEMBER_UINT32(member, size)    uint32_t member
+#define     JSON_MEMBER_INT32(member, size)     int32_t member
+#define     JSON_MEMBER_BOOL(member, size)      bool member
+#define     JSON_MEMBER_STRING(member, size)    char member[size]
+
+#define     JSON_STRUCT_MEMBER(type_name, key, member, kind, size) \
+                JSON_MEMBER_##kind(member, size);
+
+#define     JSON_FIELD_DESCRIPTOR(type_name, key, member, kind, size) \
+                { key, JSON_KEY_HASH(key), offsetof(type_name, member), sizeof(((type_name*)0)->member), JSON_FIELD_##kind },
+
+#define     JSON_DEFINE_SCHEMA(name, type_name, FIELDS) \
+                static const JsonField name##_fields[] = { FIELDS(JSON_FIELD_DESCRIPTOR, type_name) }; \
+                const JsonSchema name = { name##_fields, sizeof(name##_fields) / sizeof(JsonField) }
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+typedef enum {
+    JSON_EVENT_OBJECT_START = 0,
+    JSON_EVENT_OBJECT_END,
+    JSON_EVENT_ARRAY_START,
+    JSON_EVENT_ARRAY_END,
+    JSON_EVENT_STRING,
+    JSON_EVENT_NUMBER,
+    JSON_EVENT_TRUE,
+    JSON_EVENT_FALSE,
+    JSON_EVENT_NULL
+} JsonEventType;
+
+// An event passed to the parser's handler. `key` is the member name,
+// `key_length` bytes long, when the value is in an object, or `NULL` when
+// it is in an array or at the top level. `value` holds string and number
+// text, with `length` bytes before its terminating NUL. Both are valid
+// only during the call
+typedef struct {
+    JsonEventType   type;
+    uint32_t        depth;
+    const char*     key;
+    uint32_t        key_length;
+    const char*     value;
+    uint32_t        length;
+    bool            truncated;
+} JsonEvent;
+
+typedef void (*JsonHandler)(const JsonEvent* event, void* context);
+
+// Parser state. Resumable at any byte, so a document can be fed in
+// chunks split anywhere. Uses no heap, and its stack use doesn't grow
+// with the document's nesting
+typedef struct {
+    JsonHandler     handler;
+    void*           context;
+    uint8_t         state;
+    uint8_t         literal;
+    uint8_t         depth;
+    uint8_t         max_depth;
+    uint8_t         containers[JSON_MAX_DEPTH];
+    bool            in_key;
+    bool            have_key;
+    bool            truncated;
+    uint8_t         literal_index;
+    uint8_t         unicode_digits;
+    uint16_t        unicode_value;
+    uint32_t        key_length;
+    uint32_t        value_length;
+    uint32_t        bytes;
+    char            key[JSON_MAX_KEY_LEN + 1];
+    char            value[JSON_MAX_VALUE_LEN + 1];
+} JsonParser;
+
+typedef enum {
+    JSON_FIELD_UINT32 = 0,
+    JSON_FIELD_INT32,
+    JSON_FIELD_BOOL,
+    JSON_FIELD_STRING
+} JsonFieldType;
+
+// A schema field: where a top-level object member's value goes in the struct
+typedef struct {
+    const char*     key;
+    uint32_t        hash;
+    uint16_t        offset;
+    uint16_t        size;
+    JsonFieldType   type;
+} JsonField;
+
+typedef struct {
+    const JsonField*    fields;
+    uint32_t            count;
+} JsonSchema;
+
+// Decodes an object into a schema's struct in one pass as it is parsed.
+// `found` has bit n set once the schema's field n has been filled
+typedef struct {
+    JsonParser          parser;
+    const JsonSchema*   schema;
+    uint8_t*            target;
+    uint32_t            found;
+} JsonDecoder;
+
+
+/*
+ * PROTOTYPES
+ */
+void    json_init(JsonParser* parser, JsonHandler handler, void* context);
+bool    json_feed(JsonParser* parser, const uint8_t* data, uint32_t length);
+bool    json_finish(JsonParser* parser);
+uint32_t json_key_hash(const char* key, uint32_t length);
+void    json_decoder_init(JsonDecoder* decoder, const JsonSchema* schema, void* target);
+bool    json_decoder_feed(JsonDecoder* decoder, const uint8_t* data, uint32_t length);
+bool    json_decoder_finish(JsonDecoder* decoder);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _JSON_H_
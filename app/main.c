@@ -16,41 +16,52 @@ static void gpio_init(void);
 static void start_app(void);
 static void task_led(void *argument);
 static void task_http(void *argument);
-static void process_http_response(void);
-static void output_headers(uint32_t n);
+static void process_http_response(const HttpResponse* response, void* context);
+static void log_todo(const Todo* todo, const char* note);
+static void format_todo_url(char* url, size_t size, uint32_t item_number);
+static void output_headers(const HttpResponse* response, uint32_t n);
 static void setup_sys_notification_center(void);
 static void do_polite_deploy(void *arg);
 static void do_clear_led(void* arg);
+static void download_done(DownloadResult result, uint32_t length, void* context);
+static void handle_sys_notification(const EventRecord* record, void* context);
 
 
 /*
  * GLOBALS
  *
- * Theses variables may be changed by interrupt handler code,
- * so we mark them as `volatile` to ensure compiler optimization
- * doesn't render them immutable at runtime
+ * These variables are set by the HTTP engine task, in the response
+ * callback, and read by the HTTP task, so we mark them as `volatile`
+ * to ensure compiler optimization doesn't render them immutable at runtime
  */
-volatile bool   received_request = false;
-volatile bool   channel_was_closed = false;
-volatile bool   polite_deploy = false;
-         bool   reset_count = false;
-
-// Central store for HTTP request management notification records.
-// Holds HTTP_NT_BUFFER_SIZE_R records at a time -- each record is 16 bytes in size.
-static struct MvNotification sys_notification_center[4] __attribute__((aligned(8)));
-// Modified in ISR
-static volatile uint32_t current_notification_index = 0;
-
-// Local notification center/emitter handles
-MvNotificationHandle sys_nc_handle;
+volatile bool   reset_count = false;
+
+// The last version of each todo received, to reuse when the server
+// reports it unchanged. Only written by the HTTP engine task
+static Todo todo_cache[TODO_CACHE_LEN];
+
+// The todo request, laid out once. Only the item number changes
+static const struct MvHttpHeader todo_headers[] = { HTTP_HEADER("Accept: application/cbor, application/json;q=0.9") };
+static const HttpTemplate todo_request = {
+    HTTP_TEMPLATE("GET", "https://jsonplaceholder.typicode.com/todos/", ""),
+    .headers = todo_headers,
+    .num_headers = sizeof(todo_headers) / sizeof(struct MvHttpHeader)
+};
+
+// Local system notification emitter handle
 MvSystemEventHandle sys_emitter_handle;
 
+// Applies a downloaded update. Only used on the HTTP engine task
+static osTimerId_t polite_timer = NULL;
+
 
 /**
  *  @brief The application entry point.
  */
 int main(void) {
 
+    boot_mark(BOOT_STAGE_MAIN);
+
     // Reset of all peripherals, Initializes the Flash interface and the sys tick.
     HAL_Init();
 
@@ -70,9 +81,6 @@ int main(void) {
     // Configure system-level notification
     setup_sys_notification_center();
 
-    // Start the network
-    net_open_network();
-
     // Set up and start application threads
     start_app();
 
@@ -119,17 +127,25 @@ static void start_app(void) {
         .priority = osPriorityNormal
     };
 
-    // This is the CMSIS/FreeRTOS thread task that sends HTTP requests
+    // This is the CMSIS/FreeRTOS thread task that queues HTTP requests
     const osThreadAttr_t attributes_thread_http = {
         .name = "HTTPTask",
-        .stack_size = 16384,
+        .stack_size = 4096,
         .priority = osPriorityNormal
     };
 
     // Init scheduler
     osKernelInitialize();
 
-    // Create the FreeRTOS thread(s)
+    // Ask for the network. The scheduler starts while it connects,
+    // and tasks that need it wait with `net_wait_for_network()`
+    net_open_network();
+
+    // Create the FreeRTOS thread(s), starting with the HTTP engine
+    // that will service the requests the HTTP task submits, and post
+    // the telemetry the LED task records
+    telemetry_init();
+    do_assert(http_start_engine(), "Could not start HTTP engine");
     osThreadNew(task_http, NULL, &attributes_thread_http);
     osThreadNew(task_led,  NULL, &attributes_thread_led);
 
@@ -146,7 +162,6 @@ static void start_app(void) {
 static void task_led(void* argument) {
 
     uint32_t last_tick = 0;
-    osTimerId_t polite_timer = NULL;
 
     // FROM 3.3.0
     // Set a timer to turn off the System LED approx. 60s after boot
@@ -162,28 +177,13 @@ static void task_led(void* argument) {
         if (tick - last_tick > LED_PAUSE_MS) {
             last_tick = tick;
             HAL_GPIO_WritePin(LED_GPIO_BANK, LED_GPIO_PIN, GPIO_PIN_SET);
+
+            // Readings are batched, and posted together by the HTTP engine
+            telemetry_record(TELEMETRY_SENSOR_UPTIME, (int32_t)(tick / 1000));
         } else if (tick - last_tick > LED_PULSE_MS) {
             HAL_GPIO_WritePin(LED_GPIO_BANK, LED_GPIO_PIN, GPIO_PIN_RESET);
         }
 
-        // FROM 3.2.0
-        // Check if the polite deployment flag has been set
-        // via a Microvisor system notification
-        if (polite_deploy) {
-            server_log("Polite deployment notification issued");
-            polite_deploy = false;
-
-            // Set up a 30s timer to trigger the update
-            // NOTE In a real-world application, you would apply the update
-            //      see `do_polite_deploy()` as soon as any current critical task
-            //      completes. Here we just demo the process using a HAL timer.
-            polite_timer = osTimerNew(do_polite_deploy, osTimerOnce, NULL, NULL);
-            const uint32_t timer_delay_s = 30;
-            if (polite_timer != NULL && osTimerStart(polite_timer, timer_delay_s * 1000) == osOK) {
-                server_log("Update will install in %lu seconds", timer_delay_s);
-            }
-        }
-
         // End of cycle delay
         osDelay(10);
     }
@@ -198,59 +198,52 @@ static void task_led(void* argument) {
 static void task_http(void *argument) {
 
     uint32_t ping_count = 1;
-    uint32_t kill_time = 0;
-    uint32_t send_tick = HAL_GetTick() - REQUEST_SEND_PERIOD_MS;
-    bool do_close_channel = false;
+    uint32_t item_number = 1;
+
+    for (uint32_t i = 1 ; i <= TODO_PERSIST_COUNT ; ++i) {
+        char url[HTTP_MAX_URL_LEN] = "";
+        format_todo_url(url, sizeof(url), i);
+        http_persist_url(url);
+    }
+
+    // The HTTP engine loads the responses kept in flash while we wait
+    net_wait_for_network(osWaitForever);
 
-    // Set up HTTP notifications
-    http_setup_notification_center();
+    if (!download_start(DOWNLOAD_DEMO_URL, NULL, download_flash_sink, download_done, NULL)) {
+        server_error("Could not start download");
+    }
+
+    // The HTTP engine wakes us every REQUEST_SEND_PERIOD_MS, starting now
+    if (!http_start_pulse(REQUEST_SEND_PERIOD_MS, REQUEST_SEND_FLAG)) {
+        server_error("Could not schedule requests");
+    }
 
     // Run the thread's main loop
     while (1) {
-        uint32_t tick = HAL_GetTick();
-        if (tick - send_tick > REQUEST_SEND_PERIOD_MS) {
-            // Display the current count
-            send_tick = tick;
-            server_log("Ping %lu", ping_count++);
-
-            // No channel open? The try and open a new one
-            if (http_get_handle() == 0 && http_open_channel()) {
-                if (http_send_request(ping_count) != 0) do_close_channel = true;
-                kill_time = tick;
-            } else {
-                server_error("Channel handle not zero or could not open channel");
-                if (http_get_handle() != 0) do_close_channel = true;
-            }
-        }
+        osThreadFlagsWait(REQUEST_SEND_FLAG, osFlagsWaitAny, osWaitForever);
 
-        // Process a request's response if indicated by the ISR
-        if (received_request) process_http_response();
+        // Hold off while the network is down. Requests already queued
+        // go out as soon as it's back
+        if (!net_is_up()) {
+            server_log("Waiting for the network");
+            net_wait_for_network(osWaitForever);
 
-        // Respond to unexpected channel closure
-        if (channel_was_closed) {
-            enum MvClosureReason reason = 0;
-            if (mvGetChannelClosureReason(http_get_handle(), &reason) == MV_STATUS_OKAY) {
-                server_log("Closure reason: %lu", (uint32_t)reason);
-            }
-
-            channel_was_closed = false;
-            do_close_channel = true;
+            // One round goes out now, not one for each period missed
+            osThreadFlagsClear(REQUEST_SEND_FLAG);
         }
 
-        // Use 'kill_time' to force-close an open HTTP channel
-        // if it's been left open too long
-        if (kill_time > 0 && tick - kill_time > CHANNEL_KILL_PERIOD_MS) {
-            do_close_channel = true;
-            server_error("HTTP request timed out");
-        }
+        // Display the current count
+        server_log("Ping %lu", ping_count++);
 
-        // If we've received a response in an interrupt handler,
-        // we can close the HTTP channel for the time being
-        if (received_request || do_close_channel) {
-            do_close_channel = false;
-            received_request = false;
-            kill_time = 0;
-            http_close_channel();
+        // Queue requests for the next items, one per pool channel. The HTTP
+        // engine sends them and hands each response to `process_http_response()`
+        for (uint32_t i = 0 ; i < HTTP_CHANNEL_POOL_SIZE ; ++i) {
+            if (http_submit_template(&todo_request, item_number, process_http_response, (void*)(uintptr_t)item_number) == 0) {
+                server_error("Could not send request");
+                break;
+            }
+
+            item_number++;
         }
 
         // Reached the end of the items available from the API
@@ -258,122 +251,190 @@ static void task_http(void *argument) {
         if (reset_count) {
             reset_count = false;
             ping_count = 1;
+            item_number = 1;
         }
+    }
+}
 
-        // End of cycle delay
-        osDelay(10);
+
+/**
+ * @brief Report the demo download's outcome. Called on the HTTP engine task.
+ *
+ * @param result:  How the download ended.
+ * @param length:  The bytes downloaded.
+ * @param context: Not used.
+ */
+static void download_done(DownloadResult result, uint32_t length, void* context) {
+
+    const DownloadStats* stats = download_get_stats();
+    if (result != DOWNLOAD_OK) {
+        server_error("Download failed (%u) after %lu bytes", (unsigned)result, length);
+        return;
     }
+
+    server_log("Downloaded %lu bytes to flash at %p. Resumed from %lu, %lu slices, %lu retries",
+               length, download_flash_data(), stats->resumed_from, stats->slices, stats->retries);
 }
 
 
 /**
- * @brief Process HTTP response data
+ * @brief Process HTTP response data. Called on the HTTP engine task.
+ *
+ * @param response: The request's outcome.
+ * @param context:  The number of the item requested.
  */
-static void process_http_response(void) {
-
-    // We have received data via the active HTTP channel so establish
-    // an `MvHttpResponseData` record to hold response metadata
-    static struct MvHttpResponseData resp_data;
-    MvChannelHandle channel_handle = http_get_handle();
-    enum MvStatus status = mvReadHttpResponseData(channel_handle, &resp_data);
-    if (status == MV_STATUS_OKAY) {
+static void process_http_response(const HttpResponse* response, void* context) {
+
+    uint32_t item_number = (uint32_t)(uintptr_t)context;
+    Todo* cached = &todo_cache[(item_number - 1) % TODO_CACHE_LEN];
+
+    if (response->status == MV_STATUS_OKAY) {
         // Check we successfully issued the request (`result` is OK) and
         // the request was successful (status code 200)
-        if (resp_data.result == MV_HTTPRESULT_OK) {
-            if (resp_data.status_code == 200) {
-                server_log("HTTP response received. Body length: %lu bytes, %lu headers", resp_data.body_length, resp_data.num_headers);
-
-                // Set up a buffer that we'll get Microvisor to write
-                // the response body into
-                uint8_t buffer[resp_data.body_length + 1];
-                memset((void *)buffer, 0x00, resp_data.body_length + 1);
-                status = mvReadHttpResponseBody(channel_handle, 0, buffer, resp_data.body_length);
-                if (status == MV_STATUS_OKAY) {
-                    // Retrieved the body data successfully so log it
-                    server_log("Message JSON:\n%s", buffer);
-                    output_headers(resp_data.num_headers > MAX_HEADERS_OUTPUT ? MAX_HEADERS_OUTPUT : resp_data.num_headers);
+        if (response->result == MV_HTTPRESULT_OK) {
+            if (response->status_code == 200) {
+                server_log("HTTP response received. Body length: %lu bytes, %lu headers", response->body_length, response->num_headers);
+
+                // Have Microvisor write the response body into a small buffer,
+                // one chunk at a time, and decode each chunk into a `Todo`
+                // as JSON or CBOR, whichever the server sent
+                Todo todo = { 0 };
+                uint32_t found = 0;
+                HttpDecodeResult result = http_decode_body(response, &todo_schema, &todo, &found);
+                if (result == HTTP_DECODE_OK) {
+                    // Keep the todo in case it comes back unchanged next time
+                    *cached = todo;
+                    log_todo(&todo, "");
+                } else if (result == HTTP_DECODE_UNSUPPORTED) {
+                    server_error("Response is not JSON or CBOR");
+                } else if (result == HTTP_DECODE_READ_FAILED) {
+                    server_error("HTTP response body read failed");
                 } else {
-                    server_error("HTTP response body read status %i", status);
+                    server_error("Response is not a todo (fields found: 0x%02lx)", found);
                 }
-            } else if (resp_data.status_code == 404) {
+
+                output_headers(response, response->num_headers > MAX_HEADERS_OUTPUT ? MAX_HEADERS_OUTPUT : response->num_headers);
+            } else if (response->status_code == 304) {
+                // The todo hasn't changed since we last decoded it, so reuse that
+                if (cached->id == item_number) {
+                    log_todo(cached, " [not modified]");
+                } else {
+                    // We no longer have it, so make sure the next request fetches it in full
+                    char url[HTTP_MAX_URL_LEN] = "";
+                    format_todo_url(url, sizeof(url), item_number);
+                    http_forget_validators(url);
+                    server_error("Todo %lu not modified but not cached", item_number);
+                }
+            } else if (response->status_code == 404) {
                 // Reached the end of available items, so reset the counter
                 reset_count = true;
                 server_log("Resetting ping count");
             } else {
-                server_error("HTTP status code: %lu", resp_data.status_code);
+                server_error("HTTP status code: %lu", response->status_code);
             }
         } else {
-            server_error("Request failed. Status: %i", resp_data.result);
+            server_error("Request failed. Status: %i", response->result);
         }
     } else {
-        server_error("Response data read failed. Status: %i", status);
+        server_error("Request %lu failed. Status: %i", response->request_id, response->status);
     }
 }
 
 
+/**
+ * @brief Log a todo.
+ *
+ * @param todo: The todo.
+ * @param note: Text to append.
+ */
+static void log_todo(const Todo* todo, const char* note) {
+
+    server_log("Todo %lu for user %lu: \"%s\" (%s)%s", todo->id, todo->user_id, todo->title, todo->completed ? "done" : "to do", note);
+}
+
+
+/**
+ * @brief Write the URL of a todo.
+ *
+ * @param url:         The buffer to write to.
+ * @param size:        The size of the buffer in bytes.
+ * @param item_number: The todo's ID.
+ */
+static void format_todo_url(char* url, size_t size, uint32_t item_number) {
+
+    http_template_url(&todo_request, item_number, url, size);
+}
+
+
 /**
  * @brief Output all received headers.
  *
+ * @param response:    The response.
  * @param num_headers: The number of headers to list.
  */
-static void output_headers(uint32_t num_headers) {
-
-    static uint8_t buffer[256] = {0};
+static void output_headers(const HttpResponse* response, uint32_t num_headers) {
 
-    if (num_headers > 0) {
-        for (uint32_t i = 0 ; i < num_headers ; ++i) {
-            memset((void *)buffer, 0x00, 256);
-            if (mvReadHttpResponseHeader(http_get_handle(), i, buffer, 255) == MV_STATUS_OKAY) {
-                server_log("Header %02lu. %s", i + 1, buffer);
-            } else {
-                server_error("Could not read header %lu", i + 1);
-            }
-        }
+    const char* name;
+    const char* value;
+    for (uint32_t i = 0 ; i < num_headers && http_get_header(response, i, &name, &value) ; ++i) {
+        server_log("Header %02lu. %s: %s", i + 1, name, value);
     }
 }
 
 
 /**
- * @brief Configure the System notification center.
+ * @brief Route system notifications to `handle_sys_notification()`.
  */
 static void setup_sys_notification_center(void) {
 
-    // Clear the notification store
-    memset((void*)sys_notification_center, 0x00, sizeof(sys_notification_center));
+    // System notifications share the app's notification center
+    MvNotificationHandle handle = notify_init();
+    notify_register(USER_TAG_SYSTEM_NOTIFICATION, 1, handle_sys_notification, NULL);
 
-    // Configure a notification center for system notifications
-    static struct MvNotificationSetup sys_notification_setup = {
-        .irq = TIM1_BRK_IRQn,
-        .buffer = sys_notification_center,
-        .buffer_size = sizeof(sys_notification_center)
-    };
-
-    // Ask Microvisor to establish the notification center
-    // and confirm that it has accepted the request
-    enum MvStatus status = mvSetupNotifications(&sys_notification_setup, &sys_nc_handle);
-    do_assert(status == MV_STATUS_OKAY, "Could not set up sys NC");
-    server_log("System notification center handle: %lu", (uint32_t)sys_nc_handle);
-
-    // Tell Microvisor to use the new notification center for system notifications
+    // Tell Microvisor to use the notification center for system notifications
     const struct MvOpenSystemNotificationParams sys_notification_params = {
-        .notification_handle = sys_nc_handle,
-        .notification_tag = 0,
+        .notification_handle = handle,
+        .notification_tag = USER_TAG_SYSTEM_NOTIFICATION,
         .notification_source = MV_SYSTEMNOTIFICATIONSOURCE_UPDATE
     };
 
-    status = mvOpenSystemNotification(&sys_notification_params, &sys_emitter_handle);
+    enum MvStatus status = mvOpenSystemNotification(&sys_notification_params, &sys_emitter_handle);
     do_assert(status == MV_STATUS_OKAY, "Could not enable system notifications");
+}
+
 
-    // Start the notification IRQ
-    NVIC_ClearPendingIRQ(TIM1_BRK_IRQn);
-    NVIC_EnableIRQ(TIM1_BRK_IRQn);
+/**
+ * @brief Act on a Microvisor system notification. Called on the HTTP
+ *        engine task, which dispatches notifications.
+ *
+ * FROM 3.2.0
+ * An update has been downloaded, so schedule its polite deployment.
+ *
+ * @param record:  The notification record.
+ * @param context: Not used.
+ */
+static void handle_sys_notification(const EventRecord* record, void* context) {
+
+    if (record->event_type != MV_EVENTTYPE_UPDATEDOWNLOADED || polite_timer != NULL) return;
+    server_log("Polite deployment notification issued");
+
+    // Set up a 30s timer to trigger the update
+    // NOTE In a real-world application, you would apply the update
+    //      see `do_polite_deploy()` as soon as any current critical task
+    //      completes. Here we just demo the process using a HAL timer.
+    polite_timer = osTimerNew(do_polite_deploy, osTimerOnce, NULL, NULL);
+    const uint32_t timer_delay_s = 30;
+    if (polite_timer != NULL && osTimerStart(polite_timer, timer_delay_s * 1000) == osOK) {
+        server_log("Update will install in %lu seconds", timer_delay_s);
+    }
 }
 
 
 /**
  * @brief A CMSIS/FreeRTOS timer callback function.
  *
- * This is called when the polite deployment timer (see `task_led()`) fires.
+ * This is called when the polite deployment timer, started by
+ * `handle_sys_notification()` once an update has downloaded, fires.
  * It tells Microvisor to apply the application update that has previously
  * been signalled as ready to be deployed.
  *
@@ -396,7 +457,8 @@ static void do_polite_deploy(void* arg) {
 /**
  * @brief A CMSIS/FreeRTOS timer callback function.
  *
- * This is called when the sys led timer (see `task_led()`) fires.
+ * This is called when the sys led timer, started by `task_led()` at boot,
+ * fires.
  * It tells Microvisor to disable the system LED
  *
  * @param arg: Pointer to and argument value passed by the timer controller.
@@ -408,33 +470,3 @@ static void do_clear_led(void* arg) {
     server_log("System LED disabled");
 }
 
-
-/**
- * @brief The System notification center interrupt handler.
- *
- * This is called by Microvisor -- we need to check for key events
- * such as polite deployment.
- */
-void TIM1_BRK_IRQHandler(void) {
-
-    // Check for a suitable event: readable data in the channel
-    bool got_notification = false;
-    struct MvNotification notification = sys_notification_center[current_notification_index];
-    if (notification.event_type == MV_EVENTTYPE_UPDATEDOWNLOADED) {
-        // Flag we need to access received data and to close the HTTP channel
-        // when we're back in the main loop. This lets us exit the ISR quickly.
-        // We should not make Microvisor System Calls in the ISR.
-        polite_deploy = true;
-        got_notification = true;
-    }
-
-    if (got_notification) {
-        // Point to the next record to be written
-        current_notification_index = (current_notification_index + 1) % HTTP_NT_BUFFER_SIZE_R;
-
-        // Clear the current notifications event
-        // See https://www.twilio.com/docs/iot/microvisor/microvisor-notifications#buffer-overruns
-        notification.event_type = 0;
-    }
-}
-
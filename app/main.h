@@ -31,7 +31,21 @@
 // App includes
 #include "logging.h"
 #include "uart_logging.h"
+#include "json.h"
+#include "cbor.h"
+#include "inflate.h"
+#include "digest.h"
+#include "event_ring.h"
+#include "timer_wheel.h"
+#include "http_headers.h"
+#include "http_template.h"
 #include "http.h"
+#include "notify.h"
+#include "http_cache.h"
+#include "telemetry.h"
+#include "flash_cache.h"
+#include "download.h"
+#include "todo.h"
 #include "network.h"
 #include "generic.h"
 
@@ -47,11 +61,30 @@
 #define     LED_PAUSE_MS                2000
 #define     LED_PULSE_MS                100
 
+#ifndef REQUEST_SEND_PERIOD_MS
 #define     REQUEST_SEND_PERIOD_MS      45000
+#endif
+// Thread flag the HTTP engine raises on the HTTP task each period
+#define     REQUEST_SEND_FLAG           0x0200
 #define     CHANNEL_KILL_PERIOD_MS      15000
 #define     SYS_LED_DISABLE_MS          58000
 
 #define     MAX_HEADERS_OUTPUT          16
 
+// Tags system notifications in the app's notification center
+#define     USER_TAG_SYSTEM_NOTIFICATION    0x10
+#define     TODO_CACHE_LEN              24
+
+// The first todos stand in for the reference resources a device
+// re-reads after every restart, so their responses are kept in flash
+#define     TODO_PERSIST_COUNT          3
+
+// The demo's telemetry reading: the uptime in seconds, taken at each LED flash
+#define     TELEMETRY_SENSOR_UPTIME     1
+
+// A resource too large for one response, fetched in slices at startup
+// and written to the download flash region
+#define     DOWNLOAD_DEMO_URL           "https://jsonplaceholder.typicode.com/comments"
+
 
 #endif      // _MAIN_H_
@@ -9,10 +9,23 @@
 #include "main.h"
 
 
+/*
+ * NOTE Microvisor keeps trying to reconnect a network that drops, but a
+ *      request that has gone quiet is released and made again, after
+ *      NET_RECONNECT_MS and then at doubling intervals up to
+ *      NET_RECONNECT_MAX_MS, without restarting the app. Tasks that need
+ *      the network wait with `net_wait_for_network()` while it's down, and
+ *      the HTTP engine holds queued requests until it returns.
+ */
+
+
 /*
  * STATIC PROTOTYPES
  */
 static void net_setup_notification_center(void);
+static void net_handle_notification(const EventRecord* record, void* context);
+static void net_request_network(void);
+static void net_rerequest(TimerEntry* timer, void* context);
 
 
 /*
@@ -25,80 +38,138 @@ static struct {
     MvNetworkHandle      network;
 } net_handles = { 0, 0 };
 
-// Central store for network management notification records.
-// Holds 'NET_NC_BUFFER_SIZE_R' records at a time -- each record is 16 bytes in size.
-static struct MvNotification net_notification_buffer[NET_NC_BUFFER_SIZE_R] __attribute__((aligned(8)));
+// Holds NET_FLAG_UP while the network is connected
+static osEventFlagsId_t net_events = NULL;
+
+// Link state, kept by the task that dispatches notifications. `down_tick`
+// is when the link dropped, valid only while `dropped` is set, and `retry`
+// runs until the network is next re-requested
+static struct {
+    bool        up;
+    bool        dropped;
+    uint32_t    down_tick;
+    uint32_t    backoff_ms;
+    TimerEntry  retry;
+} net_state = { false, false, 0, NET_RECONNECT_MS };
+
+// Outages and re-requests
+static NetStats net_stats = { 0 };
 
 
 /**
- * @brief Configure and connect to the network.
+ * @brief Ask Microvisor to connect to the network, without waiting for it.
+ *
+ * Microvisor connects asynchronously, and notifies the app each time the
+ * network's status changes. Tasks that need the network wait for it with
+ * `net_wait_for_network()`. Call after `osKernelInitialize()`.
  */
 void net_open_network(void) {
 
     // Configure the network's notification center
     net_setup_notification_center();
+    if (net_events == NULL) {
+        net_events = osEventFlagsNew(NULL);
+        timer_wheel_init_timer(&net_state.retry, net_rerequest, NULL);
+    }
 
     if (net_handles.network == 0) {
-        // Configure the network connection request
-        const struct MvRequestNetworkParams network_config = {
-            .version = 1,
-            .v1 = {
-                .notification_handle = net_handles.notification,
-                .notification_tag = USER_TAG_LOGGING_REQUEST_NETWORK,
-            }
-        };
-
-        // Ask Microvisor to establish the network connection
-        // and confirm that it has accepted the request
-        enum MvStatus status = mvRequestNetwork(&network_config, &net_handles.network);
-        do_assert(status == MV_STATUS_OKAY, "Could not open network");
-
-        // The network connection is established by Microvisor asynchronously,
-        // so we wait for it to come up before opening the data channel -- which
-        // would fail otherwise
-        enum MvNetworkStatus net_status;
-        while (1) {
-            // Request the status of the network connection, identified by its handle.
-            // If we're good to continue, break out of the loop...
-            if (mvGetNetworkStatus(net_handles.network, &net_status) == MV_STATUS_OKAY && net_status == MV_NETWORKSTATUS_CONNECTED) {
-                break;
-            }
+        net_request_network();
+        boot_mark(BOOT_STAGE_NETWORK_REQUESTED);
+    }
+}
 
-            // ... or wait a short period before retrying
-            for (size_t i = 0; i < 50000; ++i) {
-                // No op
-                __asm("nop");
-            }
+
+/**
+ * @brief Ask Microvisor for the network.
+ */
+static void net_request_network(void) {
+
+    // Configure the network connection request
+    const struct MvRequestNetworkParams network_config = {
+        .version = 1,
+        .v1 = {
+            .notification_handle = net_handles.notification,
+            .notification_tag = USER_TAG_LOGGING_REQUEST_NETWORK,
         }
-    }
+    };
+
+    // Ask Microvisor to establish the network connection
+    // and confirm that it has accepted the request
+    enum MvStatus status = mvRequestNetwork(&network_config, &net_handles.network);
+    do_assert(status == MV_STATUS_OKAY, "Could not open network");
+}
+
+
+/**
+ * @brief Re-request the network, which has been down too long, and
+ *        try again later if that doesn't bring it back. Called by the
+ *        HTTP engine's timers.
+ *
+ * @param timer:   The re-request timer.
+ * @param context: Not used.
+ */
+static void net_rerequest(TimerEntry* timer, void* context) {
+
+    // Release the network and ask for it again: Microvisor closes any
+    // channels still open on the old handle
+    server_log("Network down for %lu ms. Requesting it again", HAL_GetTick() - net_state.down_tick);
+    if (net_handles.network != 0) mvReleaseNetwork(&net_handles.network);
+    net_request_network();
+    net_stats.reconnects++;
+
+    net_state.backoff_ms *= 2;
+    if (net_state.backoff_ms > NET_RECONNECT_MAX_MS) net_state.backoff_ms = NET_RECONNECT_MAX_MS;
+    http_timer_start(timer, net_state.backoff_ms, 0);
 }
 
 
 /**
- * @brief Configure the network notification center.
+ * @brief Provide the network counters: how often it dropped,
+ *        how often it was re-requested, and for how long it was down.
+ *
+ * @returns The counters.
+ */
+const NetStats* net_get_stats(void) {
+
+    return &net_stats;
+}
+
+
+/**
+ * @brief Wait for the network to be connected.
+ *
+ * @param timeout_ms: The longest to wait, or `osWaitForever`.
+ *
+ * @returns `true` if the network is connected, `false` if it wasn't in time.
+ */
+bool net_wait_for_network(uint32_t timeout_ms) {
+
+    if (net_events == NULL) return false;
+    uint32_t flags = osEventFlagsWait(net_events, NET_FLAG_UP, osFlagsWaitAny | osFlagsNoClear, timeout_ms);
+    return (flags & osFlagsError) == 0;
+}
+
+
+/**
+ * @brief Whether the network is connected.
+ *
+ * @returns `true` if it is, otherwise `false`.
+ */
+bool net_is_up(void) {
+
+    return net_events != NULL && (osEventFlagsGet(net_events) & NET_FLAG_UP) != 0;
+}
+
+
+/**
+ * @brief Route network notifications to `net_handle_notification()`.
  */
 static void net_setup_notification_center(void) {
 
     if (net_handles.notification == 0) {
-        // Clear the notification store
-        memset((void*)net_notification_buffer, 0xff, sizeof(net_notification_buffer));
-
-        // Configure a notification center for network-centric notifications
-        const struct MvNotificationSetup net_notification_config = {
-            .irq = TIM2_IRQn,
-            .buffer = (struct MvNotification*)net_notification_buffer,
-            .buffer_size = sizeof(net_notification_buffer)
-        };
-
-        // Ask Microvisor to establish the notification center
-        // and confirm that it has accepted the request
-        enum MvStatus status = mvSetupNotifications(&net_notification_config, &net_handles.notification);
-        do_assert(status == MV_STATUS_OKAY, "Could not start network notification center");
-
-        // Start the notification IRQ
-        NVIC_ClearPendingIRQ(TIM2_IRQn);
-        NVIC_EnableIRQ(TIM2_IRQn);
-        server_log("Network notification center handle: %lu", (uint32_t)net_handles.notification);
+        // Network notifications share the app's notification center
+        net_handles.notification = notify_init();
+        notify_register(USER_TAG_LOGGING_REQUEST_NETWORK, 1, net_handle_notification, NULL);
     }
 }
 
@@ -115,11 +186,49 @@ MvNetworkHandle net_get_handle(void) {
 
 
 /**
- * @brief Network notification ISR.
+ * @brief Act on a network notification. Called on the task that
+ *        dispatches notifications.
+ *
+ * @param record:  The notification record.
+ * @param context: Not used.
  */
-void TIM2_IRQHandler(void) {
+static void net_handle_notification(const EventRecord* record, void* context) {
+
+    enum MvNetworkStatus net_status;
+    if (record->event_type != MV_EVENTTYPE_NETWORKSTATUSCHANGED || mvGetNetworkStatus(net_handles.network, &net_status) != MV_STATUS_OKAY) {
+        return;
+    }
 
-    // Network notifications interrupt service handler
-    // Add your own notification processing code here
+    // Release the tasks waiting for the network, or hold back new waiters
+    server_log("Network status: %lu", (uint32_t)net_status);
+    uint32_t tick = HAL_GetTick();
+    if (net_status == MV_NETWORKSTATUS_CONNECTED) {
+        if (!net_state.up) {
+            boot_mark(BOOT_STAGE_NETWORK_UP);
+            if (net_state.dropped) {
+                net_stats.down_ms += tick - net_state.down_tick;
+                server_log("Network back after %lu ms", tick - net_state.down_tick);
+            }
+
+            net_state.up = true;
+            net_state.dropped = false;
+            net_state.backoff_ms = NET_RECONNECT_MS;
+            http_timer_stop(&net_state.retry);
+        }
+
+        osEventFlagsSet(net_events, NET_FLAG_UP);
+    } else {
+        if (net_state.up) {
+            // Start the clock on re-requesting it
+            server_error("Network connection lost");
+            net_stats.drops++;
+            net_state.up = false;
+            net_state.dropped = true;
+            net_state.down_tick = tick;
+            http_timer_start(&net_state.retry, net_state.backoff_ms, 0);
+        }
+
+        osEventFlagsClear(net_events, NET_FLAG_UP);
+    }
 }
 
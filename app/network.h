@@ -13,7 +13,13 @@
 /*
  * CONSTANTS
  */
-#define     NET_NC_BUFFER_SIZE_R                8
+// Event flag held while the network is connected
+#define     NET_FLAG_UP                 0x01
+
+// How long a dropped network is left to come back before it's
+// re-requested, and the longest interval between re-requests
+#define     NET_RECONNECT_MS            5000
+#define     NET_RECONNECT_MAX_MS        60000
 
 
 #ifdef __cplusplus
@@ -21,11 +27,24 @@ extern "C" {
 #endif
 
 
+/*
+ * TYPES
+ */
+typedef struct {
+    uint32_t    drops;
+    uint32_t    reconnects;
+    uint32_t    down_ms;
+} NetStats;
+
+
 /*
  * PROTOTYPES
  */
 void            net_open_network(void);
 MvNetworkHandle net_get_handle(void);
+bool            net_wait_for_network(uint32_t timeout_ms);
+bool            net_is_up(void);
+const NetStats* net_get_stats(void);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,202 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * NOTE Every Microvisor notification source -- the network, the HTTP
+ *      channels and system events -- writes to the one notification
+ *      center here, and raises the one IRQ. The ISR moves the records
+ *      into the event ring and wakes the dispatching task, which hands
+ *      each to the handler registered for its tag, a batch at a time.
+ *      So there is one buffer to size, one interrupt entry per burst
+ *      whichever sources it comes from, and one place to count them.
+ */
+
+
+/*
+ * GLOBALS
+ */
+static MvNotificationHandle notify_handle = 0;
+
+// Central store for notification records.
+// Holds NOTIFY_CENTER_SIZE_R records at a time -- each record is 16 bytes in size.
+static struct MvNotification notify_center[NOTIFY_CENTER_SIZE_R] __attribute__((aligned(8)));
+// Modified in ISR
+static uint32_t current_notification_index = 0;
+
+// Records the ISR has taken from the notification center, waiting for the dispatcher
+static EventRecord notify_records[NOTIFY_RING_SIZE];
+static EventRing   notify_events;
+_Static_assert(NOTIFY_RING_SIZE >= NOTIFY_CENTER_SIZE_R, "The event ring must hold a full notification center");
+
+// Handlers by tag, and records no handler took
+static NotifyRoute notify_routes[NOTIFY_MAX_ROUTES];
+static uint32_t    notify_route_count = 0;
+static uint32_t    notify_unrouted = 0;
+
+// The task the ISR wakes, and the thread flag it raises
+static osThreadId_t volatile notify_thread = NULL;
+static volatile uint32_t     notify_flag = 0;
+
+
+/**
+ * @brief Set up the notification center, once. Safe to call before the
+ *        scheduler starts.
+ *
+ * @returns The center's handle, for notification sources to write to.
+ */
+MvNotificationHandle notify_init(void) {
+
+    if (notify_handle == 0) {
+        // Clear the notification store, and empty the ring the ISR fills from it
+        memset((void*)notify_center, 0x00, sizeof(notify_center));
+        event_ring_init(&notify_events, notify_records, NOTIFY_RING_SIZE);
+
+        // Configure a notification center for all notifications
+        const struct MvNotificationSetup notify_setup = {
+            .irq = TIM8_BRK_IRQn,
+            .buffer = (struct MvNotification*)notify_center,
+            .buffer_size = sizeof(notify_center)
+        };
+
+        // Ask Microvisor to establish the notification center
+        // and confirm that it has accepted the request
+        enum MvStatus status = mvSetupNotifications(&notify_setup, &notify_handle);
+        do_assert(status == MV_STATUS_OKAY, "Could not set up notification center");
+
+        // Start the notification IRQ
+        NVIC_ClearPendingIRQ(TIM8_BRK_IRQn);
+        NVIC_EnableIRQ(TIM8_BRK_IRQn);
+        server_log("Notification center handle: %lu", (uint32_t)notify_handle);
+    }
+
+    return notify_handle;
+}
+
+
+/**
+ * @brief Route a range of notification tags to a handler. Register
+ *        before the source's first record can arrive.
+ *
+ * @param first_tag: The first tag handled.
+ * @param tag_count: The number of consecutive tags handled.
+ * @param handler:   Called on the dispatching task with each record.
+ * @param context:   Passed to the handler.
+ *
+ * @returns `true` if the route was added, `false` if there's no room.
+ */
+bool notify_register(uint32_t first_tag, uint32_t tag_count, NotifyHandler handler, void* context) {
+
+    if (notify_route_count >= NOTIFY_MAX_ROUTES) {
+        server_error("No room to route notification tags from %lu", first_tag);
+        return false;
+    }
+
+    notify_routes[notify_route_count++] = (NotifyRoute){ first_tag, tag_count, handler, context, 0 };
+    return true;
+}
+
+
+/**
+ * @brief Name the task that dispatches notifications. It is sent
+ *        `flag` when records arrive, and should then call `notify_dispatch()`.
+ *
+ * @param thread: The dispatching task.
+ * @param flag:   The thread flag to send it.
+ */
+void notify_set_dispatcher(osThreadId_t thread, uint32_t flag) {
+
+    notify_flag = flag;
+    notify_thread = thread;
+
+    // Records that came in before there was a dispatcher
+    if (event_ring_count(&notify_events) > 0) osThreadFlagsSet(thread, flag);
+}
+
+
+/**
+ * @brief Hand every queued record to its handler, a batch at a time.
+ *        Called on the dispatching task.
+ */
+void notify_dispatch(void) {
+
+    EventRecord records[NOTIFY_BATCH_R];
+    uint32_t count;
+    while ((count = event_ring_pop(&notify_events, records, NOTIFY_BATCH_R)) > 0) {
+        for (uint32_t i = 0 ; i < count ; ++i) {
+            NotifyRoute* route = NULL;
+            for (uint32_t j = 0 ; j < notify_route_count ; ++j) {
+                if (records[i].tag - notify_routes[j].first_tag < notify_routes[j].tag_count) {
+                    route = &notify_routes[j];
+                    break;
+                }
+            }
+
+            if (route == NULL) {
+                notify_unrouted++;
+                continue;
+            }
+
+            route->records++;
+            route->handler(&records[i], route->context);
+        }
+    }
+}
+
+
+/**
+ * @brief The number of records dispatched for a tag's route.
+ *
+ * @param tag: Any tag in the route.
+ *
+ * @returns The count, or the number of records no route took
+ *          if the tag has no route.
+ */
+uint32_t notify_get_records(uint32_t tag) {
+
+    for (uint32_t i = 0 ; i < notify_route_count ; ++i) {
+        if (tag - notify_routes[i].first_tag < notify_routes[i].tag_count) return notify_routes[i].records;
+    }
+
+    return notify_unrouted;
+}
+
+
+/**
+ * @brief Provide the notification counters: how many records came in,
+ *        how many the dispatcher was slow to take, and how close the
+ *        notification center came to being overrun.
+ *
+ * @returns The counters, which the ISR updates.
+ */
+const EventRingStats* notify_get_stats(void) {
+
+    return &notify_events.stats;
+}
+
+
+/**
+ * @brief The notification center interrupt handler.
+ *
+ * This is called by Microvisor. More than one record may have been
+ * written by the time the handler runs, so it moves every unhandled
+ * record into the event ring, clearing each, and wakes the dispatching
+ * task. We should not make Microvisor System Calls in the ISR.
+ */
+void TIM8_BRK_IRQHandler(void) {
+
+    // Thread flags latch, so records queued while the task is busy
+    // are picked up by its next wait rather than being lost
+    osThreadId_t thread = notify_thread;
+    if (event_ring_drain(&notify_events, notify_center, NOTIFY_CENTER_SIZE_R, &current_notification_index) > 0
+        && thread != NULL) {
+        osThreadFlagsSet(thread, notify_flag);
+    }
+}
@@ -0,0 +1,71 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _NOTIFY_H_
+#define _NOTIFY_H_
+
+
+/*
+ * CONSTANTS
+ */
+// One notification center for every source. Microvisor may write two
+// records per HTTP channel -- readable, then closed -- plus network and
+// system records before the ISR runs
+#define     NOTIFY_CENTER_SIZE_R        (HTTP_CHANNEL_POOL_SIZE * 2 + 4)
+
+// Records the ISR can queue for the dispatcher: the power of two no
+// smaller than the center, so a full center can't overrun it
+#define     NOTIFY_RING_SIZE            (NOTIFY_CENTER_SIZE_R <= 16 ? 16 : \
+                                         NOTIFY_CENTER_SIZE_R <= 32 ? 32 : \
+                                         NOTIFY_CENTER_SIZE_R <= 64 ? 64 : \
+                                         NOTIFY_CENTER_SIZE_R <= 128 ? 128 : 256)
+
+// Records dispatched per batch, and the most handlers
+#define     NOTIFY_BATCH_R              8
+#define     NOTIFY_MAX_ROUTES           4
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+// Called on the dispatching task, so it may make system calls
+typedef void (*NotifyHandler)(const EventRecord* record, void* context);
+
+// Where records with tags from `first_tag` to `first_tag + tag_count - 1`
+// go, and how many have
+typedef struct {
+    uint32_t        first_tag;
+    uint32_t        tag_count;
+    NotifyHandler   handler;
+    void*           context;
+    uint32_t        records;
+} NotifyRoute;
+
+
+/*
+ * PROTOTYPES
+ */
+MvNotificationHandle    notify_init(void);
+bool                    notify_register(uint32_t first_tag, uint32_t tag_count, NotifyHandler handler, void* context);
+void                    notify_set_dispatcher(osThreadId_t thread, uint32_t flag);
+void                    notify_dispatch(void);
+uint32_t                notify_get_records(uint32_t tag);
+const EventRingStats*   notify_get_stats(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _NOTIFY_H_
@@ -0,0 +1,352 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     TELEMETRY_BODY_PREFIX       "{\"readings\":["
+#define     TELEMETRY_BODY_KEY          "readings"
+
+// Queued records' bytes that will fill a batch's body, leaving room for
+// the body's framing. JSON's, its prefix and closing `]}`, is the larger
+#define     TELEMETRY_BATCH_SIZE_B      (TELEMETRY_BODY_SIZE_B - sizeof(TELEMETRY_BODY_PREFIX))
+
+// A full batch must pass the engine's check against the send buffer
+_Static_assert(TELEMETRY_REQUEST_OVERHEAD_B < HTTP_TX_BUFFER_SIZE_B
+               && TELEMETRY_REQUEST_OVERHEAD_B + TELEMETRY_BODY_SIZE_B <= HTTP_TX_BUFFER_SIZE_B,
+               "A full telemetry batch doesn't fit the channel's send buffer");
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static TelemetryRecord* telemetry_oldest(void);
+static bool             telemetry_batch_full(void);
+static bool             telemetry_take_batch(void);
+static uint32_t         telemetry_record_length(uint32_t tick, uint16_t sensor, int32_t value);
+static uint32_t         telemetry_encode_json(const TelemetryRecord* record, char* buffer);
+static uint32_t         telemetry_digits(uint32_t value);
+static void             telemetry_sent(const HttpResponse* response, void* context);
+
+
+/*
+ * GLOBALS
+ */
+// The record ring. Producers on any task or ISR claim the slot at `head`
+// by advancing it; the HTTP engine, the only consumer, takes records from
+// `tail`. A slot's sequence is its position when free for a producer, one
+// more once filled, and its position plus the ring's length once taken
+static TelemetryRecord  telemetry_ring[TELEMETRY_RING_LEN];
+static uint32_t         telemetry_head = 0;
+static uint32_t         telemetry_tail = 0;
+
+// Encoded size of the records filled but not yet taken
+static uint32_t         telemetry_pending_bytes = 0;
+
+// Indexed by `TELEMETRY_USE_CBOR`
+static const struct MvHttpHeader telemetry_content_types[] = {
+    HTTP_HEADER(TELEMETRY_TYPE_JSON),
+    HTTP_HEADER(TELEMETRY_TYPE_CBOR)
+};
+
+// The batch being posted. Only used by the HTTP engine task. The body
+// stays put until the request completes, so at most one is in flight
+static uint8_t          telemetry_body[TELEMETRY_BODY_SIZE_B];
+static uint32_t         telemetry_body_length = 0;
+static uint32_t         telemetry_batch_records = 0;
+static TelemetryFlushReason telemetry_batch_reason = TELEMETRY_FLUSH_SIZE;
+static bool             telemetry_in_flight = false;
+
+// Wakes the HTTP engine when the oldest record is due
+static TimerEntry       telemetry_deadline;
+
+static TelemetryStats   telemetry_stats = { 0 };
+
+
+/**
+ * @brief Prepare the record ring. Call before the scheduler starts.
+ */
+void telemetry_init(void) {
+
+    for (uint32_t i = 0 ; i < TELEMETRY_RING_LEN ; ++i) telemetry_ring[i].sequence = i;
+    timer_wheel_init_timer(&telemetry_deadline, NULL, NULL);
+}
+
+
+/**
+ * @brief Queue a reading for upload in the next batch.
+ *
+ * Lock-free and non-blocking, so it may be called from any task or ISR.
+ * The HTTP engine is woken only when the reading is the first awaiting
+ * upload, so its deadline is set, or fills a batch or the ring.
+ *
+ * @param sensor: The reading's source.
+ * @param value:  The reading.
+ *
+ * @returns `true` if the reading was queued, or `false` if the ring is full.
+ */
+bool telemetry_record(uint16_t sensor, int32_t value) {
+
+    TelemetryRecord* record;
+    uint32_t position = __atomic_load_n(&telemetry_head, __ATOMIC_RELAXED);
+    while (1) {
+        record = &telemetry_ring[position & (TELEMETRY_RING_LEN - 1)];
+        int32_t lag = (int32_t)(__atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE) - position);
+        if (lag == 0) {
+            // The slot is free: claim it, unless another producer got there first
+            if (__atomic_compare_exchange_n(&telemetry_head, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (lag < 0) {
+            // The engine hasn't taken the record a lap ago
+            __atomic_fetch_add(&telemetry_stats.records_dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        } else {
+            position = __atomic_load_n(&telemetry_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    record->tick = HAL_GetTick();
+    record->sensor = sensor;
+    record->value = value;
+
+    // Count the record's bytes before publishing it, so the engine
+    // never takes away more than has been added
+    uint32_t length = telemetry_record_length(record->tick, sensor, value);
+    uint32_t pending = __atomic_add_fetch(&telemetry_pending_bytes, length, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&record->sequence, position + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&telemetry_stats.records_queued, 1, __ATOMIC_RELAXED);
+
+    // Compact records may fill the ring before they fill a batch
+    bool ring_full = position + 1 - __atomic_load_n(&telemetry_tail, __ATOMIC_ACQUIRE) == TELEMETRY_RING_LEN;
+    if (pending == length || ring_full || (pending >= TELEMETRY_BATCH_SIZE_B && pending - length < TELEMETRY_BATCH_SIZE_B)) {
+        http_wake_engine();
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Post a batch if one is full or its oldest record is due.
+ *        Called on the HTTP engine task.
+ *
+ * @param tick: The current tick.
+ */
+void telemetry_service(uint32_t tick) {
+
+    if (telemetry_in_flight) return;
+
+    if (telemetry_batch_records == 0) {
+        TelemetryRecord* oldest = telemetry_oldest();
+        if (telemetry_batch_full()) {
+            telemetry_batch_reason = TELEMETRY_FLUSH_SIZE;
+        } else if (oldest != NULL && tick - oldest->tick >= TELEMETRY_MAX_LATENCY_MS) {
+            telemetry_batch_reason = TELEMETRY_FLUSH_DEADLINE;
+        } else {
+            // Come back when the oldest record is due
+            if (oldest != NULL) http_timer_start(&telemetry_deadline, TELEMETRY_MAX_LATENCY_MS - (tick - oldest->tick), 0);
+            return;
+        }
+
+        if (!telemetry_take_batch()) return;
+    }
+
+    // A batch that can't be queued is kept and tried again when the engine
+    // next wakes, which it will once a channel completes
+    uint32_t request_id = http_submit(TELEMETRY_METHOD, TELEMETRY_URL, &telemetry_content_types[TELEMETRY_USE_CBOR ? 1 : 0], 1,
+                                      telemetry_body, telemetry_body_length,
+                                      telemetry_sent, (void*)(uintptr_t)telemetry_batch_records);
+    if (request_id != 0) {
+        telemetry_in_flight = true;
+        telemetry_stats.flushes[telemetry_batch_reason]++;
+    }
+}
+
+
+/**
+ * @brief Get the telemetry counters.
+ *
+ * @returns The counters.
+ */
+const TelemetryStats* telemetry_get_stats(void) {
+
+    return &telemetry_stats;
+}
+
+
+/**
+ * @brief Find the oldest record awaiting upload.
+ *
+ * @returns The record, or `NULL` if there is none.
+ */
+static TelemetryRecord* telemetry_oldest(void) {
+
+    TelemetryRecord* record = &telemetry_ring[telemetry_tail & (TELEMETRY_RING_LEN - 1)];
+    return __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE) == telemetry_tail + 1 ? record : NULL;
+}
+
+
+/**
+ * @brief Check whether the queued records fill a batch's body, or the ring.
+ */
+static bool telemetry_batch_full(void) {
+
+    return __atomic_load_n(&telemetry_pending_bytes, __ATOMIC_ACQUIRE) >= TELEMETRY_BATCH_SIZE_B
+        || __atomic_load_n(&telemetry_head, __ATOMIC_ACQUIRE) - telemetry_tail >= TELEMETRY_RING_LEN;
+}
+
+
+/**
+ * @brief Move as many records as fit from the ring into a batch body.
+ *
+ * The body is encoded in place, as CBOR or JSON, ready to send.
+ *
+ * @returns `true` if the batch holds any records, otherwise `false`.
+ */
+static bool telemetry_take_batch(void) {
+
+    CborWriter writer;
+    cbor_writer_init(&writer, telemetry_body, sizeof(telemetry_body));
+    if (TELEMETRY_USE_CBOR) {
+        // The records go in an indefinite-length array, as they aren't counted yet
+        cbor_put_map(&writer, 1);
+        cbor_put_text(&writer, TELEMETRY_BODY_KEY, sizeof(TELEMETRY_BODY_KEY) - 1);
+        cbor_begin_array(&writer);
+        telemetry_body_length = writer.length;
+    } else {
+        memcpy(telemetry_body, TELEMETRY_BODY_PREFIX, sizeof(TELEMETRY_BODY_PREFIX) - 1);
+        telemetry_body_length = sizeof(TELEMETRY_BODY_PREFIX) - 1;
+    }
+
+    TelemetryRecord* record;
+    while ((record = telemetry_oldest()) != NULL) {
+        // Leave room for the last byte: CBOR's break, or JSON's
+        // closing `}` after the final comma is replaced by `]`
+        uint32_t length = telemetry_record_length(record->tick, record->sensor, record->value);
+        if (telemetry_body_length + length + 1 > TELEMETRY_BODY_SIZE_B) break;
+
+        if (TELEMETRY_USE_CBOR) {
+            cbor_put_array(&writer, 3);
+            cbor_put_uint(&writer, record->tick);
+            cbor_put_uint(&writer, record->sensor);
+            cbor_put_int(&writer, record->value);
+            telemetry_body_length = writer.length;
+        } else {
+            telemetry_body_length += telemetry_encode_json(record, (char*)&telemetry_body[telemetry_body_length]);
+        }
+
+        telemetry_batch_records++;
+        __atomic_store_n(&record->sequence, telemetry_tail + TELEMETRY_RING_LEN, __ATOMIC_RELEASE);
+        __atomic_store_n(&telemetry_tail, telemetry_tail + 1, __ATOMIC_RELEASE);
+        __atomic_sub_fetch(&telemetry_pending_bytes, length, __ATOMIC_ACQ_REL);
+    }
+
+    if (telemetry_batch_records == 0) return false;
+
+    if (TELEMETRY_USE_CBOR) {
+        telemetry_body[telemetry_body_length++] = 0xFF;
+    } else {
+        telemetry_body[telemetry_body_length - 1] = ']';
+        telemetry_body[telemetry_body_length++] = '}';
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Calculate the size of a record in a batch body: a three-item
+ *        CBOR array, or `[tick,sensor,value],` in JSON.
+ *
+ * @returns The size in bytes.
+ */
+static uint32_t telemetry_record_length(uint32_t tick, uint16_t sensor, int32_t value) {
+
+    if (TELEMETRY_USE_CBOR) {
+        // A negative value is encoded as its ones' complement
+        return 1 + cbor_head_size(tick) + cbor_head_size(sensor) + cbor_head_size(value < 0 ? ~(uint32_t)value : (uint32_t)value);
+    }
+
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    return 5 + telemetry_digits(tick) + telemetry_digits(sensor) + telemetry_digits(magnitude) + (value < 0 ? 1 : 0);
+}
+
+
+/**
+ * @brief Write a record into a JSON batch body, with its trailing comma.
+ *
+ * @param record: The record.
+ * @param buffer: Receives the text.
+ *
+ * @returns The number of bytes written.
+ */
+static uint32_t telemetry_encode_json(const TelemetryRecord* record, char* buffer) {
+
+    char* cursor = buffer;
+    *cursor++ = '[';
+    cursor += http_u32_to_dec(record->tick, cursor);
+    *cursor++ = ',';
+    cursor += http_u32_to_dec(record->sensor, cursor);
+    *cursor++ = ',';
+    if (record->value < 0) *cursor++ = '-';
+    cursor += http_u32_to_dec(record->value < 0 ? 0u - (uint32_t)record->value : (uint32_t)record->value, cursor);
+    *cursor++ = ']';
+    *cursor++ = ',';
+    return (uint32_t)(cursor - buffer);
+}
+
+
+/**
+ * @brief Count a number's decimal digits.
+ */
+static uint32_t telemetry_digits(uint32_t value) {
+
+    uint32_t digits = 1;
+    while (value >= 10) {
+        value /= 10;
+        digits++;
+    }
+
+    return digits;
+}
+
+
+/**
+ * @brief Account for a posted batch. Called on the HTTP engine task.
+ *
+ * @param response: The request's outcome.
+ * @param context:  The number of records in the batch.
+ */
+static void telemetry_sent(const HttpResponse* response, void* context) {
+
+    uint32_t records = (uint32_t)(uintptr_t)context;
+    bool posted = response->status == MV_STATUS_OKAY && response->result == MV_HTTPRESULT_OK
+                  && response->status_code >= 200 && response->status_code < 300;
+    if (posted) {
+        telemetry_stats.requests++;
+        telemetry_stats.records_sent += records;
+        if (records > telemetry_stats.max_records_per_request) telemetry_stats.max_records_per_request = records;
+    } else {
+        // The readings are dropped rather than held up behind a failing server
+        telemetry_stats.requests_failed++;
+        telemetry_stats.records_failed += records;
+    }
+
+    const TelemetryStats* stats = &telemetry_stats;
+    server_log("Telemetry batch of %lu readings (%lu bytes) %s. Sent: %lu in %lu requests, max %lu. Flushes size/deadline: %lu/%lu. Failed: %lu, dropped: %lu",
+               records, telemetry_body_length, posted ? "posted" : "failed",
+               stats->records_sent, stats->requests, stats->max_records_per_request,
+               stats->flushes[TELEMETRY_FLUSH_SIZE], stats->flushes[TELEMETRY_FLUSH_DEADLINE],
+               stats->records_failed, stats->records_dropped);
+
+    telemetry_in_flight = false;
+    telemetry_batch_records = 0;
+    telemetry_body_length = 0;
+}
@@ -0,0 +1,87 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Records awaiting upload. Must be a power of two
+#define     TELEMETRY_RING_LEN          64
+
+// Batches are posted here as `{"readings":[[tick,sensor,value],...]}`,
+// encoded as CBOR, or as JSON if this is false
+#define     TELEMETRY_METHOD            "POST"
+#define     TELEMETRY_URL               "https://jsonplaceholder.typicode.com/posts"
+#define     TELEMETRY_USE_CBOR          true
+#define     TELEMETRY_TYPE_JSON         "Content-Type: application/json"
+#define     TELEMETRY_TYPE_CBOR         "Content-Type: application/cbor"
+
+// A batch's body fills the channel's send buffer, less room for the
+// method, URL and Content-Type header -- the engine adds none to a
+// POST. It is sent once this full, or once its oldest record is this old
+#define     TELEMETRY_TYPE_SIZE_B       (sizeof(TELEMETRY_TYPE_JSON) > sizeof(TELEMETRY_TYPE_CBOR) ? sizeof(TELEMETRY_TYPE_JSON) - 1 : sizeof(TELEMETRY_TYPE_CBOR) - 1)
+#define     TELEMETRY_REQUEST_OVERHEAD_B    (sizeof(TELEMETRY_METHOD) - 1 + sizeof(TELEMETRY_URL) - 1 + TELEMETRY_TYPE_SIZE_B + HTTP_HEADER_OVERHEAD_B)
+#define     TELEMETRY_BODY_SIZE_B       (HTTP_TX_BUFFER_SIZE_B - TELEMETRY_REQUEST_OVERHEAD_B)
+#ifndef TELEMETRY_MAX_LATENCY_MS
+#define     TELEMETRY_MAX_LATENCY_MS    30000
+#endif
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+typedef enum {
+    TELEMETRY_FLUSH_SIZE = 0,
+    TELEMETRY_FLUSH_DEADLINE,
+    TELEMETRY_FLUSH_REASONS
+} TelemetryFlushReason;
+
+// A slot in the record ring. `sequence` tells producers and the
+// engine whose turn it is to use the slot
+typedef struct {
+    volatile uint32_t   sequence;
+    uint32_t            tick;
+    int32_t             value;
+    uint16_t            sensor;
+} TelemetryRecord;
+
+typedef struct {
+    uint32_t    records_queued;
+    uint32_t    records_dropped;
+    uint32_t    records_sent;
+    uint32_t    records_failed;
+    uint32_t    requests;
+    uint32_t    requests_failed;
+    uint32_t    max_records_per_request;
+    uint32_t    flushes[TELEMETRY_FLUSH_REASONS];
+} TelemetryStats;
+
+
+/*
+ * PROTOTYPES
+ */
+void                    telemetry_init(void);
+bool                    telemetry_record(uint16_t sensor, int32_t value);
+void                    telemetry_service(uint32_t tick);
+const TelemetryStats*   telemetry_get_stats(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _TELEMETRY_H_
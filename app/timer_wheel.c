@@ -0,0 +1,374 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "timer_wheel.h"
+
+
+/*
+ * NOTE A hierarchical timer wheel: each timer hangs on a doubly linked
+ *      list in one slot of one level, so starting and stopping a timer
+ *      are constant time however many are running. Level 0 has a slot per
+ *      tick; a slot of each level above covers a whole turn of the level
+ *      below. A timer is filed by the highest six bits in which its expiry
+ *      differs from the current tick, so every timer in a level falls
+ *      within the current slot of the level above, and after the level's
+ *      current slot.
+ *
+ *      So the next tick at which anything happens is the first occupied
+ *      slot of the lowest level that has any, found from that level's
+ *      bitmap without looking at the timers: in level 0 it's an expiry,
+ *      in the levels above, the start of a slot whose timers must then be
+ *      filed again in a lower level -- cascaded -- before any can be due.
+ *      A timer cascades at most once per level, and advancing visits only
+ *      the ticks at which something happens, however long the task slept.
+ *
+ *      Ticks are 64-bit milliseconds, so expiries never wrap.
+ */
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     timer_wheel_link(TimerWheel* wheel, TimerEntry* timer);
+static void     timer_wheel_unlink(TimerWheel* wheel, TimerEntry* timer);
+static void     timer_wheel_file(TimerWheel* wheel, TimerEntry* timer);
+static void     timer_wheel_cascade(TimerWheel* wheel, TimerLink* list);
+static void     timer_wheel_append(TimerLink* list, TimerLink* link);
+static void     timer_wheel_remove(TimerLink* link);
+static uint32_t timer_wheel_slot(uint64_t tick, uint32_t level);
+
+
+/**
+ * @brief Set up an empty wheel.
+ *
+ * @param wheel: The wheel.
+ * @param now:   The current tick.
+ */
+void timer_wheel_init(TimerWheel* wheel, uint64_t now) {
+
+    for (uint32_t level = 0 ; level < TIMER_WHEEL_LEVELS ; ++level) {
+        for (uint32_t i = 0 ; i < TIMER_WHEEL_SLOTS ; ++i) {
+            wheel->slots[level][i].next = &wheel->slots[level][i];
+            wheel->slots[level][i].prev = &wheel->slots[level][i];
+        }
+
+        wheel->occupied[level] = 0;
+    }
+
+    wheel->overflow.next = &wheel->overflow;
+    wheel->overflow.prev = &wheel->overflow;
+    wheel->now = now;
+    wheel->running = 0;
+    wheel->stats = (TimerWheelStats){ 0 };
+}
+
+
+/**
+ * @brief Set up a stopped timer.
+ *
+ * @param timer:    The timer.
+ * @param callback: Called when it expires.
+ * @param context:  Passed to the callback.
+ */
+void timer_wheel_init_timer(TimerEntry* timer, TimerCallback callback, void* context) {
+
+    timer->link.next = NULL;
+    timer->link.prev = NULL;
+    timer->expiry = 0;
+    timer->period = 0;
+    timer->running = false;
+    timer->level = 0;
+    timer->slot = 0;
+    timer->callback = callback;
+    timer->context = context;
+}
+
+
+/**
+ * @brief Start a timer, or restart it if it's running.
+ *
+ * @param wheel:  The wheel.
+ * @param timer:  The timer.
+ * @param delay:  Ticks from the wheel's current tick until it expires.
+ *                Timers due at once expire on the next tick.
+ * @param period: Ticks between later expiries, or 0 to expire once.
+ */
+void timer_wheel_start(TimerWheel* wheel, TimerEntry* timer, uint32_t delay, uint32_t period) {
+
+    if (timer->running) timer_wheel_unlink(wheel, timer);
+
+    timer->expiry = wheel->now + (delay > 0 ? delay : 1);
+    timer->period = period;
+    timer_wheel_link(wheel, timer);
+    wheel->stats.started++;
+}
+
+
+/**
+ * @brief Stop a timer. Harmless if it isn't running.
+ *
+ * @param wheel: The wheel.
+ * @param timer: The timer.
+ */
+void timer_wheel_stop(TimerWheel* wheel, TimerEntry* timer) {
+
+    if (!timer->running) return;
+
+    timer_wheel_unlink(wheel, timer);
+    wheel->stats.stopped++;
+}
+
+
+/**
+ * @brief Move the wheel on to `now`, calling back each timer that has
+ *        expired, earliest first. Periodic timers are started again for
+ *        their next expiry after `now`, skipping any they missed.
+ *
+ * @param wheel: The wheel.
+ * @param now:   The current tick. Earlier ticks are ignored.
+ *
+ * @returns The number of timers that expired.
+ */
+uint32_t timer_wheel_advance(TimerWheel* wheel, uint64_t now) {
+
+    if (now <= wheel->now) return 0;
+
+    // Step from each tick at which something happens to the next, moving
+    // expired timers to a list of their own, so that the callbacks, made
+    // once the wheel has reached `now`, can start and stop any timer
+    TimerLink due = { &due, &due };
+    for (uint64_t tick = timer_wheel_next_expiry(wheel) ; tick <= now ; tick = timer_wheel_next_expiry(wheel)) {
+        wheel->now = tick;
+
+        // Cascade the highest levels first: their timers may drop into
+        // slots of the levels below that this tick starts
+        const uint32_t top_shift = TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS;
+        if ((tick & ((1ULL << top_shift) - 1)) == 0) timer_wheel_cascade(wheel, &wheel->overflow);
+        for (uint32_t level = TIMER_WHEEL_LEVELS - 1 ; level > 0 ; --level) {
+            if ((tick & ((1ULL << (level * TIMER_WHEEL_SLOT_BITS)) - 1)) != 0) continue;
+
+            uint32_t index = timer_wheel_slot(tick, level);
+            if ((wheel->occupied[level] & (1ULL << index)) == 0) continue;
+
+            wheel->occupied[level] &= ~(1ULL << index);
+            timer_wheel_cascade(wheel, &wheel->slots[level][index]);
+        }
+
+        // Every timer in level 0's slot for this tick expires now
+        uint32_t index = timer_wheel_slot(tick, 0);
+        TimerLink* slot = &wheel->slots[0][index];
+        wheel->occupied[0] &= ~(1ULL << index);
+        while (slot->next != slot) {
+            TimerEntry* timer = (TimerEntry*)slot->next;
+            timer_wheel_remove(&timer->link);
+            timer_wheel_append(&due, &timer->link);
+            timer->level = TIMER_WHEEL_DUE;
+        }
+    }
+
+    wheel->now = now;
+
+    uint32_t count = 0;
+    while (due.next != &due) {
+        TimerEntry* timer = (TimerEntry*)due.next;
+        timer_wheel_unlink(wheel, timer);
+        if (timer->period > 0) {
+            uint64_t missed = (now - timer->expiry) / timer->period;
+            timer->expiry += (missed + 1) * timer->period;
+            timer_wheel_link(wheel, timer);
+        }
+
+        wheel->stats.expired++;
+        count++;
+        if (timer->callback != NULL) timer->callback(timer, timer->context);
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief Get the tick to which the wheel must next be advanced: when the
+ *        next timer expires, or sooner, if timers must first be moved
+ *        down a level. Found from the occupied-slot bitmaps alone.
+ *
+ * @param wheel: The wheel.
+ *
+ * @returns The tick, or TIMER_WHEEL_NONE if no timer is running.
+ */
+uint64_t timer_wheel_next_expiry(const TimerWheel* wheel) {
+
+    // A level's occupied slots all come after its current one, and the
+    // timers in any level come before those in the levels above
+    for (uint32_t level = 0 ; level < TIMER_WHEEL_LEVELS ; ++level) {
+        if (wheel->occupied[level] == 0) continue;
+
+        uint32_t shift = level * TIMER_WHEEL_SLOT_BITS;
+        uint64_t turn = wheel->now >> (shift + TIMER_WHEEL_SLOT_BITS) << (shift + TIMER_WHEEL_SLOT_BITS);
+        return turn | ((uint64_t)__builtin_ctzll(wheel->occupied[level]) << shift);
+    }
+
+    // Overflowed timers are due after the top level's current turn
+    if (wheel->overflow.next != &wheel->overflow) {
+        uint32_t shift = TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS;
+        return ((wheel->now >> shift) + 1) << shift;
+    }
+
+    return TIMER_WHEEL_NONE;
+}
+
+
+/**
+ * @brief Calculate how long a task can sleep before the wheel must be
+ *        advanced.
+ *
+ * @param wheel: The wheel.
+ * @param now:   The current tick.
+ *
+ * @returns The ticks to wait, or UINT32_MAX -- `osWaitForever` -- if no
+ *          timer is running.
+ */
+uint32_t timer_wheel_wait_time(const TimerWheel* wheel, uint64_t now) {
+
+    uint64_t next = timer_wheel_next_expiry(wheel);
+    if (next == TIMER_WHEEL_NONE) return UINT32_MAX;
+    if (next <= now) return 0;
+    return next - now < UINT32_MAX ? (uint32_t)(next - now) : UINT32_MAX - 1;
+}
+
+
+/**
+ * @brief File a stopped timer, with its expiry set, and count it running.
+ *
+ * @param wheel: The wheel.
+ * @param timer: The timer.
+ */
+static void timer_wheel_link(TimerWheel* wheel, TimerEntry* timer) {
+
+    timer_wheel_file(wheel, timer);
+    timer->running = true;
+    if (++wheel->running > wheel->stats.max_running) wheel->stats.max_running = wheel->running;
+}
+
+
+/**
+ * @brief Take a running timer off whichever list it's on.
+ *
+ * @param wheel: The wheel.
+ * @param timer: The timer.
+ */
+static void timer_wheel_unlink(TimerWheel* wheel, TimerEntry* timer) {
+
+    timer_wheel_remove(&timer->link);
+    timer->running = false;
+
+    // Its slot may now be empty
+    if (timer->level < TIMER_WHEEL_LEVELS) {
+        TimerLink* slot = &wheel->slots[timer->level][timer->slot];
+        if (slot->next == slot) wheel->occupied[timer->level] &= ~(1ULL << timer->slot);
+    }
+
+    wheel->running--;
+}
+
+
+/**
+ * @brief Hang a timer on the list for its expiry, relative to the wheel's
+ *        current tick, which it must not precede.
+ *
+ * @param wheel: The wheel.
+ * @param timer: The timer, with its expiry set.
+ */
+static void timer_wheel_file(TimerWheel* wheel, TimerEntry* timer) {
+
+    // The level of the highest six bits in which the expiry and now differ
+    uint64_t differ = timer->expiry ^ wheel->now;
+    uint32_t level = differ == 0 ? 0 : (uint32_t)(63 - __builtin_clzll(differ)) / TIMER_WHEEL_SLOT_BITS;
+
+    if (level < TIMER_WHEEL_LEVELS) {
+        uint32_t index = timer_wheel_slot(timer->expiry, level);
+        timer_wheel_append(&wheel->slots[level][index], &timer->link);
+        wheel->occupied[level] |= 1ULL << index;
+        timer->level = (uint8_t)level;
+        timer->slot = (uint8_t)index;
+    } else {
+        timer_wheel_append(&wheel->overflow, &timer->link);
+        timer->level = TIMER_WHEEL_OVERFLOW;
+        timer->slot = 0;
+    }
+}
+
+
+/**
+ * @brief File every timer on a list again, now that the wheel has reached
+ *        the start of the slot, or turn, that the list covers.
+ *
+ * @param wheel: The wheel.
+ * @param list:  The list.
+ */
+static void timer_wheel_cascade(TimerWheel* wheel, TimerLink* list) {
+
+    if (list->next == list) return;
+
+    // Detach the timers first: an overflowed one may go back on the list
+    TimerLink pending = { list->next, list->prev };
+    pending.next->prev = &pending;
+    pending.prev->next = &pending;
+    list->next = list;
+    list->prev = list;
+
+    while (pending.next != &pending) {
+        TimerEntry* timer = (TimerEntry*)pending.next;
+        timer_wheel_remove(&timer->link);
+        timer_wheel_file(wheel, timer);
+        wheel->stats.cascades++;
+    }
+}
+
+
+/**
+ * @brief Add a link to the end of a list.
+ *
+ * @param list: The list.
+ * @param link: The link.
+ */
+static void timer_wheel_append(TimerLink* list, TimerLink* link) {
+
+    link->prev = list->prev;
+    link->next = list;
+    list->prev->next = link;
+    list->prev = link;
+}
+
+
+/**
+ * @brief Take a link off its list.
+ *
+ * @param link: The link.
+ */
+static void timer_wheel_remove(TimerLink* link) {
+
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = NULL;
+    link->prev = NULL;
+}
+
+
+/**
+ * @brief A tick's slot in a level: its six bits for that level.
+ *
+ * @param tick:  The tick.
+ * @param level: The level.
+ *
+ * @returns The slot's index.
+ */
+static uint32_t timer_wheel_slot(uint64_t tick, uint32_t level) {
+
+    return (uint32_t)(tick >> (level * TIMER_WHEEL_SLOT_BITS)) % TIMER_WHEEL_SLOTS;
+}
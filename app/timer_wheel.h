@@ -0,0 +1,113 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * CONSTANTS
+ */
+// Slots in each level of the wheel. Must be 64: a bit in the level's
+// `occupied` marks each slot that holds timers. Level 0's slots are a
+// tick apart, and each further level's 64 times those below, so three
+// levels reach 2^18 ticks -- over four minutes at 1ms a tick. Timers
+// due later wait in an overflow list
+#define     TIMER_WHEEL_SLOTS           64
+#define     TIMER_WHEEL_SLOT_BITS       6
+#define     TIMER_WHEEL_LEVELS          3
+#define     TIMER_WHEEL_NONE            UINT64_MAX
+
+// The `level` of a timer on the overflow list, and of one on the list of
+// timers about to be called back
+#define     TIMER_WHEEL_OVERFLOW        TIMER_WHEEL_LEVELS
+#define     TIMER_WHEEL_DUE             (TIMER_WHEEL_LEVELS + 1)
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+typedef struct TimerLink {
+    struct TimerLink*   next;
+    struct TimerLink*   prev;
+} TimerLink;
+
+typedef struct TimerEntry TimerEntry;
+
+// Called by `timer_wheel_advance()` when a timer expires. It may start
+// or stop any timer, including this one
+typedef void (*TimerCallback)(TimerEntry* timer, void* context);
+
+// A timer. `link` must come first. Set up with `timer_wheel_init_timer()`
+// and don't move it while it's running. `level` and `slot` say which list
+// it's on
+struct TimerEntry {
+    TimerLink           link;
+    uint64_t            expiry;
+    uint32_t            period;
+    bool                running;
+    uint8_t             level;
+    uint8_t             slot;
+    TimerCallback       callback;
+    void*               context;
+};
+
+// `cascades` counts timers filed again, in a lower level or out of the
+// overflow list, as their expiry neared
+typedef struct {
+    uint32_t    started;
+    uint32_t    stopped;
+    uint32_t    expired;
+    uint32_t    cascades;
+    uint32_t    max_running;
+} TimerWheelStats;
+
+// A timer hangs in level 0 if its expiry differs from `now`, the last tick
+// advanced to, only in the lowest six bits, else in the level of the
+// highest six that differ, in the slot those bits of its expiry give
+typedef struct {
+    TimerLink           slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t            occupied[TIMER_WHEEL_LEVELS];
+    TimerLink           overflow;
+    uint64_t            now;
+    uint32_t            running;
+    TimerWheelStats     stats;
+} TimerWheel;
+
+
+/*
+ * PROTOTYPES
+ */
+void        timer_wheel_init(TimerWheel* wheel, uint64_t now);
+void        timer_wheel_init_timer(TimerEntry* timer, TimerCallback callback, void* context);
+void        timer_wheel_start(TimerWheel* wheel, TimerEntry* timer, uint32_t delay, uint32_t period);
+void        timer_wheel_stop(TimerWheel* wheel, TimerEntry* timer);
+uint32_t    timer_wheel_advance(TimerWheel* wheel, uint64_t now);
+uint64_t    timer_wheel_next_expiry(const TimerWheel* wheel);
+uint32_t    timer_wheel_wait_time(const TimerWheel* wheel, uint64_t now);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _TIMER_WHEEL_H_
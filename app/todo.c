@@ -0,0 +1,16 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "todo.h"
+
+
+/*
+ * GLOBALS
+ */
+// The field table, keys hashed at compile time
+JSON_DEFINE_SCHEMA(todo_schema, Todo, TODO_FIELDS);
@@ -0,0 +1,56 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _TODO_H_
+#define _TODO_H_
+
+
+/*
+ * INCLUDES
+ */
+#include "json.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     TODO_TITLE_MAX_LEN          64
+
+// The `/todos/{id}` object: its JSON keys and where they go in `Todo`
+#define     TODO_FIELDS(FIELD, T) \
+                FIELD(T, "userId",      user_id,    UINT32, 0) \
+                FIELD(T, "id",          id,         UINT32, 0) \
+                FIELD(T, "title",       title,      STRING, TODO_TITLE_MAX_LEN + 1) \
+                FIELD(T, "completed",   completed,  BOOL,   0)
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+typedef struct {
+    TODO_FIELDS(JSON_STRUCT_MEMBER, Todo)
+} Todo;
+
+
+/*
+ * GLOBALS
+ */
+extern const JsonSchema todo_schema;
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _TODO_H_
@@ -0,0 +1,237 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "json.h"
+#include "cbor.h"
+#include "todo.h"
+
+
+/*
+ * NOTE Compares the app's CBOR codec in `app/cbor.c` with its JSON one on
+ *      the records in a fixture array of todos. Each record is encoded as
+ *      compact JSON and as CBOR, then both encodings are decoded with the
+ *      same schema. The run checks the decoded records match the fixture's,
+ *      and reports the encoded sizes and the time per record of each step.
+ *
+ *      Usage: cbor-bench [fixture.json] [iterations]
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#ifndef SIM_FIXTURE_DIR
+#define     SIM_FIXTURE_DIR             "sim/fixtures"
+#endif
+
+#define     BENCH_DEFAULT_ITERATIONS    2000
+#define     BENCH_MAX_RECORDS           256
+#define     BENCH_RECORD_SIZE_B         192
+
+
+/*
+ * TYPES
+ */
+typedef struct {
+    uint8_t     data[BENCH_RECORD_SIZE_B];
+    uint32_t    length;
+} BenchEncoding;
+
+
+/*
+ * GLOBALS
+ */
+static Todo             todos[BENCH_MAX_RECORDS];
+static BenchEncoding    json_records[BENCH_MAX_RECORDS];
+static BenchEncoding    cbor_records[BENCH_MAX_RECORDS];
+
+
+/**
+ * @brief Host monotonic time in seconds.
+ */
+static double bench_now(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+/**
+ * @brief Encode a todo as compact JSON, as a server would send it.
+ *
+ * @returns `true` if the record fitted, otherwise `false`.
+ */
+static bool bench_encode_json(const Todo* todo, BenchEncoding* out) {
+
+    int length = snprintf((char*)out->data, sizeof(out->data), "{\"userId\":%u,\"id\":%u,\"title\":\"%s\",\"completed\":%s}",
+                          (unsigned)todo->user_id, (unsigned)todo->id, todo->title, todo->completed ? "true" : "false");
+    if (length < 0 || (size_t)length >= sizeof(out->data)) return false;
+    out->length = (uint32_t)length;
+    return true;
+}
+
+
+/**
+ * @brief Encode a todo as a CBOR map.
+ *
+ * @returns `true` if the record fitted, otherwise `false`.
+ */
+static bool bench_encode_cbor(const Todo* todo, BenchEncoding* out) {
+
+    CborWriter writer;
+    cbor_writer_init(&writer, out->data, sizeof(out->data));
+    if (!cbor_put_schema(&writer, &todo_schema, todo)) return false;
+    out->length = writer.length;
+    return true;
+}
+
+
+/**
+ * @brief Decode a JSON record into a todo.
+ */
+static bool bench_decode_json(const BenchEncoding* in, Todo* todo) {
+
+    JsonDecoder decoder;
+    json_decoder_init(&decoder, &todo_schema, todo);
+    return json_decoder_feed(&decoder, in->data, in->length) && json_decoder_finish(&decoder);
+}
+
+
+/**
+ * @brief Decode a CBOR record into a todo.
+ */
+static bool bench_decode_cbor(const BenchEncoding* in, Todo* todo) {
+
+    CborDecoder decoder;
+    cbor_decoder_init(&decoder, &todo_schema, todo);
+    return cbor_decoder_feed(&decoder, in->data, in->length) && cbor_decoder_finish(&decoder);
+}
+
+
+/**
+ * @brief Check a decoded todo against the fixture's.
+ */
+static bool bench_same(const Todo* a, const Todo* b) {
+
+    return a->user_id == b->user_id && a->id == b->id && a->completed == b->completed && strcmp(a->title, b->title) == 0;
+}
+
+
+/**
+ * @brief Decode the flat objects in a fixture array of todos.
+ *
+ * @returns The number of todos read.
+ */
+static uint32_t bench_load(const uint8_t* data, size_t length) {
+
+    uint32_t count = 0;
+    size_t offset = 0;
+    while (count < BENCH_MAX_RECORDS) {
+        const uint8_t* open = memchr(data + offset, '{', length - offset);
+        if (open == NULL) break;
+        const uint8_t* close = memchr(open, '}', length - (size_t)(open - data));
+        if (close == NULL) break;
+
+        JsonDecoder decoder;
+        json_decoder_init(&decoder, &todo_schema, &todos[count]);
+        if (json_decoder_feed(&decoder, open, (uint32_t)(close - open + 1)) && json_decoder_finish(&decoder)) count++;
+        offset = (size_t)(close - data) + 1;
+    }
+
+    return count;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    const char* path = argc > 1 ? argv[1] : SIM_FIXTURE_DIR "/todos.json";
+    long iterations = argc > 2 ? strtol(argv[2], NULL, 10) : BENCH_DEFAULT_ITERATIONS;
+    if (iterations < 1) iterations = 1;
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size_t length = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = malloc(length);
+    if (data == NULL || fread(data, 1, length, file) != length) {
+        fprintf(stderr, "Could not read %s\n", path);
+        return 1;
+    }
+
+    fclose(file);
+    uint32_t count = bench_load(data, length);
+    free(data);
+    if (count == 0) {
+        fprintf(stderr, "No records in %s\n", path);
+        return 1;
+    }
+
+    // Encode every record both ways, and check both round-trip
+    uint32_t json_bytes = 0, cbor_bytes = 0;
+    for (uint32_t i = 0 ; i < count ; ++i) {
+        Todo json_todo = { 0 }, cbor_todo = { 0 };
+        if (!bench_encode_json(&todos[i], &json_records[i]) || !bench_encode_cbor(&todos[i], &cbor_records[i])) {
+            fprintf(stderr, "Record %u does not fit\n", i);
+            return 1;
+        }
+
+        if (!bench_decode_json(&json_records[i], &json_todo) || !bench_same(&json_todo, &todos[i])) {
+            fprintf(stderr, "Record %u does not round-trip as JSON\n", i);
+            return 1;
+        }
+
+        if (!bench_decode_cbor(&cbor_records[i], &cbor_todo) || !bench_same(&cbor_todo, &todos[i])) {
+            fprintf(stderr, "Record %u does not round-trip as CBOR\n", i);
+            return 1;
+        }
+
+        json_bytes += json_records[i].length;
+        cbor_bytes += cbor_records[i].length;
+    }
+
+    // Time each step over every record
+    double per_record = 1e9 / ((double)count * (double)iterations);
+    double timings[4];
+    volatile uint32_t sink = 0;
+    Todo todo;
+    for (int step = 0 ; step < 4 ; ++step) {
+        double start = bench_now();
+        for (long n = 0 ; n < iterations ; ++n) {
+            for (uint32_t i = 0 ; i < count ; ++i) {
+                switch (step) {
+                    case 0:  sink += bench_encode_json(&todos[i], &json_records[i]); break;
+                    case 1:  sink += bench_encode_cbor(&todos[i], &cbor_records[i]); break;
+                    case 2:  sink += bench_decode_json(&json_records[i], &todo); break;
+                    default: sink += bench_decode_cbor(&cbor_records[i], &todo);
+                }
+            }
+        }
+
+        timings[step] = (bench_now() - start) * per_record;
+    }
+
+    printf("Records: %u from %s, decoder state: JSON %zu bytes, CBOR %zu bytes\n",
+           count, path, sizeof(JsonDecoder), sizeof(CborDecoder));
+    printf("%8s %12s %12s %14s %14s\n", "format", "bytes", "per record", "encode ns", "decode ns");
+    printf("%8s %12u %12.1f %14.1f %14.1f\n", "JSON", json_bytes, (double)json_bytes / count, timings[0], timings[2]);
+    printf("%8s %12u %12.1f %14.1f %14.1f\n", "CBOR", cbor_bytes, (double)cbor_bytes / count, timings[1], timings[3]);
+    printf("CBOR is %.1f%% of the JSON size\n", 100.0 * cbor_bytes / json_bytes);
+    return sink == 0;
+}
@@ -0,0 +1,167 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "digest.h"
+
+
+/*
+ * NOTE Measures the throughput of the integrity checks in `app/digest.c`:
+ *      the word-at-a-time CRC-32 against the nibble-table one it replaced,
+ *      and SHA-256. Data is fed in chunks the size the HTTP engine reads
+ *      bodies in, and in larger ones. Each algorithm is first checked
+ *      against standard test vectors, and against itself fed in one go.
+ *
+ *      Usage: digest-bench [megabytes]
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_DEFAULT_MB            64
+#define     BENCH_BUFFER_SIZE_B         (64 * 1024)
+
+
+/**
+ * @brief Host monotonic time in seconds.
+ */
+static double bench_now(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+/**
+ * @brief The CRC-32 the flash cache and inflater used before, two table
+ *        lookups per byte, for comparison.
+ */
+static uint32_t bench_crc32_nibble(uint32_t crc, const void* data, uint32_t length) {
+
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    crc = ~crc;
+    for (uint32_t i = 0 ; i < length ; ++i) {
+        crc = table[(crc ^ bytes[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (bytes[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+
+    return ~crc;
+}
+
+
+/**
+ * @brief Check each algorithm against known answers, and chunked input
+ *        against whole.
+ *
+ * @returns `true` if all agree, otherwise `false`.
+ */
+static bool bench_verify(const uint8_t* data, uint32_t length) {
+
+    static const uint8_t abc_sha256[DIGEST_SHA256_SIZE_B] = {
+        0xBA, 0x78, 0x16, 0xBF, 0x8F, 0x01, 0xCF, 0xEA, 0x41, 0x41, 0x40, 0xDE, 0x5D, 0xAE, 0x22, 0x23,
+        0xB0, 0x03, 0x61, 0xA3, 0x96, 0x17, 0x7A, 0x9C, 0xB4, 0x10, 0xFF, 0x61, 0xF2, 0x00, 0x15, 0xAD
+    };
+
+    static const uint8_t two_block_sha256[DIGEST_SHA256_SIZE_B] = {
+        0x24, 0x8D, 0x6A, 0x61, 0xD2, 0x06, 0x38, 0xB8, 0xE5, 0xC0, 0x26, 0x93, 0x0C, 0x3E, 0x60, 0x39,
+        0xA3, 0x3C, 0xE4, 0x59, 0x64, 0xFF, 0x21, 0x67, 0xF6, 0xEC, 0xED, 0xD4, 0x19, 0xDB, 0x06, 0xC1
+    };
+
+    uint8_t digest[DIGEST_SHA256_SIZE_B];
+    uint8_t whole[DIGEST_SHA256_SIZE_B];
+    DigestSha256 sha;
+
+    bool ok = digest_crc32(0, "123456789", 9) == 0xCBF43926;
+    ok = ok && digest_crc32(0, data + 1, length - 1) == bench_crc32_nibble(0, data + 1, length - 1);
+
+    digest_sha256_init(&sha);
+    digest_sha256_update(&sha, "abc", 3);
+    digest_sha256_final(&sha, digest);
+    ok = ok && memcmp(digest, abc_sha256, sizeof(digest)) == 0;
+
+    digest_sha256_init(&sha);
+    digest_sha256_update(&sha, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56);
+    digest_sha256_final(&sha, digest);
+    ok = ok && memcmp(digest, two_block_sha256, sizeof(digest)) == 0;
+
+    // Odd-sized chunks at odd offsets must give the same results
+    digest_sha256_init(&sha);
+    digest_sha256_update(&sha, data, length);
+    digest_sha256_final(&sha, whole);
+
+    digest_sha256_init(&sha);
+    uint32_t crc = 0;
+    for (uint32_t offset = 0, chunk = 1 ; offset < length ; offset += chunk, chunk = chunk * 3 % 251 + 1) {
+        uint32_t size = length - offset < chunk ? length - offset : chunk;
+        digest_sha256_update(&sha, data + offset, size);
+        crc = digest_crc32(crc, data + offset, size);
+    }
+
+    digest_sha256_final(&sha, digest);
+    return ok && memcmp(digest, whole, sizeof(digest)) == 0 && crc == bench_crc32_nibble(0, data, length);
+}
+
+
+int main(int argc, char* argv[]) {
+
+    long megabytes = argc > 1 ? strtol(argv[1], NULL, 10) : BENCH_DEFAULT_MB;
+    if (megabytes < 1) megabytes = 1;
+
+    static uint8_t data[BENCH_BUFFER_SIZE_B];
+    for (uint32_t i = 0 ; i < sizeof(data) ; ++i) data[i] = (uint8_t)(i * 2654435761u >> 24);
+
+    if (!bench_verify(data, sizeof(data))) {
+        fprintf(stderr, "Digest check failed\n");
+        return 1;
+    }
+
+    uint64_t total = (uint64_t)megabytes * 1024 * 1024;
+    printf("Data: %ld MB per run, state: SHA-256 %zu bytes\n", megabytes, sizeof(DigestSha256));
+    printf("%8s %16s %16s %16s\n", "chunk", "CRC-32 nibble", "CRC-32 word", "SHA-256");
+
+    const uint32_t chunks[] = { 128, 4096 };
+    for (size_t c = 0 ; c < sizeof(chunks) / sizeof(chunks[0]) ; ++c) {
+        uint32_t chunk = chunks[c];
+        double rates[3];
+        volatile uint32_t sink = 0;
+
+        for (uint32_t algorithm = 0 ; algorithm < 3 ; ++algorithm) {
+            DigestSha256 sha;
+            digest_sha256_init(&sha);
+            uint32_t crc = 0;
+
+            double start = bench_now();
+            for (uint64_t done = 0 ; done < total ; done += chunk) {
+                const uint8_t* bytes = data + done % sizeof(data);
+                if (algorithm == 0) crc = bench_crc32_nibble(crc, bytes, chunk);
+                if (algorithm == 1) crc = digest_crc32(crc, bytes, chunk);
+                if (algorithm == 2) digest_sha256_update(&sha, bytes, chunk);
+            }
+
+            uint8_t digest[DIGEST_SHA256_SIZE_B];
+            digest_sha256_final(&sha, digest);
+            sink += crc + digest[0];
+            rates[algorithm] = (double)total / (bench_now() - start) / 1e6;
+        }
+
+        printf("%8u %11.1f MB/s %11.1f MB/s %11.1f MB/s\n", (unsigned)chunk, rates[0], rates[1], rates[2]);
+    }
+
+    return 0;
+}
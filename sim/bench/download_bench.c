@@ -0,0 +1,161 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "main.h"
+
+
+/*
+ * NOTE Measures the download manager in `app/download.c` running on the
+ *      full HTTP engine and simulated Microvisor, against the fixture
+ *      server's `/comments` resource, once for each concurrency window
+ *      from 1 to `DOWNLOAD_MAX_WINDOW`. Every request's round trip is
+ *      lengthened by MV_SIM_LATENCY_MS, which defaults here to a cellular
+ *      link's 200ms, so the throughput shows how far overlapping the
+ *      slices hides it. Each run checks the resource reached the sink in
+ *      order. Runs add a query, which the server ignores, to the URL, so
+ *      none resumes another's saved progress. Finally it reports how
+ *      full the app's notification center and event ring got. Run
+ *      `sim/fixture_server.py` first.
+ *
+ *      Usage: download-bench [latency-ms]
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_URL                   "https://jsonplaceholder.typicode.com/comments"
+#define     BENCH_DEFAULT_LATENCY_MS    "200"
+#define     BENCH_FLAG_DONE             0x0001
+
+
+/*
+ * TYPES
+ */
+typedef struct {
+    osThreadId_t    task;
+    uint32_t        next;
+    bool            in_order;
+    DownloadResult  result;
+} BenchRun;
+
+
+/**
+ * @brief Host monotonic time in seconds.
+ */
+static double bench_now(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+/**
+ * @brief Download sink: check the data arrives in order, and drop it.
+ */
+static bool bench_sink(uint32_t offset, const uint8_t* data, uint32_t length, void* context) {
+
+    BenchRun* run = (BenchRun*)context;
+    if (offset != run->next) run->in_order = false;
+    run->next = offset + length;
+    return true;
+}
+
+
+/**
+ * @brief Download callback: wake the bench task.
+ */
+static void bench_done(DownloadResult result, uint32_t length, void* context) {
+
+    BenchRun* run = (BenchRun*)context;
+    run->result = result;
+    osThreadFlagsSet(run->task, BENCH_FLAG_DONE);
+}
+
+
+/**
+ * @brief Download the resource once per window size, and report each.
+ */
+static void bench_task(void* argument) {
+
+    net_wait_for_network(osWaitForever);
+    printf("Latency: %s ms per request, slice: %u bytes, channels: %u\n",
+           getenv("MV_SIM_LATENCY_MS"), (unsigned)DOWNLOAD_SLICE_SIZE_B, (unsigned)HTTP_CHANNEL_POOL_SIZE);
+    printf("%8s %10s %10s %10s %12s %10s\n", "window", "bytes", "seconds", "KB/s", "max flight", "reordered");
+
+    for (uint32_t window = 1 ; window <= DOWNLOAD_MAX_WINDOW ; ++window) {
+        BenchRun run = { osThreadGetId(), 0, true, DOWNLOAD_FAILED };
+        char url[HTTP_MAX_URL_LEN];
+        snprintf(url, sizeof(url), "%s?window=%u&run=%ld", BENCH_URL, (unsigned)window, (long)time(NULL));
+        download_set_window(window);
+
+        double start = bench_now();
+        if (!download_start(url, NULL, bench_sink, bench_done, &run)) {
+            fprintf(stderr, "Could not start download\n");
+            exit(1);
+        }
+
+        osThreadFlagsWait(BENCH_FLAG_DONE, osFlagsWaitAny, osWaitForever);
+        double seconds = bench_now() - start;
+        const DownloadStats* stats = download_get_stats();
+        if (run.result != DOWNLOAD_OK || !run.in_order) {
+            fprintf(stderr, "Download with a window of %u failed. Result: %u, in order: %s\n",
+                    (unsigned)window, (unsigned)run.result, run.in_order ? "yes" : "no");
+            exit(1);
+        }
+
+        printf("%8u %10u %10.2f %10.1f %12u %10u\n", (unsigned)window, (unsigned)run.next, seconds,
+               (double)run.next / seconds / 1024.0, (unsigned)stats->max_in_flight, (unsigned)stats->reordered);
+        fflush(stdout);
+    }
+
+    // The app's notification center and event ring, across all runs
+    const EventRingStats* events = notify_get_stats();
+    printf("Notifications: %u, most at once: %u of %u, center full: %u, ring peak: %u of %u, ring overruns: %u\n",
+           (unsigned)events->records, (unsigned)events->max_batch, (unsigned)NOTIFY_CENTER_SIZE_R,
+           (unsigned)events->center_full, (unsigned)events->high_water, (unsigned)NOTIFY_RING_SIZE,
+           (unsigned)events->overruns);
+
+    // The HTTP engine's timers: request deadlines and the download's retries
+    const TimerWheelStats* timers = http_get_timer_stats();
+    printf("Timers started: %u, stopped: %u, expired: %u, most running: %u, cascades: %u\n",
+           (unsigned)timers->started, (unsigned)timers->stopped, (unsigned)timers->expired,
+           (unsigned)timers->max_running, (unsigned)timers->cascades);
+    exit(0);
+}
+
+
+int main(int argc, char* argv[]) {
+
+    // The simulator reads its settings on the first system call
+    setenv("MV_SIM_LATENCY_MS", argc > 1 ? argv[1] : BENCH_DEFAULT_LATENCY_MS, argc > 1);
+
+    HAL_Init();
+
+    const osThreadAttr_t attributes = {
+        .name = "BenchTask",
+        .stack_size = 4096,
+        .priority = osPriorityNormal
+    };
+
+    osKernelInitialize();
+    net_open_network();
+    telemetry_init();
+    if (!http_start_engine()) {
+        fprintf(stderr, "Could not start HTTP engine\n");
+        return 1;
+    }
+
+    osThreadNew(bench_task, NULL, &attributes);
+    osKernelStart();
+    return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "event_ring.h"
+
+
+/*
+ * NOTE Exercises the event ring in `app/event_ring.c` across two host
+ *      threads. One plays Microvisor and the ISR: it writes bursts of
+ *      records into an 8-slot notification center, drains the center into
+ *      the ring, and yields. The other plays the task, taking records a
+ *      batch at a time, and yields when there are none. Each record's tag
+ *      is a sequence number, so the consumer can check none arrives out of
+ *      order or twice, and that every record is either received or counted
+ *      as lost. Reports the time per record, thread switches included, and
+ *      the counters, for several burst and ring sizes.
+ *
+ *      Usage: event-bench [records]
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_DEFAULT_RECORDS       4000000
+#define     BENCH_CENTER_SIZE_R         8
+#define     BENCH_BATCH_R               8
+#define     BENCH_MAX_RING_R            64
+
+
+/*
+ * TYPES
+ */
+typedef struct {
+    EventRing           ring;
+    EventRecord         records[BENCH_MAX_RING_R];
+    uint32_t            total;
+    uint32_t            burst;
+    volatile bool       done;
+    uint32_t            overwritten;
+    uint32_t            received;
+    bool                in_order;
+} BenchRun;
+
+
+/**
+ * @brief Host monotonic time in seconds.
+ */
+static double bench_now(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+/**
+ * @brief Play Microvisor writing records round-robin, and the ISR draining them.
+ */
+static void* bench_producer(void* argument) {
+
+    BenchRun* run = (BenchRun*)argument;
+    static struct MvNotification center[BENCH_CENTER_SIZE_R];
+    uint32_t write_index = 0;
+    uint32_t read_index = 0;
+    memset(center, 0, sizeof(center));
+
+    for (uint32_t sequence = 1 ; sequence <= run->total ; ) {
+        for (uint32_t i = 0 ; i < run->burst && sequence <= run->total ; ++i, ++sequence) {
+            struct MvNotification* record = &center[write_index];
+            if (record->event_type != 0) run->overwritten++;
+            record->microseconds = sequence;
+            record->tag = sequence;
+            __atomic_store_n(&record->event_type, MV_EVENTTYPE_CHANNELDATAREADABLE, __ATOMIC_RELEASE);
+            write_index = (write_index + 1) % BENCH_CENTER_SIZE_R;
+        }
+
+        // Return from the 'ISR' and let the task run
+        event_ring_drain(&run->ring, center, BENCH_CENTER_SIZE_R, &read_index);
+        sched_yield();
+    }
+
+    __atomic_store_n(&run->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+
+/**
+ * @brief Play the task, taking records a batch at a time.
+ */
+static void* bench_consumer(void* argument) {
+
+    BenchRun* run = (BenchRun*)argument;
+    EventRecord batch[BENCH_BATCH_R];
+    uint32_t last = 0;
+
+    while (true) {
+        bool done = __atomic_load_n(&run->done, __ATOMIC_ACQUIRE);
+        uint32_t count = event_ring_pop(&run->ring, batch, BENCH_BATCH_R);
+        for (uint32_t i = 0 ; i < count ; ++i) {
+            if (batch[i].tag <= last || batch[i].microseconds != batch[i].tag) run->in_order = false;
+            last = batch[i].tag;
+        }
+
+        run->received += count;
+        if (count == 0) {
+            if (done) break;
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    long total = argc > 1 ? strtol(argv[1], NULL, 10) : BENCH_DEFAULT_RECORDS;
+    if (total < 1) total = 1;
+
+    printf("Records: %ld per run, center: %u, batch: %u\n", total, (unsigned)BENCH_CENTER_SIZE_R, (unsigned)BENCH_BATCH_R);
+    printf("%6s %6s %10s %10s %10s %10s %10s %10s\n",
+           "burst", "ring", "ns/record", "received", "overruns", "peak", "max batch", "overwrote");
+
+    const uint32_t bursts[] = { 1, 4, 8 };
+    const uint32_t rings[] = { 4, 16, BENCH_MAX_RING_R };
+    for (size_t b = 0 ; b < sizeof(bursts) / sizeof(bursts[0]) ; ++b) {
+        for (size_t r = 0 ; r < sizeof(rings) / sizeof(rings[0]) ; ++r) {
+            static BenchRun run;
+            memset(&run, 0, sizeof(run));
+            run.total = (uint32_t)total;
+            run.burst = bursts[b];
+            run.in_order = true;
+            event_ring_init(&run.ring, run.records, rings[r]);
+
+            pthread_t producer, consumer;
+            double start = bench_now();
+            pthread_create(&consumer, NULL, bench_consumer, &run);
+            pthread_create(&producer, NULL, bench_producer, &run);
+            pthread_join(producer, NULL);
+            pthread_join(consumer, NULL);
+            double seconds = bench_now() - start;
+
+            const EventRingStats* stats = &run.ring.stats;
+            if (!run.in_order || run.received + stats->overruns + run.overwritten != run.total) {
+                fprintf(stderr, "Records lost or out of order: burst %u, ring %u\n", (unsigned)bursts[b], (unsigned)rings[r]);
+                return 1;
+            }
+
+            printf("%6u %6u %10.1f %10u %10u %10u %10u %10u\n", (unsigned)bursts[b], (unsigned)rings[r],
+                   seconds * 1e9 / (double)total, (unsigned)run.received, (unsigned)stats->overruns,
+                   (unsigned)stats->high_water, (unsigned)stats->max_batch, (unsigned)run.overwritten);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "stm32u5xx_hal.h"
+#include "flash_cache.h"
+
+
+/*
+ * NOTE Exercises the flash cache in `app/flash_cache.c` on file-backed
+ *      flash. It rewrites a set of keys many times over, so the log wraps
+ *      the region repeatedly, then checks every key reads back as last
+ *      written, both straight away and after the index is rebuilt from
+ *      flash as at boot. A write cut short must leave the key's previous
+ *      record in place. It reports the time per write and per rebuild,
+ *      the flash operations per write, and how evenly the pages wore.
+ *
+ *      Usage: flash-bench [writes]
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_FLASH_FILE            "flash-bench.bin"
+#define     BENCH_DEFAULT_WRITES        5000
+#define     BENCH_KEYS                  12
+#define     BENCH_MAX_RECORD_B          1200
+#define     BENCH_CHUNK_B               128
+#define     BENCH_BOOTS                 100
+
+
+/**
+ * @brief Host monotonic time in seconds.
+ */
+static double bench_now(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+/**
+ * @brief Generate the data of a version of a key's record.
+ *
+ * @returns The size of the data in bytes.
+ */
+static uint32_t bench_record(uint32_t key, uint32_t version, uint8_t* data) {
+
+    uint32_t seed = key * 2654435761u ^ version * 40503u;
+    uint32_t length = 64 + seed % (BENCH_MAX_RECORD_B - 64);
+    for (uint32_t i = 0 ; i < length ; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+
+    return length;
+}
+
+
+/**
+ * @brief Store a record, in chunks as a response body would arrive.
+ *
+ * @returns `true` if it was stored, otherwise `false`.
+ */
+static bool bench_store(uint32_t key, const uint8_t* data, uint32_t length) {
+
+    if (!flash_cache_begin(key, length)) return false;
+    for (uint32_t offset = 0 ; offset < length ; offset += BENCH_CHUNK_B) {
+        uint32_t size = length - offset < BENCH_CHUNK_B ? length - offset : BENCH_CHUNK_B;
+        if (!flash_cache_write(data + offset, size)) return false;
+    }
+
+    return flash_cache_commit();
+}
+
+
+/**
+ * @brief Check every key reads back as the given versions.
+ *
+ * @returns The number of keys that don't.
+ */
+static uint32_t bench_verify(const uint32_t* versions) {
+
+    static uint8_t expected[BENCH_MAX_RECORD_B];
+    uint32_t failures = 0;
+    for (uint32_t key = 1 ; key <= BENCH_KEYS ; ++key) {
+        uint32_t length = 0;
+        const uint8_t* data = flash_cache_find(key, &length);
+        uint32_t expected_length = bench_record(key, versions[key - 1], expected);
+        if (data == NULL || length != expected_length || memcmp(data, expected, length) != 0) failures++;
+    }
+
+    return failures;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    long writes = argc > 1 ? strtol(argv[1], NULL, 10) : BENCH_DEFAULT_WRITES;
+    if (writes < 1) writes = 1;
+
+    // Start from blank flash
+    remove(BENCH_FLASH_FILE);
+    setenv("MV_SIM_FLASH_FILE", BENCH_FLASH_FILE, 1);
+    if (!flash_cache_init()) {
+        fprintf(stderr, "Could not initialize the flash cache\n");
+        return 1;
+    }
+
+    static uint8_t data[BENCH_MAX_RECORD_B];
+    uint32_t versions[BENCH_KEYS] = { 0 };
+    uint64_t bytes = 0;
+    double start = bench_now();
+    for (long i = 0 ; i < writes ; ++i) {
+        uint32_t key = 1 + (uint32_t)(i * 7) % BENCH_KEYS;
+        uint32_t length = bench_record(key, (uint32_t)i + 1, data);
+        if (!bench_store(key, data, length)) {
+            fprintf(stderr, "Write %ld failed\n", i);
+            return 1;
+        }
+
+        versions[key - 1] = (uint32_t)i + 1;
+        bytes += length;
+    }
+
+    double write_seconds = bench_now() - start;
+    if (bench_verify(versions) != 0) {
+        fprintf(stderr, "Records differ after writing\n");
+        return 1;
+    }
+
+    // Cut a write short: the key's last complete record must survive
+    uint32_t length = bench_record(1, 0, data);
+    if (!flash_cache_begin(1, length) || !flash_cache_write(data, length / 2)) {
+        fprintf(stderr, "Could not start the interrupted write\n");
+        return 1;
+    }
+
+    start = bench_now();
+    for (uint32_t i = 0 ; i < BENCH_BOOTS ; ++i) flash_cache_init();
+    double boot_seconds = (bench_now() - start) / BENCH_BOOTS;
+    if (bench_verify(versions) != 0) {
+        fprintf(stderr, "Records differ after rebuilding the index\n");
+        return 1;
+    }
+
+    const FlashCacheStats* stats = flash_cache_get_stats();
+    const SimFlashStats* flash = sim_flash_get_stats();
+    printf("Region: %u x %u-byte pages, %u keys, %ld writes (%.1f KB)\n",
+           FLASH_CACHE_PAGES, FLASH_CACHE_PAGE_SIZE_B, BENCH_KEYS, writes, (double)bytes / 1024);
+    printf("Write:    %8.2f us per record\n", write_seconds * 1e6 / (double)writes);
+    printf("Rebuild:  %8.2f us (%u records, %u bytes live, %u damaged)\n",
+           boot_seconds * 1e6, stats->records, stats->live_bytes, stats->corrupt);
+    printf("Flash:    %8.2f quad-words programmed and %.3f pages erased per write\n",
+           (double)flash->programs / (double)writes, (double)flash->erases / (double)writes);
+    printf("Wear:     %u..%u erases per page, %u flash errors\n",
+           stats->min_erase_count, stats->max_erase_count, flash->errors);
+
+    remove(BENCH_FLASH_FILE);
+    return flash->errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "inflate.h"
+
+
+/*
+ * NOTE Measures the throughput of the streaming inflater in `app/inflate.c`
+ *      on a gzipped fixture, fed in chunks of several sizes, and checks the
+ *      output against the uncompressed fixture every time. The fixture was
+ *      compressed with a window no larger than the inflater's, as the
+ *      fixture server does with `--gzip`:
+ *
+ *          zlib.compressobj(9, zlib.DEFLATED, 16 + 10)
+ *
+ *      Usage: inflate-bench [fixture.gz fixture] [iterations]
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#ifndef SIM_FIXTURE_DIR
+#define     SIM_FIXTURE_DIR             "sim/fixtures"
+#endif
+
+#define     BENCH_DEFAULT_ITERATIONS    5000
+
+
+/*
+ * TYPES
+ */
+typedef struct {
+    const uint8_t*  expected;
+    size_t          expected_length;
+    size_t          offset;
+    bool            matches;
+} BenchOutput;
+
+
+/**
+ * @brief Host monotonic time in seconds.
+ */
+static double bench_now(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+/**
+ * @brief Read a whole file.
+ *
+ * @returns The file's contents, to be freed, or `NULL`.
+ */
+static uint8_t* bench_load(const char* path, size_t* length) {
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    *length = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = malloc(*length > 0 ? *length : 1);
+    if (data == NULL || fread(data, 1, *length, file) != *length) {
+        fprintf(stderr, "Could not read %s\n", path);
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+    return data;
+}
+
+
+/**
+ * @brief Inflater sink: compare the output with the expected data.
+ */
+static bool bench_sink(const uint8_t* data, uint32_t length, void* context) {
+
+    BenchOutput* output = (BenchOutput*)context;
+    if (output->offset + length > output->expected_length || memcmp(output->expected + output->offset, data, length) != 0) {
+        output->matches = false;
+    }
+
+    output->offset += length;
+    return true;
+}
+
+
+/**
+ * @brief Inflate a stream once, fed in chunks of the given size.
+ *
+ * @returns `true` if the stream inflated to the expected data, otherwise `false`.
+ */
+static bool bench_inflate(Inflater* inflater, const uint8_t* data, size_t length, size_t chunk, BenchOutput* output) {
+
+    output->offset = 0;
+    output->matches = true;
+    inflate_init(inflater, INFLATE_FORMAT_GZIP, bench_sink, output);
+    for (size_t offset = 0 ; offset < length ; offset += chunk) {
+        size_t size = length - offset < chunk ? length - offset : chunk;
+        if (!inflate_feed(inflater, data + offset, (uint32_t)size)) return false;
+    }
+
+    return inflate_finish(inflater) && output->matches && output->offset == output->expected_length;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    const char* compressed_path = argc > 2 ? argv[1] : SIM_FIXTURE_DIR "/todos.json.gz";
+    const char* expected_path = argc > 2 ? argv[2] : SIM_FIXTURE_DIR "/todos.json";
+    const char* count = argc == 2 ? argv[1] : (argc > 3 ? argv[3] : NULL);
+    long iterations = count != NULL ? strtol(count, NULL, 10) : BENCH_DEFAULT_ITERATIONS;
+    if (iterations < 1) iterations = 1;
+
+    size_t length = 0;
+    size_t expected_length = 0;
+    uint8_t* data = bench_load(compressed_path, &length);
+    uint8_t* expected = bench_load(expected_path, &expected_length);
+    if (data == NULL || expected == NULL) return 1;
+
+    static Inflater inflater;
+    BenchOutput output = { expected, expected_length, 0, true };
+
+    printf("Stream: %s (%zu bytes, %zu inflated, ratio %.2f), window: %u bytes, inflater state: %zu bytes\n",
+           compressed_path, length, expected_length, (double)expected_length / (double)length,
+           (unsigned)INFLATE_WINDOW_SIZE_B, sizeof(Inflater));
+    printf("%8s %14s %14s\n", "chunk", "MB/s out", "MB/s in");
+
+    const size_t chunks[] = { 1, 16, 128, length };
+    for (size_t c = 0 ; c < sizeof(chunks) / sizeof(chunks[0]) ; ++c) {
+        if (!bench_inflate(&inflater, data, length, chunks[c], &output)) {
+            fprintf(stderr, "Inflate failed with %zu-byte chunks. Error: %u\n", chunks[c], (unsigned)inflater.error);
+            return 1;
+        }
+
+        double start = bench_now();
+        for (long i = 0 ; i < iterations ; ++i) bench_inflate(&inflater, data, length, chunks[c], &output);
+        double seconds = bench_now() - start;
+        printf("%8zu %14.1f %14.1f\n", chunks[c],
+               (double)expected_length * (double)iterations / seconds / 1e6,
+               (double)length * (double)iterations / seconds / 1e6);
+    }
+
+    free(data);
+    free(expected);
+    return 0;
+}
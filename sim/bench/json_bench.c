@@ -0,0 +1,165 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "json.h"
+
+
+/*
+ * NOTE Measures the throughput of the streaming JSON parser in `app/json.c`
+ *      on a fixture document, fed in chunks of several sizes. Every chunk
+ *      size must produce the same events, which the run checks. It also
+ *      reports the deepest nesting seen and the deepest point the C stack
+ *      reached below the caller of `json_feed()`.
+ *
+ *      Usage: json-bench [fixture.json] [iterations]
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#ifndef SIM_FIXTURE_DIR
+#define     SIM_FIXTURE_DIR             "sim/fixtures"
+#endif
+
+#define     BENCH_DEFAULT_ITERATIONS    2000
+
+
+/*
+ * TYPES
+ */
+typedef struct {
+    uint32_t    events;
+    uint32_t    checksum;
+    uintptr_t   stack_top;
+    uintptr_t   stack_max;
+} BenchTally;
+
+
+/**
+ * @brief Host monotonic time in seconds.
+ */
+static double bench_now(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+/**
+ * @brief Fold a string into an FNV-1a checksum.
+ */
+static uint32_t bench_fold(uint32_t hash, const char* text) {
+
+    if (text == NULL) return hash * 16777619u;
+    while (*text != '\0') hash = (hash ^ (uint8_t)*text++) * 16777619u;
+    return hash;
+}
+
+
+/**
+ * @brief Parser event handler: count and checksum events, and track stack use.
+ */
+static void bench_handler(const JsonEvent* event, void* context) {
+
+    BenchTally* tally = (BenchTally*)context;
+    tally->events++;
+    tally->checksum = bench_fold((tally->checksum ^ event->type) * 16777619u, event->key);
+    tally->checksum = bench_fold(tally->checksum, event->value);
+
+    uintptr_t here = (uintptr_t)&here;
+    if (tally->stack_top > here && tally->stack_top - here > tally->stack_max) tally->stack_max = tally->stack_top - here;
+}
+
+
+/**
+ * @brief Parse a document once, fed in chunks of the given size.
+ *
+ * @returns `true` if the document parsed, otherwise `false`.
+ */
+static __attribute__((noinline)) bool bench_parse(const uint8_t* data, size_t length, size_t chunk, BenchTally* tally, uint32_t* max_depth) {
+
+    uintptr_t top = (uintptr_t)&top;
+    tally->stack_top = top;
+
+    JsonParser parser;
+    json_init(&parser, bench_handler, tally);
+    for (size_t offset = 0 ; offset < length ; offset += chunk) {
+        size_t size = length - offset < chunk ? length - offset : chunk;
+        if (!json_feed(&parser, data + offset, (uint32_t)size)) return false;
+    }
+
+    *max_depth = parser.max_depth;
+    return json_finish(&parser);
+}
+
+
+int main(int argc, char* argv[]) {
+
+    const char* path = argc > 1 ? argv[1] : SIM_FIXTURE_DIR "/todos.json";
+    long iterations = argc > 2 ? strtol(argv[2], NULL, 10) : BENCH_DEFAULT_ITERATIONS;
+    if (iterations < 1) iterations = 1;
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size_t length = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = malloc(length);
+    if (data == NULL || fread(data, 1, length, file) != length) {
+        fprintf(stderr, "Could not read %s\n", path);
+        return 1;
+    }
+
+    fclose(file);
+
+    printf("Document: %s (%zu bytes), parser state: %zu bytes\n", path, length, sizeof(JsonParser));
+    printf("%8s %12s %10s %10s %10s\n", "chunk", "MB/s", "events", "depth", "stack");
+
+    const size_t chunks[] = { 1, 16, 128, length };
+    uint32_t reference = 0;
+    for (size_t c = 0 ; c < sizeof(chunks) / sizeof(chunks[0]) ; ++c) {
+        BenchTally tally = { 0 };
+        uint32_t max_depth = 0;
+        if (!bench_parse(data, length, chunks[c], &tally, &max_depth)) {
+            fprintf(stderr, "Parse failed with %zu-byte chunks\n", chunks[c]);
+            return 1;
+        }
+
+        // The events must not depend on where the chunks split the document
+        if (c == 0) reference = tally.checksum;
+        if (tally.checksum != reference) {
+            fprintf(stderr, "Events differ with %zu-byte chunks\n", chunks[c]);
+            return 1;
+        }
+
+        uint32_t events = tally.events;
+        double start = bench_now();
+        for (long i = 0 ; i < iterations ; ++i) {
+            tally.events = 0;
+            bench_parse(data, length, chunks[c], &tally, &max_depth);
+        }
+
+        double seconds = bench_now() - start;
+        printf("%8zu %12.1f %10u %10u %10zu\n", chunks[c],
+               (double)length * (double)iterations / seconds / 1e6, events, max_depth, (size_t)tally.stack_max);
+    }
+
+    free(data);
+    return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "http_template.h"
+
+
+/*
+ * NOTE Compares building a request's URL from a template in
+ *      `app/http_template.c` with the `snprintf()` path it replaced, which
+ *      also measured the method and URL with `strlen()` on every send.
+ *      Both must produce the same URL for every item number, which the run
+ *      checks, as it does the integer conversion against `snprintf()`.
+ *
+ *      Usage: template-bench [iterations]
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_DEFAULT_ITERATIONS    5000000
+#define     BENCH_URL_PREFIX            "https://jsonplaceholder.typicode.com/todos/"
+#define     BENCH_URL_SIZE              128
+
+
+/*
+ * GLOBALS
+ */
+static const HttpTemplate bench_template = { HTTP_TEMPLATE("GET", BENCH_URL_PREFIX, "") };
+
+// Stops the compiler discarding the work being timed
+static volatile uint32_t bench_sink = 0;
+
+
+/**
+ * @brief Host monotonic time in seconds.
+ */
+static double bench_now(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+/**
+ * @brief Build a URL as the app did before templates.
+ *
+ * @returns The method and URL lengths, summed.
+ */
+static __attribute__((noinline)) uint32_t bench_snprintf_url(const char* method, uint32_t item, char* url) {
+
+    snprintf(url, BENCH_URL_SIZE, BENCH_URL_PREFIX "%u", item);
+    return (uint32_t)(strlen(method) + strlen(url));
+}
+
+
+/**
+ * @brief Build a URL from the template.
+ *
+ * @returns The method and URL lengths, summed.
+ */
+static __attribute__((noinline)) uint32_t bench_template_url(uint32_t item, char* url) {
+
+    return bench_template.method_length + http_template_url(&bench_template, item, url, BENCH_URL_SIZE);
+}
+
+
+/**
+ * @brief Check the integer conversion matches `snprintf()`.
+ *
+ * @returns `true` if it does, otherwise `false`.
+ */
+static bool bench_check_decimal(uint32_t value) {
+
+    char expected[16];
+    char actual[16] = { 0 };
+    snprintf(expected, sizeof(expected), "%u", value);
+    uint32_t length = http_u32_to_dec(value, actual);
+    return length == strlen(expected) && memcmp(actual, expected, length) == 0;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    long iterations = argc > 1 ? strtol(argv[1], NULL, 10) : BENCH_DEFAULT_ITERATIONS;
+    if (iterations < 1) iterations = 1;
+
+    // Every power of ten and its neighbours, the extremes, then a spread
+    uint32_t power = 1;
+    for (uint32_t i = 0 ; i < 10 ; ++i, power *= 10) {
+        if (!bench_check_decimal(power - 1) || !bench_check_decimal(power) || !bench_check_decimal(power + 1)) {
+            fprintf(stderr, "Conversion of %u differs from snprintf\n", power);
+            return 1;
+        }
+    }
+
+    uint32_t value = 0;
+    for (uint32_t i = 0 ; i < 1000000 ; ++i, value = value * 1664525u + 1013904223u) {
+        if (!bench_check_decimal(value) || !bench_check_decimal(UINT32_MAX - i)) {
+            fprintf(stderr, "Conversion of %u differs from snprintf\n", value);
+            return 1;
+        }
+    }
+
+    char expected[BENCH_URL_SIZE];
+    char actual[BENCH_URL_SIZE];
+    for (uint32_t item = 0 ; item < 100000 ; ++item) {
+        if (bench_snprintf_url("GET", item, expected) != bench_template_url(item, actual) || strcmp(expected, actual) != 0) {
+            fprintf(stderr, "URLs for item %u differ\n", item);
+            return 1;
+        }
+    }
+
+    // Item numbers cycle as the demo's do
+    double start = bench_now();
+    for (long i = 0 ; i < iterations ; ++i) bench_sink += bench_snprintf_url("GET", 1 + (uint32_t)i % 200, expected);
+    double snprintf_ns = (bench_now() - start) * 1e9 / (double)iterations;
+
+    start = bench_now();
+    for (long i = 0 ; i < iterations ; ++i) bench_sink += bench_template_url(1 + (uint32_t)i % 200, actual);
+    double template_ns = (bench_now() - start) * 1e9 / (double)iterations;
+
+    start = bench_now();
+    for (long i = 0 ; i < iterations ; ++i) bench_sink += (uint32_t)snprintf(expected, sizeof(expected), "%u", (uint32_t)i * 2654435761u);
+    double snprintf_dec_ns = (bench_now() - start) * 1e9 / (double)iterations;
+
+    start = bench_now();
+    for (long i = 0 ; i < iterations ; ++i) bench_sink += http_u32_to_dec((uint32_t)i * 2654435761u, actual);
+    double dec_ns = (bench_now() - start) * 1e9 / (double)iterations;
+
+    printf("%ld iterations\n", iterations);
+    printf("%-28s %10s %10s %8s\n", "", "snprintf", "template", "speedup");
+    printf("%-28s %8.1fns %8.1fns %7.1fx\n", "Request URL and lengths", snprintf_ns, template_ns, snprintf_ns / template_ns);
+    printf("%-28s %8.1fns %8.1fns %7.1fx\n", "uint32_t to decimal", snprintf_dec_ns, dec_ns, snprintf_dec_ns / dec_ns);
+    return 0;
+}
@@ -0,0 +1,299 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "timer_wheel.h"
+
+
+/*
+ * NOTE Exercises the timer wheel in `app/timer_wheel.c` with a random mix
+ *      of starts, restarts, stops and clock advances -- delays from under
+ *      a tick to hours, or only the 2-60s deadlines the HTTP engine sets,
+ *      one-shot and periodic -- and checks every expiry
+ *      against a plain array of deadlines, and that the wheel never asks
+ *      to be advanced later than the earliest of them. The clock starts
+ *      just short of 2^32 ms, where a 32-bit tick wraps. Then times the
+ *      same mix on the wheel and on the array, which must scan every timer
+ *      to find the next expiry, for several numbers of timers, and fails
+ *      if the wheel's time per operation grows with the number of timers.
+ *      Each expiry counts as an operation: the more timers are running,
+ *      the more expire each time the clock advances.
+ *
+ *      Usage: timer-bench [operations]
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_DEFAULT_OPS           2000000
+#define     BENCH_MAX_TIMERS            1024
+#define     BENCH_START_TICK            (0x100000000ULL - 5000)
+// The most the wheel's time per operation may grow from BENCH_FLAT_BASE
+// timers to BENCH_MAX_TIMERS
+#define     BENCH_FLAT_BASE             16
+#define     BENCH_FLAT_RATIO            2.0
+
+
+/*
+ * TYPES
+ */
+// A timer as an array entry, for the check and the comparison
+typedef struct {
+    uint64_t    expiry;
+    uint32_t    period;
+    bool        running;
+} BenchDeadline;
+
+
+/*
+ * GLOBALS
+ */
+static TimerWheel       wheel;
+static TimerEntry       timers[BENCH_MAX_TIMERS];
+static BenchDeadline    deadlines[BENCH_MAX_TIMERS];
+static uint32_t         fired[BENCH_MAX_TIMERS];
+static uint64_t         bench_now_tick;
+static bool             bench_ok = true;
+static bool             bench_deadlines = false;
+static uint32_t         bench_rng = 0x2545F491;
+
+
+/**
+ * @brief Host monotonic time in seconds.
+ */
+static double bench_now(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+/**
+ * @brief A pseudo-random number, the same on every run.
+ */
+static uint32_t bench_random(void) {
+
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 17;
+    bench_rng ^= bench_rng << 5;
+    return bench_rng;
+}
+
+
+/**
+ * @brief A delay: mostly under a turn of the wheel's lowest level, some
+ *        up to a minute, a few beyond its highest, to overflow. Or, for
+ *        the engine's deadlines, 2-60s.
+ */
+static uint32_t bench_delay(void) {
+
+    if (bench_deadlines) return 2000 + bench_random() % 58000;
+
+    uint32_t roll = bench_random() % 16;
+    if (roll < 8) return bench_random() % TIMER_WHEEL_SLOTS;
+    if (roll < 14) return bench_random() % 5000;
+    if (roll < 15) return bench_random() % 60000;
+    return bench_random() % (1UL << 24);
+}
+
+
+/**
+ * @brief Count a wheel timer's expiry, and check it was due.
+ */
+static void bench_expired(TimerEntry* timer, void* context) {
+
+    uint32_t index = (uint32_t)(timer - timers);
+    fired[index]++;
+
+    // A periodic timer has already been moved on to its next expiry
+    uint64_t expiry = timer->period > 0 ? timer->expiry - timer->period : timer->expiry;
+    if (expiry > bench_now_tick) {
+        fprintf(stderr, "Timer %u fired at %llu, before its expiry at %llu\n",
+                index, (unsigned long long)bench_now_tick, (unsigned long long)expiry);
+        bench_ok = false;
+    }
+}
+
+
+/**
+ * @brief Move the array on to `now`, counting each deadline that passed.
+ */
+static uint32_t bench_array_advance(uint32_t count, uint64_t now, uint32_t* expired) {
+
+    uint32_t total = 0;
+    for (uint32_t i = 0 ; i < count ; ++i) {
+        BenchDeadline* deadline = &deadlines[i];
+        if (!deadline->running || deadline->expiry > now) continue;
+
+        if (expired != NULL) expired[i]++;
+        total++;
+        if (deadline->period > 0) {
+            deadline->expiry += ((now - deadline->expiry) / deadline->period + 1) * deadline->period;
+        } else {
+            deadline->running = false;
+        }
+    }
+
+    return total;
+}
+
+
+/**
+ * @brief Find the array's earliest deadline.
+ */
+static uint64_t bench_array_next(uint32_t count) {
+
+    uint64_t next = TIMER_WHEEL_NONE;
+    for (uint32_t i = 0 ; i < count ; ++i) {
+        if (deadlines[i].running && deadlines[i].expiry < next) next = deadlines[i].expiry;
+    }
+
+    return next;
+}
+
+
+/**
+ * @brief Run a mix of operations on `count` timers, on the wheel, the
+ *        array, or both, checking one against the other when both run.
+ *
+ * @returns The timers that expired.
+ */
+static uint64_t bench_run(uint32_t count, long ops, bool use_wheel, bool use_array) {
+
+    static uint32_t array_fired[BENCH_MAX_TIMERS];
+    bool check = use_wheel && use_array;
+    uint64_t total = 0;
+
+    bench_rng = 0x2545F491;
+    bench_now_tick = BENCH_START_TICK;
+    timer_wheel_init(&wheel, bench_now_tick);
+    memset(deadlines, 0, sizeof(deadlines));
+    memset(fired, 0, sizeof(fired));
+    memset(array_fired, 0, sizeof(array_fired));
+    for (uint32_t i = 0 ; i < count ; ++i) timer_wheel_init_timer(&timers[i], bench_expired, NULL);
+
+    for (long op = 0 ; op < ops && bench_ok ; ++op) {
+        uint32_t roll = bench_random() % 16;
+        uint32_t index = bench_random() % count;
+        if (roll < 7) {
+            // Start or restart a timer, a quarter of them periodic
+            uint32_t delay = bench_delay();
+            uint32_t period = bench_random() % 4 == 0 ? (bench_deadlines ? 500 : 1) + bench_random() % 2000 : 0;
+            if (use_wheel) timer_wheel_start(&wheel, &timers[index], delay, period);
+            if (use_array) deadlines[index] = (BenchDeadline){ bench_now_tick + (delay > 0 ? delay : 1), period, true };
+        } else if (roll < 10) {
+            if (use_wheel) timer_wheel_stop(&wheel, &timers[index]);
+            if (use_array) deadlines[index].running = false;
+        } else {
+            // Sleep until the wheel must next be advanced, as the engine
+            // does, or be woken sooner. That may be before the next expiry,
+            // but never after it
+            uint64_t next = use_wheel ? timer_wheel_next_expiry(&wheel) : bench_array_next(count);
+            if (check) {
+                uint64_t expected = bench_array_next(count);
+                if (next > expected || next <= bench_now_tick || (next == TIMER_WHEEL_NONE) != (expected == TIMER_WHEEL_NONE)) {
+                    fprintf(stderr, "Next advance to %llu at %llu, next expiry %llu\n", (unsigned long long)next,
+                            (unsigned long long)bench_now_tick, (unsigned long long)expected);
+                    bench_ok = false;
+                }
+            }
+
+            // The engine wakes for every response, so its clock moves on
+            // in short steps
+            uint64_t step = 1 + bench_random() % (roll < 14 || bench_deadlines ? 20 : 3000);
+            if (roll == 15 && next != TIMER_WHEEL_NONE) step = next - bench_now_tick;
+            bench_now_tick += step;
+            if (use_wheel) total += timer_wheel_advance(&wheel, bench_now_tick);
+            if (use_array) {
+                uint32_t expired = bench_array_advance(count, bench_now_tick, check ? array_fired : NULL);
+                if (!use_wheel) total += expired;
+            }
+        }
+    }
+
+    if (check) {
+        for (uint32_t i = 0 ; i < count ; ++i) {
+            if (fired[i] != array_fired[i]) {
+                fprintf(stderr, "Timer %u fired %u times, expected %u\n", i, fired[i], array_fired[i]);
+                bench_ok = false;
+            }
+        }
+    }
+
+    return total;
+}
+
+
+/**
+ * @brief Check and time the current mix for several numbers of timers,
+ *        and print a row for each.
+ *
+ * @returns `false` if the wheel was wrong, or its time per operation grew.
+ */
+static bool bench_table(long ops) {
+
+    printf("%8s %10s %12s %12s %10s %10s\n", "timers", "expired", "wheel ns/op", "array ns/op", "cascades", "peak");
+
+    double base_ns = 0.0;
+    double last_ns = 0.0;
+    const uint32_t counts[] = { 4, 16, 64, 256, BENCH_MAX_TIMERS };
+    for (size_t c = 0 ; c < sizeof(counts) / sizeof(counts[0]) ; ++c) {
+        uint64_t expired = bench_run(counts[c], ops, true, true);
+        if (!bench_ok) {
+            fprintf(stderr, "Timer wheel disagrees with the deadline array: %u timers\n", (unsigned)counts[c]);
+            return false;
+        }
+
+        double start = bench_now();
+        bench_run(counts[c], ops, true, false);
+        double wheel_seconds = bench_now() - start;
+        TimerWheelStats stats = wheel.stats;
+
+        start = bench_now();
+        bench_run(counts[c], ops, false, true);
+        double array_seconds = bench_now() - start;
+
+        double operations = (double)ops + (double)expired;
+        last_ns = wheel_seconds * 1e9 / operations;
+        if (counts[c] == BENCH_FLAT_BASE) base_ns = last_ns;
+        printf("%8u %10llu %12.1f %12.1f %10u %10u\n", (unsigned)counts[c], (unsigned long long)expired,
+               last_ns, array_seconds * 1e9 / operations,
+               (unsigned)stats.cascades, (unsigned)stats.max_running);
+    }
+
+    if (last_ns > base_ns * BENCH_FLAT_RATIO) {
+        fprintf(stderr, "Timer wheel time per operation grew from %.1f ns with %u timers to %.1f ns with %u\n",
+                base_ns, (unsigned)BENCH_FLAT_BASE, last_ns, (unsigned)BENCH_MAX_TIMERS);
+        return false;
+    }
+
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    long ops = argc > 1 ? strtol(argv[1], NULL, 10) : BENCH_DEFAULT_OPS;
+    if (ops < 1) ops = 1;
+
+    printf("Operations: %ld per run, wheel: %u levels of %u slots, clock from %llu ms\n",
+           ops, (unsigned)TIMER_WHEEL_LEVELS, (unsigned)TIMER_WHEEL_SLOTS, (unsigned long long)BENCH_START_TICK);
+    const char* mixes[] = { "Mixed delays", "Engine deadlines, 2-60s" };
+    for (uint32_t mix = 0 ; mix < 2 ; ++mix) {
+        bench_deadlines = mix == 1;
+        printf("%s\n", mixes[mix]);
+        if (!bench_table(ops)) return 1;
+    }
+
+    return 0;
+}
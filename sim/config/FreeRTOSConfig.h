@@ -0,0 +1,79 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+
+/*
+ * NOTE FreeRTOS configuration for the POSIX (Linux) port. It tracks the
+ *      firmware's `config/FreeRTOSConfig.h` so tasks, timers and CMSIS-RTOS2
+ *      behave the same, minus the Cortex-M specifics. The tick hook is
+ *      enabled because the simulator runs its notification 'interrupts'
+ *      from it -- see `sim/src/hal.c`.
+ */
+#include <stdint.h>
+extern uint32_t SystemCoreClock;
+
+#define configUSE_PREEMPTION                     1
+#define configSUPPORT_STATIC_ALLOCATION          1
+#define configSUPPORT_DYNAMIC_ALLOCATION         1
+#define configUSE_IDLE_HOOK                      0
+#define configUSE_TICK_HOOK                      1
+#define configCPU_CLOCK_HZ                       ( SystemCoreClock )
+#define configTICK_RATE_HZ                       ((TickType_t)1000)
+#define configMAX_PRIORITIES                     ( 56 )
+#define configMINIMAL_STACK_SIZE                 ((uint16_t)2048)
+#define configTOTAL_HEAP_SIZE                    ((size_t)(256 * 1024))
+#define configMAX_TASK_NAME_LEN                  ( 16 )
+#define configUSE_TRACE_FACILITY                 1
+#define configUSE_16_BIT_TICKS                   0
+#define configUSE_MUTEXES                        1
+#define configQUEUE_REGISTRY_SIZE                8
+#define configUSE_RECURSIVE_MUTEXES              1
+#define configUSE_COUNTING_SEMAPHORES            1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION  0
+#define configUSE_TASK_NOTIFICATIONS             1
+#define configCHECK_FOR_STACK_OVERFLOW           0
+#define configMESSAGE_BUFFER_LENGTH_TYPE         size_t
+
+/* Co-routine definitions. */
+#define configUSE_CO_ROUTINES                    0
+#define configMAX_CO_ROUTINE_PRIORITIES          ( 2 )
+
+/* Software timer definitions. */
+#define configUSE_TIMERS                         1
+#define configTIMER_TASK_PRIORITY                ( 2 )
+#define configTIMER_QUEUE_LENGTH                 10
+#define configTIMER_TASK_STACK_DEPTH             2048
+
+/* Set the following definitions to 1 to include the API function, or zero
+to exclude the API function. */
+#define INCLUDE_vTaskPrioritySet             1
+#define INCLUDE_uxTaskPriorityGet            1
+#define INCLUDE_vTaskDelete                  1
+#define INCLUDE_vTaskCleanUpResources        0
+#define INCLUDE_vTaskSuspend                 1
+#define INCLUDE_vTaskDelayUntil              1
+#define INCLUDE_vTaskDelay                   1
+#define INCLUDE_xTaskGetSchedulerState       1
+#define INCLUDE_xTimerPendFunctionCall       1
+#define INCLUDE_xQueueGetMutexHolder         1
+#define INCLUDE_uxTaskGetStackHighWaterMark  1
+#define INCLUDE_eTaskGetState                1
+#define INCLUDE_xTaskGetCurrentTaskHandle    1
+
+/* The POSIX port has no interrupt priorities, but the CMSIS layer
+expects these to be defined. */
+#define configKERNEL_INTERRUPT_PRIORITY          0
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY     0
+
+#define configASSERT( x ) if ((x) == 0) { vAssertCalled(__FILE__, __LINE__); }
+void vAssertCalled(const char* file, unsigned long line);
+
+#endif /* FREERTOS_CONFIG_H */
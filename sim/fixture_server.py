@@ -0,0 +1,336 @@
+#!/usr/bin/env python3
+#
+# Microvisor HTTP Communications Demo -- Host Simulator
+#
+# Copyright © 2024, KORE Wireless
+# Licence: MIT
+#
+# Local stand-in for the endpoints the demo calls. The simulator's
+# `mvSendHttpRequest()` sends every request here, keeping the URL's path.
+#
+#   GET /todos/<id>     One record from `fixtures/todos.json`, or 404
+#   GET /comments       500 generated comments, about 160KB of JSON. A
+#                       single `Range` is honoured, with `If-Range`. Any
+#                       query string is ignored
+#   POST /posts         A JSON or CBOR map, such as a telemetry batch, echoed
+#                       back as JSON with an `id` as a 201
+#
+# Records are sent as CBOR if the request's Accept header lists
+# application/cbor, otherwise as JSON.
+#
+# Records carry an ETag and a Last-Modified date, and a request whose
+# If-None-Match or If-Modified-Since shows it has the current version
+# gets a bodiless 304. With --max-age or --expires, records also carry
+# a freshness lifetime, as Cache-Control or Expires respectively.
+#
+# With --gzip, records are compressed if the request's Accept-Encoding
+# allows it, using a window no larger than the app's inflater has.
+#
+# Bodies carry a SHA-256 Content-Digest (RFC 9530) of the bytes as sent,
+# and /comments a Repr-Digest of the whole resource. With --bad-digests,
+# every digest is of something else, to exercise the app's checks.
+#
+# With --fail-every N, every Nth request for /comments gets a 503, to
+# exercise the download manager's retries.
+#
+# Usage: fixture_server.py [--port 8080] [--max-age SECONDS | --expires SECONDS]
+#                          [--gzip [--window-bits BITS]] [--fail-every N]
+#                          [--bad-digests]
+#
+
+import argparse
+import base64
+import hashlib
+import json
+import os
+import re
+import struct
+import time
+import zlib
+from email.utils import formatdate, parsedate_to_datetime
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+FIXTURE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "fixtures")
+
+
+def cbor_head(major, value):
+    if value < 24:
+        return bytes([major << 5 | value])
+    for info, size in ((24, 1), (25, 2), (26, 4), (27, 8)):
+        if value < 1 << (size * 8):
+            return bytes([major << 5 | info]) + value.to_bytes(size, "big")
+    raise ValueError("integer too large for CBOR")
+
+
+def cbor_encode(value):
+    if value is None:
+        return b"\xf6"
+    if isinstance(value, bool):
+        return b"\xf5" if value else b"\xf4"
+    if isinstance(value, int):
+        return cbor_head(0, value) if value >= 0 else cbor_head(1, -1 - value)
+    if isinstance(value, str):
+        data = value.encode("utf-8")
+        return cbor_head(3, len(data)) + data
+    if isinstance(value, list):
+        return cbor_head(4, len(value)) + b"".join(cbor_encode(item) for item in value)
+    if isinstance(value, dict):
+        return cbor_head(5, len(value)) + b"".join(cbor_encode(k) + cbor_encode(v) for k, v in value.items())
+    raise ValueError(f"can't encode {type(value).__name__} as CBOR")
+
+
+def cbor_decode(data, offset=0):
+    """Decode the CBOR item at `offset`. Returns it and the offset after it."""
+    initial = data[offset]
+    major, info = initial >> 5, initial & 0x1F
+    offset += 1
+    if major == 7:
+        if info in (20, 21, 22, 23):
+            return {20: False, 21: True, 22: None, 23: None}[info], offset
+        formats = {25: (">e", 2), 26: (">f", 4), 27: (">d", 8)}
+        if info not in formats:
+            raise ValueError("unsupported CBOR simple value")
+        fmt, size = formats[info]
+        return struct.unpack_from(fmt, data, offset)[0], offset + size
+    if info == 31:
+        if major not in (4, 5):
+            raise ValueError("unsupported indefinite-length CBOR item")
+        items = []
+        while data[offset] != 0xFF:
+            item, offset = cbor_decode(data, offset)
+            items.append(item)
+        offset += 1
+        return (items if major == 4 else dict(zip(items[::2], items[1::2]))), offset
+    if info < 24:
+        argument = info
+    elif info <= 27:
+        size = 1 << (info - 24)
+        argument = int.from_bytes(data[offset:offset + size], "big")
+        offset += size
+    else:
+        raise ValueError("reserved CBOR additional information")
+    if major == 0:
+        return argument, offset
+    if major == 1:
+        return -1 - argument, offset
+    if major in (2, 3):
+        payload = bytes(data[offset:offset + argument])
+        return (payload if major == 2 else payload.decode("utf-8")), offset + argument
+    if major == 6:
+        return cbor_decode(data, offset)
+    items = []
+    for _ in range(argument * (2 if major == 5 else 1)):
+        item, offset = cbor_decode(data, offset)
+        items.append(item)
+    return (items if major == 4 else dict(zip(items[::2], items[1::2]))), offset
+
+
+def load_todos():
+    with open(os.path.join(FIXTURE_DIR, "todos.json"), "r", encoding="utf-8") as file:
+        return {todo["id"]: todo for todo in json.load(file)}
+
+
+def make_comments():
+    words = ("lorem ipsum dolor sit amet consectetur adipiscing elit sed do eiusmod tempor "
+             "incididunt ut labore et dolore magna aliqua enim ad minim veniam quis nostrud").split()
+    comments = []
+    for id in range(1, 501):
+        text = " ".join(words[(id * 7 + i * 3) % len(words)] for i in range(30))
+        comments.append({
+            "postId": (id + 4) // 5,
+            "id": id,
+            "name": " ".join(words[(id + i) % len(words)] for i in range(5)),
+            "email": f"user{id}@example.com",
+            "body": text,
+        })
+    return json.dumps(comments, indent=2).encode("utf-8")
+
+
+def parse_range(header, length):
+    """Parse a single byte range. Returns (first, last), None if the header
+    should be ignored, or False if the range can't be satisfied."""
+    match = re.fullmatch(r"\s*bytes=(\d*)-(\d*)\s*", header)
+    if match is None or match.group(1) == match.group(2) == "":
+        return None
+    if match.group(1) == "":
+        suffix = int(match.group(2))
+        return (max(length - suffix, 0), length - 1) if suffix > 0 else False
+    first = int(match.group(1))
+    last = int(match.group(2)) if match.group(2) != "" else length - 1
+    if first >= length:
+        return False
+    if last < first:
+        return None
+    return first, min(last, length - 1)
+
+
+class FixtureHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "mv-fixture/1.0"
+    todos = load_todos()
+    comments = make_comments()
+    comments_etag = '"' + hashlib.sha1(comments).hexdigest()[:16] + '"'
+    started = int(time.time())
+
+    def log_message(self, format, *args):
+        if not self.server.quiet:
+            super().log_message(format, *args)
+
+    def digest_field(self, data):
+        if self.server.bad_digests:
+            data += b"!"
+        return "sha-256=:" + base64.b64encode(hashlib.sha256(data).digest()).decode("ascii") + ":"
+
+    def send_body(self, status, body, content_type="application/json; charset=utf-8", headers=None):
+        self.send_response(status)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        if body:
+            self.send_header("Content-Digest", self.digest_field(body))
+        for name, value in (headers or {}).items():
+            self.send_header(name, value)
+        self.end_headers()
+        if self.command != "HEAD":
+            self.wfile.write(body)
+
+    def not_modified(self, etag):
+        if_none_match = self.headers.get("If-None-Match")
+        if if_none_match is not None:
+            return etag in [tag.strip() for tag in if_none_match.split(",")] or if_none_match.strip() == "*"
+        if_modified_since = self.headers.get("If-Modified-Since")
+        if if_modified_since is not None:
+            try:
+                return parsedate_to_datetime(if_modified_since).timestamp() >= self.started
+            except (TypeError, ValueError):
+                return False
+        return False
+
+    def content_encode(self, body, headers):
+        accepted = [coding.split(";")[0].strip().lower() for coding in self.headers.get("Accept-Encoding", "").split(",")]
+        for coding, wbits in (("gzip", 16), ("deflate", 0)):
+            if coding in accepted:
+                compressor = zlib.compressobj(9, zlib.DEFLATED, wbits + self.server.window_bits)
+                headers["Content-Encoding"] = coding
+                return compressor.compress(body) + compressor.flush()
+        return body
+
+    def send_comments(self):
+        self.server.comment_requests += 1
+        if self.server.fail_every and self.server.comment_requests % self.server.fail_every == 0:
+            self.send_body(503, b"{}", headers={"Retry-After": "2"})
+            return
+
+        body = self.comments
+        headers = {"ETag": self.comments_etag, "Accept-Ranges": "bytes", "Repr-Digest": self.digest_field(body)}
+        range_header = self.headers.get("Range")
+        if_range = self.headers.get("If-Range")
+        if range_header is not None and (if_range is None or if_range.strip() == self.comments_etag):
+            span = parse_range(range_header, len(body))
+            if span is False:
+                headers["Content-Range"] = f"bytes */{len(body)}"
+                self.send_body(416, b"", headers=headers)
+                return
+            if span is not None:
+                first, last = span
+                headers["Content-Range"] = f"bytes {first}-{last}/{len(body)}"
+                self.send_body(206, body[first:last + 1], headers=headers)
+                return
+
+        self.send_body(200, body, headers=headers)
+
+    def do_GET(self):
+        if self.path.split("?")[0] == "/comments":
+            self.send_comments()
+            return
+
+        match = re.fullmatch(r"/todos/(\d+)", self.path)
+        if match and int(match.group(1)) in self.todos:
+            todo = self.todos[int(match.group(1))]
+            content_type = "application/json; charset=utf-8"
+            if "application/cbor" in self.headers.get("Accept", ""):
+                body = cbor_encode(todo)
+                content_type = "application/cbor"
+            else:
+                body = json.dumps(todo, indent=2).encode("utf-8")
+            validators = {
+                "ETag": '"' + hashlib.sha1(body).hexdigest()[:16] + '"',
+                "Last-Modified": formatdate(self.started, usegmt=True),
+            }
+
+            if self.server.max_age is not None:
+                validators["Cache-Control"] = f"max-age={self.server.max_age}"
+            elif self.server.expires is not None:
+                validators["Expires"] = formatdate(time.time() + self.server.expires, usegmt=True)
+
+            if self.server.gzip:
+                validators["Vary"] = "Accept-Encoding"
+                body = self.content_encode(body, validators)
+
+            if self.not_modified(validators["ETag"]):
+                self.send_response(304)
+                for name, value in validators.items():
+                    self.send_header(name, value)
+                self.end_headers()
+                return
+
+            self.send_body(200, body, content_type=content_type, headers=validators)
+            return
+
+        self.send_body(404, b"{}")
+
+    def do_POST(self):
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        if self.path != "/posts":
+            self.send_body(404, b"{}")
+            return
+
+        try:
+            if self.headers.get("Content-Type", "").startswith("application/cbor"):
+                document, end = cbor_decode(body)
+                if end != len(body):
+                    raise ValueError("trailing bytes after CBOR item")
+            else:
+                document = json.loads(body)
+        except (ValueError, IndexError, UnicodeDecodeError, struct.error):
+            self.send_body(400, b"{}")
+            return
+
+        if not isinstance(document, dict):
+            self.send_body(400, b"{}")
+            return
+
+        document["id"] = 101
+        self.send_body(201, json.dumps(document).encode("utf-8"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Fixture server for the Microvisor HTTP demo simulator")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--quiet", action="store_true", help="Don't log each request")
+    parser.add_argument("--max-age", type=int, help="Send Cache-Control: max-age with records")
+    parser.add_argument("--expires", type=int, help="Send Expires this many seconds ahead with records")
+    parser.add_argument("--gzip", action="store_true", help="Compress records for clients that accept it")
+    parser.add_argument("--window-bits", type=int, default=10, choices=range(9, 16),
+                        help="Compression window, at most the app's INFLATE_WINDOW_BITS")
+    parser.add_argument("--fail-every", type=int, default=0, help="Send a 503 for every Nth request for /comments")
+    parser.add_argument("--bad-digests", action="store_true", help="Send digests that don't match the bodies")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("127.0.0.1", args.port), FixtureHandler)
+    server.quiet = args.quiet
+    server.max_age = args.max_age
+    server.expires = args.expires
+    server.gzip = args.gzip
+    server.window_bits = args.window_bits
+    server.fail_every = args.fail_every
+    server.bad_digests = args.bad_digests
+    server.comment_requests = 0
+    print(f"Fixture server listening on 127.0.0.1:{args.port}")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,43 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _CMSIS_COMPILER_H_
+#define _CMSIS_COMPILER_H_
+
+
+/*
+ * NOTE Host stand-in for CMSIS' `cmsis_compiler.h`: just the attribute
+ *      macros `cmsis_os2.c` uses, mapped onto GCC/Clang for the host.
+ */
+#ifndef __ASM
+#define     __ASM                       __asm
+#endif
+#ifndef __INLINE
+#define     __INLINE                    inline
+#endif
+#ifndef __STATIC_INLINE
+#define     __STATIC_INLINE             static inline
+#endif
+#ifndef __STATIC_FORCEINLINE
+#define     __STATIC_FORCEINLINE        __attribute__((always_inline)) static inline
+#endif
+#ifndef __NO_RETURN
+#define     __NO_RETURN                 __attribute__((__noreturn__))
+#endif
+#ifndef __USED
+#define     __USED                      __attribute__((used))
+#endif
+#ifndef __WEAK
+#define     __WEAK                      __attribute__((weak))
+#endif
+#ifndef __ALIGNED
+#define     __ALIGNED(x)                __attribute__((aligned(x)))
+#endif
+
+
+#endif      // _CMSIS_COMPILER_H_
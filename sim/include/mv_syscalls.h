@@ -0,0 +1,229 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _MV_SYSCALLS_H_
+#define _MV_SYSCALLS_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * NOTE This is a host-side stand-in for the Microvisor SDK's `mv_syscalls.h`.
+ *      It declares only the types and calls the demo uses, with the same
+ *      names and layouts, so that the files in `app/` compile unchanged.
+ *      The calls themselves are implemented in `sim/src/mv_syscalls.c`.
+ */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * HANDLES
+ */
+typedef uint32_t MvNotificationHandle;
+typedef uint32_t MvNetworkHandle;
+typedef uint32_t MvChannelHandle;
+typedef uint32_t MvSystemEventHandle;
+
+
+/*
+ * ENUMERATIONS
+ */
+enum MvStatus {
+    MV_STATUS_OKAY = 0,
+    MV_STATUS_UNAVAILABLE,
+    MV_STATUS_INVALIDHANDLE,
+    MV_STATUS_INVALIDBUFFER,
+    MV_STATUS_PARAMETERFAULT,
+    MV_STATUS_TOOMANYNOTIFICATIONBUFFERS,
+    MV_STATUS_CHANNELCLOSED,
+    MV_STATUS_RESPONSENOTPRESENT,
+    MV_STATUS_HEADERINDEXINVALID,
+    MV_STATUS_OFFSETINVALID,
+    MV_STATUS_LOGGINGNOTINITIALIZED,
+    MV_STATUS_INVALIDINTERRUPT
+};
+
+enum MvEventType {
+    MV_EVENTTYPE_NONE = 0,
+    MV_EVENTTYPE_NETWORKSTATUSCHANGED,
+    MV_EVENTTYPE_CHANNELDATAREADABLE,
+    MV_EVENTTYPE_CHANNELDATAWRITESPACE,
+    MV_EVENTTYPE_CHANNELNOTCONNECTED,
+    MV_EVENTTYPE_UPDATEDOWNLOADED
+};
+
+enum MvNetworkStatus {
+    MV_NETWORKSTATUS_DELIBERATELYOFFLINE = 0,
+    MV_NETWORKSTATUS_CONNECTED,
+    MV_NETWORKSTATUS_CONNECTING
+};
+
+enum MvChannelType {
+    MV_CHANNELTYPE_OPAQUEBYTES = 0,
+    MV_CHANNELTYPE_HTTP,
+    MV_CHANNELTYPE_MQTT
+};
+
+enum MvClosureReason {
+    MV_CLOSUREREASON_NOREASON = 0,
+    MV_CLOSUREREASON_CHANNELRETIRED,
+    MV_CLOSUREREASON_NETWORKCONNECTIONLOST
+};
+
+enum MvHttpResult {
+    MV_HTTPRESULT_OK = 0,
+    MV_HTTPRESULT_UNSUPPORTEDURISCHEME,
+    MV_HTTPRESULT_UNSUPPORTEDMETHOD,
+    MV_HTTPRESULT_INVALIDHEADERS,
+    MV_HTTPRESULT_INVALIDTIMEOUT,
+    MV_HTTPRESULT_REQUESTFAILED,
+    MV_HTTPRESULT_RESPONSETOOLARGE
+};
+
+enum MvSystemNotificationSource {
+    MV_SYSTEMNOTIFICATIONSOURCE_UPDATE = 1
+};
+
+enum MvRestartMode {
+    MV_RESTARTMODE_NORMAL = 0,
+    MV_RESTARTMODE_AUTOAPPLYUPDATE
+};
+
+enum MvWakeReason {
+    MV_WAKEREASON_COLDBOOT = 0
+};
+
+
+/*
+ * STRUCTURES
+ */
+struct MvNotification {
+    uint64_t            microseconds;
+    enum MvEventType    event_type;
+    uint32_t            tag;
+};
+
+struct MvNotificationSetup {
+    uint32_t                irq;
+    struct MvNotification*  buffer;
+    uint32_t                buffer_size;
+};
+
+struct MvSizedString {
+    const uint8_t*  data;
+    uint32_t        length;
+};
+
+struct MvRequestNetworkParams {
+    uint32_t version;
+    union {
+        struct {
+            MvNotificationHandle    notification_handle;
+            uint32_t                notification_tag;
+        } v1;
+    };
+};
+
+struct MvOpenChannelParams {
+    uint32_t version;
+    union {
+        struct {
+            MvNotificationHandle    notification_handle;
+            uint32_t                notification_tag;
+            MvNetworkHandle         network_handle;
+            uint8_t*                receive_buffer;
+            uint32_t                receive_buffer_len;
+            uint8_t*                send_buffer;
+            uint32_t                send_buffer_len;
+            enum MvChannelType      channel_type;
+            struct MvSizedString    endpoint;
+        } v1;
+    };
+};
+
+struct MvHttpHeader {
+    const uint8_t*  data;
+    uint32_t        length;
+};
+
+struct MvHttpRequest {
+    struct MvSizedString        method;
+    struct MvSizedString        url;
+    uint32_t                    num_headers;
+    const struct MvHttpHeader*  headers;
+    struct MvSizedString        body;
+    uint32_t                    timeout_ms;
+};
+
+struct MvHttpResponseData {
+    enum MvHttpResult   result;
+    uint32_t            status_code;
+    uint32_t            num_headers;
+    uint32_t            body_length;
+};
+
+struct MvOpenSystemNotificationParams {
+    MvNotificationHandle            notification_handle;
+    uint32_t                        notification_tag;
+    enum MvSystemNotificationSource notification_source;
+};
+
+
+/*
+ * SYSTEM CALLS
+ */
+// Notifications
+enum MvStatus mvSetupNotifications(const struct MvNotificationSetup* setup, MvNotificationHandle* handle);
+enum MvStatus mvCloseNotifications(MvNotificationHandle* handle);
+enum MvStatus mvOpenSystemNotification(const struct MvOpenSystemNotificationParams* params, MvSystemEventHandle* handle);
+
+// Networking
+enum MvStatus mvRequestNetwork(const struct MvRequestNetworkParams* params, MvNetworkHandle* handle);
+enum MvStatus mvReleaseNetwork(MvNetworkHandle* handle);
+enum MvStatus mvGetNetworkStatus(MvNetworkHandle handle, enum MvNetworkStatus* status);
+
+// Channels
+enum MvStatus mvOpenChannel(const struct MvOpenChannelParams* params, MvChannelHandle* handle);
+enum MvStatus mvCloseChannel(MvChannelHandle* handle);
+enum MvStatus mvGetChannelClosureReason(MvChannelHandle handle, enum MvClosureReason* reason);
+
+// HTTP
+enum MvStatus mvSendHttpRequest(MvChannelHandle handle, const struct MvHttpRequest* request);
+enum MvStatus mvReadHttpResponseData(MvChannelHandle handle, struct MvHttpResponseData* response);
+enum MvStatus mvReadHttpResponseHeader(MvChannelHandle handle, uint32_t index, uint8_t* buffer, uint32_t size);
+enum MvStatus mvReadHttpResponseBody(MvChannelHandle handle, uint32_t offset, uint8_t* buffer, uint32_t size);
+
+// Logging
+enum MvStatus mvServerLoggingInit(uint8_t* buffer, uint32_t size);
+enum MvStatus mvServerLog(const uint8_t* message, uint16_t length);
+
+// System
+enum MvStatus mvGetDeviceId(uint8_t* buffer, uint32_t size);
+enum MvStatus mvGetWakeReason(enum MvWakeReason* reason);
+enum MvStatus mvGetHClk(uint32_t* hclk);
+enum MvStatus mvGetMicroseconds(uint64_t* usec);
+enum MvStatus mvGetWallTime(uint64_t* usec);
+enum MvStatus mvSystemLedEnable(uint32_t enable);
+enum MvStatus mvRestart(enum MvRestartMode mode);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _MV_SYSCALLS_H_
@@ -0,0 +1,89 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _SIM_DEVICE_H_
+#define _SIM_DEVICE_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include "cmsis_compiler.h"
+
+
+/*
+ * NOTE Host stand-in for the STM32U585 CMSIS device header. It provides
+ *      the interrupt numbers the app uses and an NVIC whose 'interrupts'
+ *      are run by `sim/src/hal.c` from the FreeRTOS tick hook, which is
+ *      interrupt context in the POSIX port.
+ */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * TYPES
+ */
+typedef enum {
+    SVCall_IRQn     = -5,
+    TIM1_BRK_IRQn   = 24,
+    TIM2_IRQn       = 28,
+    TIM6_IRQn       = 32,
+    TIM8_BRK_IRQn   = 36,
+    SIM_IRQn_COUNT  = 64
+} IRQn_Type;
+
+// `cmsis_os2.c` reads SysTick to derive a sub-tick timer count
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+    volatile uint32_t CALIB;
+} SysTick_Type;
+
+
+/*
+ * GLOBALS
+ */
+extern SysTick_Type sim_systick;
+// Not a macro, so `cmsis_os2.c` doesn't install its own SysTick_Handler
+static SysTick_Type* const SysTick = &sim_systick;
+extern uint32_t SystemCoreClock;
+
+
+/*
+ * PROTOTYPES
+ */
+void        NVIC_EnableIRQ(IRQn_Type irq);
+void        NVIC_DisableIRQ(IRQn_Type irq);
+void        NVIC_ClearPendingIRQ(IRQn_Type irq);
+void        NVIC_SetPendingIRQ(IRQn_Type irq);
+void        NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+
+uint32_t    __get_IPSR(void);
+uint32_t    __get_PRIMASK(void);
+uint32_t    __get_BASEPRI(void);
+void        __enable_irq(void);
+void        __disable_irq(void);
+
+void        SystemCoreClockUpdate(void);
+
+// Simulator hooks
+void        sim_dispatch_irqs(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _SIM_DEVICE_H_
@@ -0,0 +1,139 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _STM32U5XX_HAL_H_
+#define _STM32U5XX_HAL_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "sim_device.h"
+
+
+/*
+ * NOTE Host stand-in for the STM32U5 HAL. Only the pieces the app touches
+ *      are present: GPIO writes are dropped and the tick is taken from the
+ *      host's monotonic clock. See `sim/src/hal.c`. Flash is backed by a
+ *      file mapped into memory, so it persists between runs. See
+ *      `sim/src/flash.c`.
+ */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * CONSTANTS
+ */
+#define     TICK_INT_PRIORITY           15U
+
+#define     GPIO_PIN_5                  ((uint16_t)0x0020)
+#define     GPIO_MODE_OUTPUT_PP         0x00000001U
+#define     GPIO_PULLUP                 0x00000001U
+#define     GPIO_SPEED_FREQ_VERY_HIGH   0x00000003U
+
+#define     GPIOA                       (&sim_gpio[0])
+#define     GPIOD                       (&sim_gpio[3])
+
+#define     __HAL_RCC_GPIOA_CLK_ENABLE()    do { } while (0);
+
+// The STM32U585's 2MB of flash: two banks of 128 8KB pages. Addresses are
+// host pointers, so `FLASH_BASE` is wherever the backing file is mapped
+#define     FLASH_BASE                  sim_flash_base()
+#define     FLASH_PAGE_SIZE             0x2000U
+#define     FLASH_PAGE_NB               128U
+#define     FLASH_BANK_SIZE             (FLASH_PAGE_NB * FLASH_PAGE_SIZE)
+#define     FLASH_SIZE                  (2 * FLASH_BANK_SIZE)
+#define     FLASH_BANK_1                0x00000001U
+#define     FLASH_BANK_2                0x00000002U
+#define     FLASH_TYPEERASE_PAGES       0x00000000U
+#define     FLASH_TYPEPROGRAM_QUADWORD  0x00000001U
+
+
+/*
+ * TYPES
+ */
+typedef enum {
+    HAL_OK       = 0x00,
+    HAL_ERROR    = 0x01,
+    HAL_BUSY     = 0x02,
+    HAL_TIMEOUT  = 0x03
+} HAL_StatusTypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef struct {
+    void* Instance;
+} UART_HandleTypeDef;
+
+typedef struct {
+    uint32_t TypeErase;
+    uint32_t Banks;
+    uint32_t Page;
+    uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+// Simulator flash operation counts
+typedef struct {
+    uint32_t    erases;
+    uint32_t    programs;
+    uint32_t    errors;
+} SimFlashStats;
+
+
+/*
+ * GLOBALS
+ */
+extern GPIO_TypeDef sim_gpio[4];
+
+
+/*
+ * PROTOTYPES
+ */
+HAL_StatusTypeDef   HAL_Init(void);
+HAL_StatusTypeDef   HAL_InitTick(uint32_t priority);
+uint32_t            HAL_GetTick(void);
+void                HAL_GPIO_Init(GPIO_TypeDef* port, GPIO_InitTypeDef* init);
+void                HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state);
+
+HAL_StatusTypeDef   HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef   HAL_FLASH_Lock(void);
+HAL_StatusTypeDef   HAL_FLASH_Program(uint32_t type, uintptr_t address, uintptr_t data_address);
+HAL_StatusTypeDef   HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* erase, uint32_t* page_error);
+
+// Simulator hooks
+uintptr_t           sim_flash_base(void);
+const SimFlashStats* sim_flash_get_stats(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _STM32U5XX_HAL_H_
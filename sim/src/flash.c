@@ -0,0 +1,151 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "stm32u5xx_hal.h"
+
+
+/*
+ * NOTE Host stand-in for the STM32U5's flash and its HAL calls. The flash
+ *      is a file mapped into memory, so what the app stores persists from
+ *      one run to the next, as it would across device restarts, and the
+ *      app reads it in place, as it would memory-mapped flash.
+ *
+ *      As on the device, flash must be unlocked to change it, erasing sets
+ *      a page's bytes to 0xFF, and only erased quad-words may be programmed.
+ *      Breaking these rules fails the call and is counted.
+ *
+ *      Environment variables:
+ *          MV_SIM_FLASH_FILE       The backing file (mv-sim-flash.bin)
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     SIM_FLASH_DEFAULT_FILE      "mv-sim-flash.bin"
+#define     SIM_FLASH_QUAD_WORD_B       16
+
+
+/*
+ * GLOBALS
+ */
+static uint8_t*         sim_flash = NULL;
+static bool             sim_flash_locked = true;
+static SimFlashStats    sim_flash_stats = { 0 };
+
+
+/**
+ * @brief Map the backing file, creating it, fully erased, if need be.
+ *
+ * @returns The address of the start of flash.
+ */
+uintptr_t sim_flash_base(void) {
+
+    if (sim_flash != NULL) return (uintptr_t)sim_flash;
+
+    const char* path = getenv("MV_SIM_FLASH_FILE");
+    if (path == NULL || *path == '\0') path = SIM_FLASH_DEFAULT_FILE;
+
+    int file = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat info;
+    if (file < 0 || fstat(file, &info) != 0) {
+        fprintf(stderr, "[SIM] Could not open flash file %s\n", path);
+        exit(1);
+    }
+
+    bool fresh = info.st_size != FLASH_SIZE;
+    if (fresh && ftruncate(file, FLASH_SIZE) != 0) {
+        fprintf(stderr, "[SIM] Could not size flash file %s\n", path);
+        exit(1);
+    }
+
+    sim_flash = mmap(NULL, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (sim_flash == MAP_FAILED) {
+        fprintf(stderr, "[SIM] Could not map flash file %s\n", path);
+        exit(1);
+    }
+
+    if (fresh) memset(sim_flash, 0xFF, FLASH_SIZE);
+    return (uintptr_t)sim_flash;
+}
+
+
+/**
+ * @brief Provide the flash operation counts.
+ *
+ * @returns The counts.
+ */
+const SimFlashStats* sim_flash_get_stats(void) {
+
+    return &sim_flash_stats;
+}
+
+
+/*
+ * HAL
+ */
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+
+    sim_flash_locked = false;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+
+    sim_flash_locked = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uintptr_t address, uintptr_t data_address) {
+
+    uintptr_t base = sim_flash_base();
+    if (sim_flash_locked || type != FLASH_TYPEPROGRAM_QUADWORD || address < base
+        || address + SIM_FLASH_QUAD_WORD_B > base + FLASH_SIZE || (address - base) % SIM_FLASH_QUAD_WORD_B != 0) {
+        sim_flash_stats.errors++;
+        return HAL_ERROR;
+    }
+
+    uint8_t* target = (uint8_t*)address;
+    for (uint32_t i = 0 ; i < SIM_FLASH_QUAD_WORD_B ; ++i) {
+        if (target[i] != 0xFF) {
+            // The device reports a programming error
+            sim_flash_stats.errors++;
+            return HAL_ERROR;
+        }
+    }
+
+    memcpy(target, (const void*)data_address, SIM_FLASH_QUAD_WORD_B);
+    sim_flash_stats.programs++;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* erase, uint32_t* page_error) {
+
+    uintptr_t base = sim_flash_base();
+    *page_error = 0xFFFFFFFF;
+    if (sim_flash_locked || erase->TypeErase != FLASH_TYPEERASE_PAGES
+        || (erase->Banks != FLASH_BANK_1 && erase->Banks != FLASH_BANK_2)
+        || erase->Page + erase->NbPages > FLASH_PAGE_NB) {
+        sim_flash_stats.errors++;
+        return HAL_ERROR;
+    }
+
+    uint32_t bank_offset = erase->Banks == FLASH_BANK_2 ? FLASH_BANK_SIZE : 0;
+    memset((void*)(base + bank_offset + erase->Page * FLASH_PAGE_SIZE), 0xFF, erase->NbPages * FLASH_PAGE_SIZE);
+    sim_flash_stats.erases += erase->NbPages;
+    return HAL_OK;
+}
@@ -0,0 +1,218 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "stm32u5xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+
+/*
+ * NOTE Simulated interrupts. `NVIC_SetPendingIRQ()` may be called from any
+ *      host thread (the HTTP workers in `mv_syscalls.c` do so); pending,
+ *      enabled IRQs are then run from the FreeRTOS tick hook, which is the
+ *      POSIX port's interrupt context, so handlers can use the `...FromISR()`
+ *      calls exactly as they would on the device. `__get_IPSR()` reports the
+ *      active IRQ so CMSIS-RTOS2 picks its ISR code paths too.
+ */
+
+
+/*
+ * GLOBALS
+ */
+SysTick_Type    sim_systick = { 0, 159999, 0, 0 };
+GPIO_TypeDef    sim_gpio[4];
+uint32_t        SystemCoreClock = 160000000;
+
+static volatile uint64_t        sim_irq_enabled = 0;
+static volatile uint64_t        sim_irq_pending = 0;
+static _Thread_local uint32_t   sim_ipsr = 0;
+static struct timespec          sim_epoch;
+
+// Handlers the app may provide. Weak, so any the app doesn't define are NULL
+extern void TIM1_BRK_IRQHandler(void)   __attribute__((weak));
+extern void TIM2_IRQHandler(void)       __attribute__((weak));
+extern void TIM8_BRK_IRQHandler(void)   __attribute__((weak));
+
+
+/**
+ * @brief Map an IRQ number to the app's handler, if it has one.
+ *
+ * @param irq: The IRQ number.
+ *
+ * @returns The handler, or `NULL`.
+ */
+static void (*sim_irq_handler(uint32_t irq))(void) {
+
+    switch (irq) {
+        case TIM1_BRK_IRQn: return TIM1_BRK_IRQHandler;
+        case TIM2_IRQn:     return TIM2_IRQHandler;
+        case TIM8_BRK_IRQn: return TIM8_BRK_IRQHandler;
+        default:            return NULL;
+    }
+}
+
+
+/*
+ * NVIC
+ */
+void NVIC_EnableIRQ(IRQn_Type irq) {
+
+    if (irq >= 0) __atomic_or_fetch(&sim_irq_enabled, 1ULL << irq, __ATOMIC_SEQ_CST);
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq) {
+
+    if (irq >= 0) __atomic_and_fetch(&sim_irq_enabled, ~(1ULL << irq), __ATOMIC_SEQ_CST);
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq) {
+
+    if (irq >= 0) __atomic_and_fetch(&sim_irq_pending, ~(1ULL << irq), __ATOMIC_SEQ_CST);
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type irq) {
+
+    if (irq >= 0) __atomic_or_fetch(&sim_irq_pending, 1ULL << irq, __ATOMIC_SEQ_CST);
+}
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) {
+
+    (void)irq;
+    (void)priority;
+}
+
+uint32_t __get_IPSR(void) {
+
+    return sim_ipsr;
+}
+
+uint32_t __get_PRIMASK(void) {
+
+    return 0;
+}
+
+uint32_t __get_BASEPRI(void) {
+
+    return 0;
+}
+
+void __enable_irq(void) {
+
+    // NOP -- the POSIX port masks its own 'interrupts'
+}
+
+void __disable_irq(void) {
+
+    // NOP
+}
+
+
+/**
+ * @brief Run the handlers of all pending, enabled IRQs.
+ */
+void sim_dispatch_irqs(void) {
+
+    uint64_t ready = __atomic_load_n(&sim_irq_pending, __ATOMIC_SEQ_CST) & sim_irq_enabled;
+    while (ready != 0) {
+        uint32_t irq = (uint32_t)__builtin_ctzll(ready);
+        ready &= ~(1ULL << irq);
+        __atomic_and_fetch(&sim_irq_pending, ~(1ULL << irq), __ATOMIC_SEQ_CST);
+
+        void (*handler)(void) = sim_irq_handler(irq);
+        if (handler != NULL) {
+            // Exception numbers are offset from IRQ numbers by 16
+            sim_ipsr = irq + 16;
+            handler();
+            sim_ipsr = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief FreeRTOS tick hook -- interrupt context in the POSIX port.
+ */
+void vApplicationTickHook(void) {
+
+    sim_dispatch_irqs();
+}
+
+
+/**
+ * @brief FreeRTOS `configASSERT()` target.
+ */
+void vAssertCalled(const char* file, unsigned long line) {
+
+    fprintf(stderr, "[SIM] FreeRTOS assertion failed at %s:%lu\n", file, line);
+    abort();
+}
+
+
+/*
+ * HAL
+ */
+HAL_StatusTypeDef HAL_Init(void) {
+
+    clock_gettime(CLOCK_MONOTONIC, &sim_epoch);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_InitTick(uint32_t priority) {
+
+    (void)priority;
+    return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t ms = (int64_t)(now.tv_sec - sim_epoch.tv_sec) * 1000 + (now.tv_nsec - sim_epoch.tv_nsec) / 1000000;
+    return (uint32_t)ms;
+}
+
+void SystemCoreClockUpdate(void) {
+
+    // NOP -- fixed at 160MHz
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef* port, GPIO_InitTypeDef* init) {
+
+    (void)port;
+    (void)init;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state) {
+
+    if (state == GPIO_PIN_SET) {
+        port->ODR |= pin;
+    } else {
+        port->ODR &= ~(uint32_t)pin;
+    }
+}
+
+
+/*
+ * UART LOGGING
+ *
+ * `app/uart_logging.c` drives a real UART, so it isn't built for the host.
+ * Server log output already goes to stdout -- see `mvServerLog()`.
+ */
+bool log_uart_init(void) {
+
+    return false;
+}
+
+void log_uart_output(const char* buffer) {
+
+    (void)buffer;
+}
@@ -0,0 +1,947 @@
+/**
+ *
+ * Microvisor HTTP Communications Demo -- Host Simulator
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "stm32u5xx_hal.h"
+#include "mv_syscalls.h"
+
+
+/*
+ * NOTE Host implementation of the Microvisor system calls the demo uses.
+ *
+ *      HTTP requests are executed by a worker thread per request against a
+ *      local fixture server (see `sim/fixture_server.py`): the scheme and
+ *      host of every URL are swapped for MV_SIM_HTTP_ORIGIN, the path is
+ *      kept. When the response is in, a notification record is written to
+ *      the channel's notification center and its IRQ is pended, just as
+ *      Microvisor does. The app then reads the response with the usual calls.
+ *
+ *      Environment variables:
+ *          MV_SIM_HTTP_ORIGIN      Fixture server `host:port` (127.0.0.1:8080)
+ *          MV_SIM_LATENCY_MS       Extra round-trip latency per request (0)
+ *          MV_SIM_CHANNEL_SETUP_MS Extra latency on a channel's first request,
+ *                                  standing in for connection setup (0)
+ *          MV_SIM_NETWORK_ATTACH_MS Time from requesting the network to it
+ *                                  connecting, standing in for a modem
+ *                                  attach. Channels can't be opened until
+ *                                  then (0)
+ *          MV_SIM_NETWORK_DROP_AT_MS Drop the network this long after
+ *                                  startup, closing every open channel (0)
+ *          MV_SIM_NETWORK_DROP_MS  How long the network stays down (0 = no drop)
+ *          MV_SIM_MAX_REQUESTS     Exit with a timing summary after this many
+ *                                  responses have been read (0 = run forever)
+ *
+ *      Timing covers the full cycle: send -> response readable (round trip),
+ *      readable -> first `mvReadHttpResponseData()` (app wake-up latency).
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     SIM_MAX_NOTIFICATION_CENTERS    8
+#define     SIM_MAX_CHANNELS                16
+#define     SIM_MAX_RESPONSE_HEADERS        64
+#define     SIM_DEFAULT_ORIGIN              "127.0.0.1:8080"
+#define     SIM_NETWORK_HANDLE              1
+
+
+/*
+ * TYPES
+ */
+typedef struct {
+    bool                    in_use;
+    IRQn_Type               irq;
+    struct MvNotification*  buffer;
+    uint32_t                count;
+    uint32_t                write_index;
+    uint32_t                overwritten;
+} SimNotificationCenter;
+
+typedef struct {
+    char*       method;
+    char*       url;
+    char*       headers;
+    uint8_t*    body;
+    uint32_t    body_length;
+    uint32_t    timeout_ms;
+} SimRequest;
+
+typedef struct {
+    MvChannelHandle             handle;
+    MvNotificationHandle        notification_handle;
+    uint32_t                    notification_tag;
+    uint32_t                    rx_buffer_len;
+    uint32_t                    generation;
+    bool                        in_flight;
+    bool                        used;
+    bool                        disconnected;
+    // Response
+    bool                        has_response;
+    bool                        response_read;
+    struct MvHttpResponseData   data;
+    char*                       header_lines[SIM_MAX_RESPONSE_HEADERS];
+    uint8_t*                    body;
+    // Timing
+    uint64_t                    sent_us;
+    uint64_t                    readable_us;
+} SimChannel;
+
+typedef struct {
+    SimChannel* channel;
+    uint32_t    generation;
+    uint32_t    delay_ms;
+    SimRequest  request;
+} SimJob;
+
+
+/*
+ * GLOBALS
+ */
+static pthread_mutex_t          sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static SimNotificationCenter    sim_centers[SIM_MAX_NOTIFICATION_CENTERS];
+static SimChannel               sim_channels[SIM_MAX_CHANNELS];
+static MvChannelHandle          sim_next_channel_handle = 0x100;
+static MvNotificationHandle     sim_net_notification_handle = 0;
+static uint32_t                 sim_net_notification_tag = 0;
+static uint64_t                 sim_net_up_us = 0;
+static uint64_t                 sim_net_down_from_us = 0;
+static uint64_t                 sim_net_down_until_us = 0;
+static bool                     sim_configured = false;
+static char                     sim_origin_host[128] = "127.0.0.1";
+static char                     sim_origin_port[16] = "8080";
+static uint32_t                 sim_latency_ms = 0;
+static uint32_t                 sim_channel_setup_ms = 0;
+static uint32_t                 sim_network_attach_ms = 0;
+static uint32_t                 sim_network_drop_at_ms = 0;
+static uint32_t                 sim_network_drop_ms = 0;
+static uint32_t                 sim_max_requests = 0;
+
+static struct {
+    uint32_t    channels_opened;
+    uint32_t    requests_sent;
+    uint32_t    responses_read;
+    uint32_t    requests_failed;
+    uint32_t    opens_refused;
+    uint32_t    channels_lost;
+    uint64_t    bytes_received;
+    uint64_t    rtt_total_us;
+    uint64_t    rtt_max_us;
+    uint64_t    wake_total_us;
+    uint64_t    wake_max_us;
+} sim_stats;
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static uint64_t     sim_now_us(void);
+static void         sim_configure(void);
+static void         sim_post_notification(MvNotificationHandle handle, enum MvEventType type, uint32_t tag);
+static bool         sim_network_connected(void);
+static void*        sim_network_worker(void* arg);
+static void*        sim_network_drop_worker(void* arg);
+static void         sim_disconnect_channels(void);
+static SimChannel*  sim_find_channel(MvChannelHandle handle);
+static void         sim_clear_response(SimChannel* channel);
+static void*        sim_http_worker(void* arg);
+static bool         sim_http_exchange(const SimRequest* request, char** response, size_t* response_length);
+static void         sim_parse_response(SimChannel* channel, char* raw, size_t raw_length);
+static void         sim_check_finished(void);
+static void         sim_print_summary(void);
+
+
+/**
+ * @brief Host monotonic time in microseconds.
+ */
+static uint64_t sim_now_us(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_nsec / 1000ULL;
+}
+
+
+/**
+ * @brief Read the simulator's environment settings, once.
+ *
+ * Call with `sim_lock` held.
+ */
+static void sim_configure(void) {
+
+    if (sim_configured) return;
+    sim_configured = true;
+
+    const char* origin = getenv("MV_SIM_HTTP_ORIGIN");
+    if (origin == NULL || *origin == 0) origin = SIM_DEFAULT_ORIGIN;
+    const char* colon = strrchr(origin, ':');
+    if (colon != NULL) {
+        snprintf(sim_origin_host, sizeof(sim_origin_host), "%.*s", (int)(colon - origin), origin);
+        snprintf(sim_origin_port, sizeof(sim_origin_port), "%s", colon + 1);
+    } else {
+        snprintf(sim_origin_host, sizeof(sim_origin_host), "%s", origin);
+    }
+
+    const char* value = getenv("MV_SIM_LATENCY_MS");
+    if (value != NULL) sim_latency_ms = (uint32_t)strtoul(value, NULL, 10);
+    value = getenv("MV_SIM_CHANNEL_SETUP_MS");
+    if (value != NULL) sim_channel_setup_ms = (uint32_t)strtoul(value, NULL, 10);
+    value = getenv("MV_SIM_NETWORK_ATTACH_MS");
+    if (value != NULL) sim_network_attach_ms = (uint32_t)strtoul(value, NULL, 10);
+    value = getenv("MV_SIM_NETWORK_DROP_AT_MS");
+    if (value != NULL) sim_network_drop_at_ms = (uint32_t)strtoul(value, NULL, 10);
+    value = getenv("MV_SIM_NETWORK_DROP_MS");
+    if (value != NULL) sim_network_drop_ms = (uint32_t)strtoul(value, NULL, 10);
+    value = getenv("MV_SIM_MAX_REQUESTS");
+    if (value != NULL) sim_max_requests = (uint32_t)strtoul(value, NULL, 10);
+
+    if (sim_network_drop_ms > 0) {
+        sim_net_down_from_us = sim_now_us() + (uint64_t)sim_network_drop_at_ms * 1000;
+        sim_net_down_until_us = sim_net_down_from_us + (uint64_t)sim_network_drop_ms * 1000;
+        pthread_t worker;
+        pthread_create(&worker, NULL, sim_network_drop_worker, NULL);
+        pthread_detach(worker);
+    }
+
+    atexit(sim_print_summary);
+}
+
+
+/*
+ * NOTIFICATIONS
+ */
+enum MvStatus mvSetupNotifications(const struct MvNotificationSetup* setup, MvNotificationHandle* handle) {
+
+    if (setup == NULL || handle == NULL) return MV_STATUS_PARAMETERFAULT;
+    if (setup->buffer == NULL || setup->buffer_size < sizeof(struct MvNotification)) return MV_STATUS_INVALIDBUFFER;
+
+    pthread_mutex_lock(&sim_lock);
+    sim_configure();
+    for (uint32_t i = 0 ; i < SIM_MAX_NOTIFICATION_CENTERS ; ++i) {
+        SimNotificationCenter* center = &sim_centers[i];
+        if (!center->in_use) {
+            center->in_use = true;
+            center->irq = (IRQn_Type)setup->irq;
+            center->buffer = setup->buffer;
+            center->count = setup->buffer_size / sizeof(struct MvNotification);
+            center->write_index = 0;
+            *handle = i + 1;
+            pthread_mutex_unlock(&sim_lock);
+            return MV_STATUS_OKAY;
+        }
+    }
+
+    pthread_mutex_unlock(&sim_lock);
+    return MV_STATUS_TOOMANYNOTIFICATIONBUFFERS;
+}
+
+enum MvStatus mvCloseNotifications(MvNotificationHandle* handle) {
+
+    if (handle == NULL || *handle == 0 || *handle > SIM_MAX_NOTIFICATION_CENTERS) return MV_STATUS_INVALIDHANDLE;
+
+    pthread_mutex_lock(&sim_lock);
+    sim_centers[*handle - 1].in_use = false;
+    *handle = 0;
+    pthread_mutex_unlock(&sim_lock);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvOpenSystemNotification(const struct MvOpenSystemNotificationParams* params, MvSystemEventHandle* handle) {
+
+    if (params == NULL || handle == NULL) return MV_STATUS_PARAMETERFAULT;
+    *handle = 1;
+    return MV_STATUS_OKAY;
+}
+
+
+/**
+ * @brief Write a notification record and pend the center's IRQ.
+ *
+ * Like Microvisor, records are written round-robin. A slot the app has not
+ * cleared is overwritten, and counted, so lost events show in the summary.
+ *
+ * Call with `sim_lock` held.
+ */
+static void sim_post_notification(MvNotificationHandle handle, enum MvEventType type, uint32_t tag) {
+
+    if (handle == 0 || handle > SIM_MAX_NOTIFICATION_CENTERS) return;
+    SimNotificationCenter* center = &sim_centers[handle - 1];
+    if (!center->in_use) return;
+
+    struct MvNotification* record = &center->buffer[center->write_index];
+    if (record->event_type != 0) center->overwritten++;
+    record->microseconds = sim_now_us();
+    record->tag = tag;
+    __atomic_store_n(&record->event_type, type, __ATOMIC_RELEASE);
+    center->write_index = (center->write_index + 1) % center->count;
+    NVIC_SetPendingIRQ(center->irq);
+}
+
+
+/*
+ * NETWORKING
+ */
+enum MvStatus mvRequestNetwork(const struct MvRequestNetworkParams* params, MvNetworkHandle* handle) {
+
+    if (params == NULL || handle == NULL) return MV_STATUS_PARAMETERFAULT;
+
+    pthread_mutex_lock(&sim_lock);
+    sim_configure();
+    sim_net_notification_handle = params->v1.notification_handle;
+    sim_net_notification_tag = params->v1.notification_tag;
+    *handle = SIM_NETWORK_HANDLE;
+    if (sim_net_up_us == 0) {
+        // The network connects, and says so, after the attach time
+        sim_net_up_us = sim_now_us() + (uint64_t)sim_network_attach_ms * 1000;
+        if (sim_network_attach_ms > 0) {
+            pthread_t worker;
+            pthread_create(&worker, NULL, sim_network_worker, NULL);
+            pthread_detach(worker);
+        } else {
+            sim_post_notification(sim_net_notification_handle, MV_EVENTTYPE_NETWORKSTATUSCHANGED, sim_net_notification_tag);
+        }
+    }
+
+    pthread_mutex_unlock(&sim_lock);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvReleaseNetwork(MvNetworkHandle* handle) {
+
+    if (handle == NULL || *handle != SIM_NETWORK_HANDLE) return MV_STATUS_INVALIDHANDLE;
+
+    // Channels don't outlive the network. It connects again, after the
+    // attach time, when it's next requested
+    pthread_mutex_lock(&sim_lock);
+    sim_net_up_us = 0;
+    sim_disconnect_channels();
+    pthread_mutex_unlock(&sim_lock);
+    *handle = 0;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetNetworkStatus(MvNetworkHandle handle, enum MvNetworkStatus* status) {
+
+    if (handle != SIM_NETWORK_HANDLE) return MV_STATUS_INVALIDHANDLE;
+    if (status == NULL) return MV_STATUS_PARAMETERFAULT;
+
+    pthread_mutex_lock(&sim_lock);
+    *status = sim_network_connected() ? MV_NETWORKSTATUS_CONNECTED : MV_NETWORKSTATUS_CONNECTING;
+    pthread_mutex_unlock(&sim_lock);
+    return MV_STATUS_OKAY;
+}
+
+
+/**
+ * @brief Whether the requested network has connected.
+ *
+ * Call with `sim_lock` held.
+ */
+static bool sim_network_connected(void) {
+
+    uint64_t now = sim_now_us();
+    if (now >= sim_net_down_from_us && now < sim_net_down_until_us) return false;
+    return sim_net_up_us != 0 && now >= sim_net_up_us;
+}
+
+
+/**
+ * @brief Connect the network once its attach time is up, and notify the app.
+ */
+static void* sim_network_worker(void* arg) {
+
+    usleep(sim_network_attach_ms * 1000);
+
+    pthread_mutex_lock(&sim_lock);
+    sim_post_notification(sim_net_notification_handle, MV_EVENTTYPE_NETWORKSTATUSCHANGED, sim_net_notification_tag);
+    pthread_mutex_unlock(&sim_lock);
+    return NULL;
+}
+
+
+/**
+ * @brief Drop the network for MV_SIM_NETWORK_DROP_MS, closing every open
+ *        channel, and notify the app when it goes and when it returns.
+ */
+static void* sim_network_drop_worker(void* arg) {
+
+    uint64_t now = sim_now_us();
+    if (sim_net_down_from_us > now) usleep((useconds_t)(sim_net_down_from_us - now));
+
+    pthread_mutex_lock(&sim_lock);
+    sim_disconnect_channels();
+    sim_post_notification(sim_net_notification_handle, MV_EVENTTYPE_NETWORKSTATUSCHANGED, sim_net_notification_tag);
+    pthread_mutex_unlock(&sim_lock);
+
+    now = sim_now_us();
+    if (sim_net_down_until_us > now) usleep((useconds_t)(sim_net_down_until_us - now));
+
+    pthread_mutex_lock(&sim_lock);
+    if (sim_network_connected()) {
+        sim_post_notification(sim_net_notification_handle, MV_EVENTTYPE_NETWORKSTATUSCHANGED, sim_net_notification_tag);
+    }
+
+    pthread_mutex_unlock(&sim_lock);
+    return NULL;
+}
+
+
+/**
+ * @brief Close every open channel as the network goes, failing any request
+ *        in flight, and tell the app with a channel-not-connected record.
+ *        The app must still close the channel.
+ *
+ * Call with `sim_lock` held.
+ */
+static void sim_disconnect_channels(void) {
+
+    for (uint32_t i = 0 ; i < SIM_MAX_CHANNELS ; ++i) {
+        SimChannel* channel = &sim_channels[i];
+        if (channel->handle == 0 || channel->disconnected) continue;
+
+        // Any worker still running for this channel will see the
+        // generation change and discard its result
+        if (channel->in_flight) sim_stats.requests_failed++;
+        channel->disconnected = true;
+        channel->in_flight = false;
+        channel->generation++;
+        sim_stats.channels_lost++;
+        sim_post_notification(channel->notification_handle, MV_EVENTTYPE_CHANNELNOTCONNECTED, channel->notification_tag);
+    }
+}
+
+
+/*
+ * CHANNELS
+ */
+static SimChannel* sim_find_channel(MvChannelHandle handle) {
+
+    if (handle == 0) return NULL;
+    for (uint32_t i = 0 ; i < SIM_MAX_CHANNELS ; ++i) {
+        if (sim_channels[i].handle == handle) return &sim_channels[i];
+    }
+
+    return NULL;
+}
+
+enum MvStatus mvOpenChannel(const struct MvOpenChannelParams* params, MvChannelHandle* handle) {
+
+    if (params == NULL || handle == NULL) return MV_STATUS_PARAMETERFAULT;
+    if (params->v1.network_handle != SIM_NETWORK_HANDLE) return MV_STATUS_INVALIDHANDLE;
+    if (params->v1.receive_buffer == NULL || params->v1.send_buffer == NULL) return MV_STATUS_INVALIDBUFFER;
+
+    pthread_mutex_lock(&sim_lock);
+    if (!sim_network_connected()) {
+        sim_stats.opens_refused++;
+        pthread_mutex_unlock(&sim_lock);
+        return MV_STATUS_UNAVAILABLE;
+    }
+
+    SimChannel* channel = NULL;
+    for (uint32_t i = 0 ; i < SIM_MAX_CHANNELS ; ++i) {
+        if (sim_channels[i].handle == 0) {
+            channel = &sim_channels[i];
+            break;
+        }
+    }
+
+    if (channel == NULL) {
+        pthread_mutex_unlock(&sim_lock);
+        return MV_STATUS_UNAVAILABLE;
+    }
+
+    uint32_t generation = channel->generation;
+    memset(channel, 0, sizeof(SimChannel));
+    channel->generation = generation + 1;
+    channel->handle = sim_next_channel_handle++;
+    channel->notification_handle = params->v1.notification_handle;
+    channel->notification_tag = params->v1.notification_tag;
+    channel->rx_buffer_len = params->v1.receive_buffer_len;
+    sim_stats.channels_opened++;
+    *handle = channel->handle;
+    pthread_mutex_unlock(&sim_lock);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvCloseChannel(MvChannelHandle* handle) {
+
+    if (handle == NULL) return MV_STATUS_PARAMETERFAULT;
+
+    pthread_mutex_lock(&sim_lock);
+    SimChannel* channel = sim_find_channel(*handle);
+    if (channel == NULL) {
+        pthread_mutex_unlock(&sim_lock);
+        return MV_STATUS_INVALIDHANDLE;
+    }
+
+    // Any worker still running for this channel will see the generation
+    // change and discard its result
+    sim_clear_response(channel);
+    channel->generation++;
+    channel->handle = 0;
+    *handle = 0;
+    pthread_mutex_unlock(&sim_lock);
+
+    sim_check_finished();
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetChannelClosureReason(MvChannelHandle handle, enum MvClosureReason* reason) {
+
+    if (reason == NULL) return MV_STATUS_PARAMETERFAULT;
+    pthread_mutex_lock(&sim_lock);
+    SimChannel* channel = sim_find_channel(handle);
+    pthread_mutex_unlock(&sim_lock);
+    if (channel == NULL) return MV_STATUS_INVALIDHANDLE;
+    *reason = channel->disconnected ? MV_CLOSUREREASON_NETWORKCONNECTIONLOST : MV_CLOSUREREASON_NOREASON;
+    return MV_STATUS_OKAY;
+}
+
+
+/**
+ * @brief Free a channel's stored response.
+ *
+ * Call with `sim_lock` held.
+ */
+static void sim_clear_response(SimChannel* channel) {
+
+    for (uint32_t i = 0 ; i < SIM_MAX_RESPONSE_HEADERS ; ++i) {
+        free(channel->header_lines[i]);
+        channel->header_lines[i] = NULL;
+    }
+
+    free(channel->body);
+    channel->body = NULL;
+    channel->has_response = false;
+    channel->response_read = false;
+    memset(&channel->data, 0, sizeof(channel->data));
+}
+
+
+/*
+ * HTTP
+ */
+enum MvStatus mvSendHttpRequest(MvChannelHandle handle, const struct MvHttpRequest* request) {
+
+    if (request == NULL) return MV_STATUS_PARAMETERFAULT;
+    sim_check_finished();
+
+    pthread_mutex_lock(&sim_lock);
+    SimChannel* channel = sim_find_channel(handle);
+    if (channel == NULL || channel->disconnected) {
+        pthread_mutex_unlock(&sim_lock);
+        return MV_STATUS_CHANNELCLOSED;
+    }
+
+    // Copy the request: the caller's memory need not outlive the call
+    SimJob* job = calloc(1, sizeof(SimJob));
+    job->channel = channel;
+    job->request.method = strndup((const char*)request->method.data, request->method.length);
+    job->request.url = strndup((const char*)request->url.data, request->url.length);
+    job->request.body = malloc(request->body.length + 1);
+    memcpy(job->request.body, request->body.data, request->body.length);
+    job->request.body_length = request->body.length;
+    job->request.timeout_ms = request->timeout_ms;
+
+    size_t headers_length = 1;
+    for (uint32_t i = 0 ; i < request->num_headers ; ++i) headers_length += request->headers[i].length + 2;
+    job->request.headers = calloc(1, headers_length);
+    char* cursor = job->request.headers;
+    for (uint32_t i = 0 ; i < request->num_headers ; ++i) {
+        memcpy(cursor, request->headers[i].data, request->headers[i].length);
+        cursor += request->headers[i].length;
+        *cursor++ = '\r';
+        *cursor++ = '\n';
+    }
+
+    // A new request discards the previous response
+    sim_clear_response(channel);
+    channel->in_flight = true;
+    channel->sent_us = sim_now_us();
+    job->delay_ms = sim_latency_ms + (channel->used ? 0 : sim_channel_setup_ms);
+    channel->used = true;
+    job->generation = channel->generation;
+    sim_stats.requests_sent++;
+    pthread_mutex_unlock(&sim_lock);
+
+    pthread_t worker;
+    pthread_create(&worker, NULL, sim_http_worker, job);
+    pthread_detach(worker);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvReadHttpResponseData(MvChannelHandle handle, struct MvHttpResponseData* response) {
+
+    if (response == NULL) return MV_STATUS_PARAMETERFAULT;
+
+    pthread_mutex_lock(&sim_lock);
+    SimChannel* channel = sim_find_channel(handle);
+    if (channel == NULL) {
+        pthread_mutex_unlock(&sim_lock);
+        return MV_STATUS_INVALIDHANDLE;
+    }
+
+    if (!channel->has_response) {
+        pthread_mutex_unlock(&sim_lock);
+        return MV_STATUS_RESPONSENOTPRESENT;
+    }
+
+    if (!channel->response_read) {
+        channel->response_read = true;
+        uint64_t wake_us = sim_now_us() - channel->readable_us;
+        sim_stats.responses_read++;
+        sim_stats.wake_total_us += wake_us;
+        if (wake_us > sim_stats.wake_max_us) sim_stats.wake_max_us = wake_us;
+    }
+
+    *response = channel->data;
+    pthread_mutex_unlock(&sim_lock);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvReadHttpResponseHeader(MvChannelHandle handle, uint32_t index, uint8_t* buffer, uint32_t size) {
+
+    if (buffer == NULL) return MV_STATUS_PARAMETERFAULT;
+
+    pthread_mutex_lock(&sim_lock);
+    SimChannel* channel = sim_find_channel(handle);
+    enum MvStatus status = MV_STATUS_OKAY;
+    if (channel == NULL) {
+        status = MV_STATUS_INVALIDHANDLE;
+    } else if (!channel->has_response) {
+        status = MV_STATUS_RESPONSENOTPRESENT;
+    } else if (index >= channel->data.num_headers) {
+        status = MV_STATUS_HEADERINDEXINVALID;
+    } else {
+        // Like Microvisor, copy at most `size` bytes with no terminator
+        const char* line = channel->header_lines[index];
+        size_t length = strlen(line);
+        memcpy(buffer, line, length < size ? length : size);
+    }
+
+    pthread_mutex_unlock(&sim_lock);
+    return status;
+}
+
+enum MvStatus mvReadHttpResponseBody(MvChannelHandle handle, uint32_t offset, uint8_t* buffer, uint32_t size) {
+
+    if (buffer == NULL) return MV_STATUS_PARAMETERFAULT;
+
+    pthread_mutex_lock(&sim_lock);
+    SimChannel* channel = sim_find_channel(handle);
+    enum MvStatus status = MV_STATUS_OKAY;
+    if (channel == NULL) {
+        status = MV_STATUS_INVALIDHANDLE;
+    } else if (!channel->has_response) {
+        status = MV_STATUS_RESPONSENOTPRESENT;
+    } else if (offset > channel->data.body_length) {
+        status = MV_STATUS_OFFSETINVALID;
+    } else {
+        uint32_t available = channel->data.body_length - offset;
+        memcpy(buffer, channel->body + offset, available < size ? available : size);
+    }
+
+    pthread_mutex_unlock(&sim_lock);
+    return status;
+}
+
+
+/**
+ * @brief Per-request worker thread: runs the exchange, then posts the response.
+ *
+ * @param arg: The `SimJob` to run. Freed here.
+ */
+static void* sim_http_worker(void* arg) {
+
+    SimJob* job = (SimJob*)arg;
+    char* raw = NULL;
+    size_t raw_length = 0;
+
+    if (job->delay_ms > 0) usleep(job->delay_ms * 1000);
+    bool exchanged = sim_http_exchange(&job->request, &raw, &raw_length);
+
+    pthread_mutex_lock(&sim_lock);
+    SimChannel* channel = job->channel;
+    if (channel->generation == job->generation && channel->handle != 0) {
+        if (exchanged) {
+            sim_parse_response(channel, raw, raw_length);
+            sim_stats.bytes_received += raw_length;
+        } else {
+            channel->data.result = strncmp(job->request.url, "http", 4) == 0
+                ? MV_HTTPRESULT_REQUESTFAILED
+                : MV_HTTPRESULT_UNSUPPORTEDURISCHEME;
+            sim_stats.requests_failed++;
+        }
+
+        channel->has_response = true;
+        channel->in_flight = false;
+        channel->readable_us = sim_now_us();
+        uint64_t rtt_us = channel->readable_us - channel->sent_us;
+        sim_stats.rtt_total_us += rtt_us;
+        if (rtt_us > sim_stats.rtt_max_us) sim_stats.rtt_max_us = rtt_us;
+        sim_post_notification(channel->notification_handle, MV_EVENTTYPE_CHANNELDATAREADABLE, channel->notification_tag);
+    }
+
+    pthread_mutex_unlock(&sim_lock);
+
+    free(raw);
+    free(job->request.method);
+    free(job->request.url);
+    free(job->request.headers);
+    free(job->request.body);
+    free(job);
+    return NULL;
+}
+
+
+/**
+ * @brief Run one HTTP/1.1 exchange with the fixture server.
+ *
+ * @param request:         The request to issue.
+ * @param response:        Receives a heap buffer holding the raw response.
+ * @param response_length: Receives the raw response's length.
+ *
+ * @returns `true` if a response was received, otherwise `false`.
+ */
+static bool sim_http_exchange(const SimRequest* request, char** response, size_t* response_length) {
+
+    // Split `scheme://host/path` -- only the path goes to the fixture server
+    const char* host = strstr(request->url, "://");
+    if (host == NULL || strncmp(request->url, "http", 4) != 0) return false;
+    host += 3;
+    const char* path = strchr(host, '/');
+    int host_length = path != NULL ? (int)(path - host) : (int)strlen(host);
+    if (path == NULL) path = "/";
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo* addresses = NULL;
+    if (getaddrinfo(sim_origin_host, sim_origin_port, &hints, &addresses) != 0) return false;
+
+    int sock = -1;
+    for (struct addrinfo* address = addresses ; address != NULL ; address = address->ai_next) {
+        sock = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (sock < 0) continue;
+        if (connect(sock, address->ai_addr, address->ai_addrlen) == 0) break;
+        close(sock);
+        sock = -1;
+    }
+
+    freeaddrinfo(addresses);
+    if (sock < 0) return false;
+
+    uint32_t timeout_ms = request->timeout_ms > 0 ? request->timeout_ms : 10000;
+    struct timeval timeout = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    char* head = NULL;
+    int head_length = asprintf(&head,
+                               "%s %s HTTP/1.1\r\nHost: %.*s\r\nConnection: close\r\nContent-Length: %u\r\n%s\r\n",
+                               request->method, path, host_length, host, request->body_length, request->headers);
+    bool sent = head_length > 0
+        && send(sock, head, (size_t)head_length, MSG_NOSIGNAL) == head_length
+        && (request->body_length == 0 || send(sock, request->body, request->body_length, MSG_NOSIGNAL) == (ssize_t)request->body_length);
+    free(head);
+
+    size_t capacity = 4096;
+    size_t length = 0;
+    char* raw = malloc(capacity + 1);
+    while (sent) {
+        if (length == capacity) {
+            capacity *= 2;
+            raw = realloc(raw, capacity + 1);
+        }
+
+        ssize_t count = recv(sock, raw + length, capacity - length, 0);
+        if (count < 0) sent = false;
+        if (count <= 0) break;
+        length += (size_t)count;
+    }
+
+    close(sock);
+    if (!sent || length == 0) {
+        free(raw);
+        return false;
+    }
+
+    raw[length] = 0;
+    *response = raw;
+    *response_length = length;
+    return true;
+}
+
+
+/**
+ * @brief Split a raw HTTP response into status, header lines and body.
+ *
+ * Microvisor holds the whole response in the channel's receive buffer, so a
+ * response that would not fit is reported as `MV_HTTPRESULT_RESPONSETOOLARGE`.
+ *
+ * Call with `sim_lock` held.
+ */
+static void sim_parse_response(SimChannel* channel, char* raw, size_t raw_length) {
+
+    char* body = strstr(raw, "\r\n\r\n");
+    if (body == NULL || strncmp(raw, "HTTP/", 5) != 0) {
+        channel->data.result = MV_HTTPRESULT_REQUESTFAILED;
+        return;
+    }
+
+    *body = 0;
+    body += 4;
+    size_t body_length = raw_length - (size_t)(body - raw);
+
+    char* line = strchr(raw, ' ');
+    channel->data.status_code = line != NULL ? (uint32_t)strtoul(line + 1, NULL, 10) : 0;
+
+    uint32_t stored_length = 0;
+    char* next = strstr(raw, "\r\n");
+    while (next != NULL && channel->data.num_headers < SIM_MAX_RESPONSE_HEADERS) {
+        line = next + 2;
+        next = strstr(line, "\r\n");
+        if (next != NULL) *next = 0;
+        if (*line == 0) break;
+        channel->header_lines[channel->data.num_headers++] = strdup(line);
+        stored_length += (uint32_t)strlen(line);
+    }
+
+    if (stored_length + body_length > channel->rx_buffer_len) {
+        channel->data.result = MV_HTTPRESULT_RESPONSETOOLARGE;
+        channel->data.status_code = 0;
+        return;
+    }
+
+    channel->data.result = MV_HTTPRESULT_OK;
+    channel->data.body_length = (uint32_t)body_length;
+    channel->body = malloc(body_length + 1);
+    memcpy(channel->body, body, body_length);
+}
+
+
+/**
+ * @brief Exit once MV_SIM_MAX_REQUESTS responses have been consumed.
+ */
+static void sim_check_finished(void) {
+
+    pthread_mutex_lock(&sim_lock);
+    bool finished = sim_max_requests > 0 && sim_stats.responses_read >= sim_max_requests;
+    pthread_mutex_unlock(&sim_lock);
+    if (finished) exit(0);
+}
+
+
+/**
+ * @brief Print the timing summary.
+ */
+static void sim_print_summary(void) {
+
+    uint32_t overwritten = 0;
+    for (uint32_t i = 0 ; i < SIM_MAX_NOTIFICATION_CENTERS ; ++i) overwritten += sim_centers[i].overwritten;
+
+    printf("[SIM] ---- Summary ----\n");
+    printf("[SIM] Channels opened:          %u\n", sim_stats.channels_opened);
+    printf("[SIM] Requests sent/failed:     %u/%u\n", sim_stats.requests_sent, sim_stats.requests_failed);
+    printf("[SIM] Responses read:           %u (%llu bytes)\n", sim_stats.responses_read, (unsigned long long)sim_stats.bytes_received);
+    printf("[SIM] Channels lost/refused:    %u/%u\n", sim_stats.channels_lost, sim_stats.opens_refused);
+    if (sim_stats.requests_sent > 0) {
+        printf("[SIM] Round trip avg/max:       %llu/%llu us\n",
+               (unsigned long long)(sim_stats.rtt_total_us / sim_stats.requests_sent), (unsigned long long)sim_stats.rtt_max_us);
+    }
+    if (sim_stats.responses_read > 0) {
+        printf("[SIM] Readable->read avg/max:   %llu/%llu us\n",
+               (unsigned long long)(sim_stats.wake_total_us / sim_stats.responses_read), (unsigned long long)sim_stats.wake_max_us);
+    }
+    printf("[SIM] Overwritten notifications: %u\n", overwritten);
+    printf("[SIM] Flash erases/programs:   %u/%u\n", sim_flash_get_stats()->erases, sim_flash_get_stats()->programs);
+    fflush(stdout);
+}
+
+
+/*
+ * LOGGING
+ */
+enum MvStatus mvServerLoggingInit(uint8_t* buffer, uint32_t size) {
+
+    if (buffer == NULL || size == 0) return MV_STATUS_INVALIDBUFFER;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvServerLog(const uint8_t* message, uint16_t length) {
+
+    uint64_t usec = sim_now_us();
+    static uint64_t start_us = 0;
+    if (start_us == 0) start_us = usec;
+    usec -= start_us;
+    printf("[%6llu.%06llu] %.*s\n", (unsigned long long)(usec / 1000000), (unsigned long long)(usec % 1000000), (int)length, (const char*)message);
+    fflush(stdout);
+    return MV_STATUS_OKAY;
+}
+
+
+/*
+ * SYSTEM
+ */
+enum MvStatus mvGetDeviceId(uint8_t* buffer, uint32_t size) {
+
+    if (buffer == NULL) return MV_STATUS_PARAMETERFAULT;
+    const char id[] = "UVSIMULATOR0000000000000000000000";
+    memcpy(buffer, id, size < sizeof(id) - 1 ? size : sizeof(id) - 1);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetWakeReason(enum MvWakeReason* reason) {
+
+    if (reason == NULL) return MV_STATUS_PARAMETERFAULT;
+    *reason = MV_WAKEREASON_COLDBOOT;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetHClk(uint32_t* hclk) {
+
+    if (hclk == NULL) return MV_STATUS_PARAMETERFAULT;
+    *hclk = SystemCoreClock;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetMicroseconds(uint64_t* usec) {
+
+    if (usec == NULL) return MV_STATUS_PARAMETERFAULT;
+    *usec = sim_now_us();
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetWallTime(uint64_t* usec) {
+
+    if (usec == NULL) return MV_STATUS_PARAMETERFAULT;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    *usec = (uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_nsec / 1000ULL;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvSystemLedEnable(uint32_t enable) {
+
+    (void)enable;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvRestart(enum MvRestartMode mode) {
+
+    printf("[SIM] Restart requested (mode %u)\n", (unsigned)mode);
+    exit(0);
+}